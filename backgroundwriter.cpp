@@ -0,0 +1,46 @@
+#include "backgroundwriter.h"
+
+#include <QCoreApplication>
+#include <QThread>
+
+#include <utility>
+
+BackgroundWriter *BackgroundWriter::instance() {
+    static BackgroundWriter *writer = new BackgroundWriter(QCoreApplication::instance());
+    return writer;
+}
+
+BackgroundWriter::BackgroundWriter(QObject *parent)
+    : QObject(parent)
+    , writerThread(new QThread(this))
+    , context(new QObject)
+    , writes(0) {
+    writerThread->setObjectName(QStringLiteral("BackgroundWriter"));
+    context->moveToThread(writerThread);
+    connect(writerThread, &QThread::finished, context, &QObject::deleteLater);
+    writerThread->start();
+}
+
+BackgroundWriter::~BackgroundWriter() {
+    waitForIdle();
+    writerThread->quit();
+    writerThread->wait();
+}
+
+void BackgroundWriter::post(Job job) {
+    QMetaObject::invokeMethod(context, [this, job = std::move(job)]() {
+        if (job())
+            ++writes;
+    }, Qt::QueuedConnection);
+}
+
+void BackgroundWriter::waitForIdle() {
+    if (QThread::currentThread() == writerThread)
+        return;
+    // Queued jobs run in order, so an empty one marks the end of the queue
+    QMetaObject::invokeMethod(context, []() {}, Qt::BlockingQueuedConnection);
+}
+
+int BackgroundWriter::writeCount() const {
+    return writes.load();
+}
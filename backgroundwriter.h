@@ -0,0 +1,36 @@
+#ifndef BACKGROUNDWRITER_H
+#define BACKGROUNDWRITER_H
+
+#include <QObject>
+
+#include <atomic>
+#include <functional>
+
+class QThread;
+
+// One thread for all small disk writes (settings, model stats, cache
+// entries), so the GUI thread never waits on the file system. Jobs run in
+// the order they were posted.
+class BackgroundWriter : public QObject {
+    Q_OBJECT
+
+public:
+    using Job = std::function<bool()>;
+
+    static BackgroundWriter *instance();
+    explicit BackgroundWriter(QObject *parent = nullptr);
+    ~BackgroundWriter() override;
+
+    // The job returns whether it wrote anything
+    void post(Job job);
+    // Blocks until every job posted so far has finished
+    void waitForIdle();
+    int writeCount() const;
+
+private:
+    QThread *writerThread;
+    QObject *context;
+    std::atomic<int> writes;
+};
+
+#endif // BACKGROUNDWRITER_H
@@ -0,0 +1,338 @@
+#include "bpetokenizer.h"
+#include "perflog.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegularExpressionMatchIterator>
+#include <QThreadPool>
+#include <QVarLengthArray>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+namespace {
+constexpr int kNoRank = INT_MAX;
+// cl100k_base has 100256 tokens and o200k_base 199998
+constexpr int kO200kMinVocabulary = 150000;
+
+// Pre-tokenizer patterns published with the cl100k_base and o200k_base vocabularies
+const char kCl100kPattern[] =
+    R"((?i:'s|'t|'re|'ve|'m|'ll|'d)|[^\r\n\p{L}\p{N}]?\p{L}+|\p{N}{1,3}| ?[^\s\p{L}\p{N}]+[\r\n]*|\s*[\r\n]+|\s+(?!\S)|\s+)";
+const char kO200kPattern[] =
+    R"([^\r\n\p{L}\p{N}]?[\p{Lu}\p{Lt}\p{Lm}\p{Lo}\p{M}]*[\p{Ll}\p{Lm}\p{Lo}\p{M}]+(?i:'s|'t|'re|'ve|'m|'ll|'d)?)"
+    R"(|[^\r\n\p{L}\p{N}]?[\p{Lu}\p{Lt}\p{Lm}\p{Lo}\p{M}]+[\p{Ll}\p{Lm}\p{Lo}\p{M}]*(?i:'s|'t|'re|'ve|'m|'ll|'d)?)"
+    R"(|\p{N}{1,3}| ?[^\s\p{L}\p{N}]+[\r\n/]*|\s*[\r\n]+|\s+(?!\S)|\s+)";
+
+struct CachedVocabulary {
+    QMutex mutex;
+    QString path;
+    QDateTime modified;
+    qint64 size = -1;
+    std::shared_ptr<const BpeTokenizer> tokenizer;
+    // Path of the preload running on the thread pool, if any
+    QString loadingPath;
+};
+
+CachedVocabulary &cachedVocabulary() {
+    static CachedVocabulary cache;
+    return cache;
+}
+
+quint32 hashBytes(const char *bytes, qsizetype length) {
+    // FNV-1a
+    quint32 hash = 2166136261u;
+    for (qsizetype i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(bytes[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+template <int Prealloc>
+void encodeUtf8(QStringView text, QVarLengthArray<char, Prealloc> *out) {
+    out->clear();
+    for (qsizetype i = 0; i < text.size(); ++i) {
+        char32_t code = text.at(i).unicode();
+        if (QChar::isHighSurrogate(code) && i + 1 < text.size()
+            && QChar::isLowSurrogate(text.at(i + 1).unicode())) {
+            code = QChar::surrogateToUcs4(text.at(i).unicode(), text.at(i + 1).unicode());
+            ++i;
+        }
+        if (code < 0x80) {
+            out->append(static_cast<char>(code));
+        } else if (code < 0x800) {
+            out->append(static_cast<char>(0xC0 | (code >> 6)));
+            out->append(static_cast<char>(0x80 | (code & 0x3F)));
+        } else if (code < 0x10000) {
+            out->append(static_cast<char>(0xE0 | (code >> 12)));
+            out->append(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            out->append(static_cast<char>(0x80 | (code & 0x3F)));
+        } else {
+            out->append(static_cast<char>(0xF0 | (code >> 18)));
+            out->append(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+            out->append(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            out->append(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+    }
+}
+}
+
+std::shared_ptr<const BpeTokenizer> BpeTokenizer::load(const QString &path) {
+    if (path.trimmed().isEmpty())
+        return nullptr;
+
+    const QFileInfo info(path);
+    const QString absolutePath = info.absoluteFilePath();
+    const QDateTime modified = info.lastModified();
+    const qint64 size = info.size();
+    CachedVocabulary &cache = cachedVocabulary();
+    {
+        QMutexLocker locker(&cache.mutex);
+        if (cache.path == absolutePath && cache.modified == modified && cache.size == size)
+            return cache.tokenizer;
+    }
+
+    // Parsed outside the lock so cached() never waits for it
+    QElapsedTimer timer;
+    timer.start();
+    std::shared_ptr<BpeTokenizer> tokenizer;
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly)) {
+        tokenizer = std::make_shared<BpeTokenizer>();
+        if (tokenizer->parse(file.readAll())) {
+            qCDebug(lcPerf) << "loaded" << tokenizer->vocabularySize() << "BPE tokens from"
+                            << info.fileName() << "in" << timer.nsecsElapsed() / 1000000.0 << "ms";
+        } else {
+            tokenizer.reset();
+        }
+    }
+
+    // Failures are cached too so a bad path is not parsed again
+    QMutexLocker locker(&cache.mutex);
+    cache.path = absolutePath;
+    cache.modified = modified;
+    cache.size = size;
+    cache.tokenizer = tokenizer;
+    return cache.tokenizer;
+}
+
+void BpeTokenizer::preload(const QString &path) {
+    if (path.trimmed().isEmpty())
+        return;
+    const QString absolutePath = QFileInfo(path).absoluteFilePath();
+    CachedVocabulary &cache = cachedVocabulary();
+    {
+        QMutexLocker locker(&cache.mutex);
+        if (cache.loadingPath == absolutePath)
+            return;
+        cache.loadingPath = absolutePath;
+    }
+    QThreadPool::globalInstance()->start([path, absolutePath]() {
+        load(path);
+        CachedVocabulary &cache = cachedVocabulary();
+        QMutexLocker locker(&cache.mutex);
+        if (cache.loadingPath == absolutePath)
+            cache.loadingPath.clear();
+    });
+}
+
+std::shared_ptr<const BpeTokenizer> BpeTokenizer::cached(const QString &path) {
+    if (path.trimmed().isEmpty())
+        return nullptr;
+    const QString absolutePath = QFileInfo(path).absoluteFilePath();
+    CachedVocabulary &cache = cachedVocabulary();
+    {
+        QMutexLocker locker(&cache.mutex);
+        if (cache.path == absolutePath)
+            return cache.tokenizer;
+    }
+    preload(path);
+    return nullptr;
+}
+
+int BpeTokenizer::vocabularySize() const {
+    return tokenCount;
+}
+
+int BpeTokenizer::count(const QString &text) const {
+    int total = 0;
+    QVarLengthArray<char, 256> bytes;
+    QRegularExpressionMatchIterator it = pieceExpression.globalMatch(text);
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        encodeUtf8(match.capturedView(), &bytes);
+        total += countPiece(bytes.constData(), bytes.size());
+    }
+    return total;
+}
+
+QString BpeTokenizer::truncate(const QString &text, int maxTokens) const {
+    if (maxTokens <= 0)
+        return text;
+    int total = 0;
+    QVarLengthArray<char, 256> bytes;
+    QRegularExpressionMatchIterator it = pieceExpression.globalMatch(text);
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        encodeUtf8(match.capturedView(), &bytes);
+        total += countPiece(bytes.constData(), bytes.size());
+        if (total > maxTokens)
+            return text.left(match.capturedStart());
+    }
+    return text;
+}
+
+bool BpeTokenizer::parse(const QByteArray &data) {
+    struct Entry {
+        quint32 offset;
+        quint32 length;
+        int rank;
+    };
+    QList<Entry> entries;
+    tokenBytes.reserve(data.size() * 3 / 4);
+
+    qsizetype lineStart = 0;
+    while (lineStart < data.size()) {
+        qsizetype lineEnd = data.indexOf('\n', lineStart);
+        if (lineEnd < 0)
+            lineEnd = data.size();
+        const QByteArray line = data.mid(lineStart, lineEnd - lineStart).trimmed();
+        lineStart = lineEnd + 1;
+        if (line.isEmpty())
+            continue;
+
+        const qsizetype space = line.indexOf(' ');
+        if (space <= 0)
+            return false;
+        bool rankOk = false;
+        const int rank = line.mid(space + 1).toInt(&rankOk);
+        const QByteArray token = QByteArray::fromBase64(line.left(space));
+        if (!rankOk || rank < 0 || token.isEmpty())
+            return false;
+        entries.append({static_cast<quint32>(tokenBytes.size()), static_cast<quint32>(token.size()), rank});
+        tokenBytes.append(token);
+    }
+    if (entries.isEmpty())
+        return false;
+
+    // Keep the table at most half full so probe runs stay short
+    quint32 capacity = 1;
+    while (capacity < static_cast<quint32>(entries.size()) * 2)
+        capacity <<= 1;
+    slots.assign(capacity, RankSlot());
+    slotMask = capacity - 1;
+    for (const Entry &entry : entries)
+        insertRank(entry.offset, entry.length, entry.rank);
+    tokenCount = static_cast<int>(entries.size());
+
+    const bool o200k = tokenCount > kO200kMinVocabulary;
+    pieceExpression.setPattern(QString::fromLatin1(o200k ? kO200kPattern : kCl100kPattern));
+    pieceExpression.setPatternOptions(QRegularExpression::UseUnicodePropertiesOption);
+    pieceExpression.optimize();
+    return pieceExpression.isValid();
+}
+
+void BpeTokenizer::insertRank(quint32 offset, quint32 length, int rank) {
+    const quint32 hash = hashBytes(tokenBytes.constData() + offset, length);
+    quint32 index = hash & slotMask;
+    while (slots[index].rank >= 0)
+        index = (index + 1) & slotMask;
+    RankSlot &slot = slots[index];
+    slot.hash = hash;
+    slot.offset = offset;
+    slot.length = length;
+    slot.rank = rank;
+}
+
+int BpeTokenizer::rankOf(const char *bytes, qsizetype length) const {
+    const quint32 hash = hashBytes(bytes, length);
+    quint32 index = hash & slotMask;
+    while (true) {
+        const RankSlot &slot = slots[index];
+        if (slot.rank < 0)
+            return kNoRank;
+        if (slot.hash == hash && slot.length == static_cast<quint32>(length)
+            && std::memcmp(tokenBytes.constData() + slot.offset, bytes, static_cast<size_t>(length)) == 0) {
+            return slot.rank;
+        }
+        index = (index + 1) & slotMask;
+    }
+}
+
+int BpeTokenizer::countPiece(const char *bytes, qsizetype length) const {
+    if (length <= 1)
+        return static_cast<int>(length);
+    if (rankOf(bytes, length) != kNoRank)
+        return 1;
+
+    // Parts form a linked list indexed by their first byte; each live part
+    // caches the rank of merging it with the next one. Candidate merges sit
+    // in a min-heap ordered by rank and then position, the order tiktoken
+    // applies them in, so long pieces cost O(n log n) instead of a scan per
+    // merge. Entries go stale when a neighbour merges and are skipped.
+    struct Part {
+        qsizetype prev;
+        qsizetype next;
+        int rank;
+    };
+    struct Merge {
+        int rank;
+        qsizetype start;
+    };
+    const auto later = [](const Merge &a, const Merge &b) {
+        return a.rank != b.rank ? a.rank > b.rank : a.start > b.start;
+    };
+
+    // parts[length] is a sentinel marking the end of the piece
+    QVarLengthArray<Part, 64> parts(length + 1);
+    for (qsizetype i = 0; i <= length; ++i)
+        parts[i] = {i - 1, i + 1, kNoRank};
+
+    const auto pairRank = [&](qsizetype start) {
+        const qsizetype next = parts[start].next;
+        if (next >= length)
+            return kNoRank;
+        return rankOf(bytes + start, parts[next].next - start);
+    };
+
+    QVarLengthArray<Merge, 64> heap;
+    for (qsizetype i = 0; i + 1 < length; ++i) {
+        parts[i].rank = pairRank(i);
+        if (parts[i].rank != kNoRank)
+            heap.append({parts[i].rank, i});
+    }
+    std::make_heap(heap.begin(), heap.end(), later);
+
+    const auto updateRank = [&](qsizetype start) {
+        parts[start].rank = pairRank(start);
+        if (parts[start].rank != kNoRank) {
+            heap.append({parts[start].rank, start});
+            std::push_heap(heap.begin(), heap.end(), later);
+        }
+    };
+
+    int count = static_cast<int>(length);
+    while (!heap.isEmpty()) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        const Merge merge = heap.takeLast();
+        if (parts[merge.start].rank != merge.rank)
+            continue;
+
+        const qsizetype removed = parts[merge.start].next;
+        parts[merge.start].next = parts[removed].next;
+        parts[parts[removed].next].prev = merge.start;
+        parts[removed].rank = kNoRank;
+        --count;
+
+        updateRank(merge.start);
+        if (parts[merge.start].prev >= 0)
+            updateRank(parts[merge.start].prev);
+    }
+    return count;
+}
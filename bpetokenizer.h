@@ -0,0 +1,56 @@
+#ifndef BPETOKENIZER_H
+#define BPETOKENIZER_H
+
+#include <QByteArray>
+#include <QRegularExpression>
+#include <QString>
+
+#include <memory>
+#include <vector>
+
+// Byte-pair tokenizer for tiktoken-style vocabularies (cl100k_base,
+// o200k_base): one "<base64 token> <rank>" pair per line. Token bytes live in
+// one contiguous buffer and ranks in an open-addressed table, so merge
+// lookups hash a byte range in place without allocating. The pre-tokenizer
+// pattern follows the vocabulary size, since o200k_base is the only
+// published vocabulary with more than 150000 tokens.
+class BpeTokenizer {
+public:
+    // Loads and caches the vocabulary; returns null when the file is missing
+    // or malformed. Repeated calls with the same unchanged file are free.
+    // Blocks while parsing, so the GUI thread uses preload() and cached().
+    static std::shared_ptr<const BpeTokenizer> load(const QString &path);
+    // Starts loading on the global thread pool unless a load of the same
+    // path is already running
+    static void preload(const QString &path);
+    // The tokenizer for path if it has been loaded, without touching the
+    // file; starts a preload and returns null otherwise
+    static std::shared_ptr<const BpeTokenizer> cached(const QString &path);
+
+    int vocabularySize() const;
+    int count(const QString &text) const;
+    // Longest prefix that fits into maxTokens, cut between pre-tokenized
+    // pieces so it never splits a character.
+    QString truncate(const QString &text, int maxTokens) const;
+
+private:
+    struct RankSlot {
+        quint32 hash = 0;
+        quint32 offset = 0;
+        quint32 length = 0;
+        int rank = -1;
+    };
+
+    QByteArray tokenBytes;
+    std::vector<RankSlot> slots;
+    quint32 slotMask = 0;
+    int tokenCount = 0;
+    QRegularExpression pieceExpression;
+
+    bool parse(const QByteArray &data);
+    void insertRank(quint32 offset, quint32 length, int rank);
+    int rankOf(const char *bytes, qsizetype length) const;
+    int countPiece(const char *bytes, qsizetype length) const;
+};
+
+#endif // BPETOKENIZER_H
@@ -0,0 +1,196 @@
+#include "chunkedrequest.h"
+
+#include <QStringList>
+
+ChunkedRequest::ChunkedRequest(const QString &systemPrompt, const QList<Part> &parts, bool reduce,
+                               int maxParallel, SendFunction send)
+    : systemPrompt(systemPrompt)
+    , send(std::move(send))
+    , maxParallel(maxParallel > 0 ? maxParallel : static_cast<int>(parts.size()))
+    , reduce(reduce) {
+    for (const Part &part : parts) {
+        Job job;
+        job.part = part;
+        jobs.append(job);
+    }
+}
+
+QList<ChatMessage> ChunkedRequest::partMessages(const QString &systemPrompt, const QString &text) {
+    return {
+        {QStringLiteral("system"), systemPrompt},
+        {QStringLiteral("user"), text}
+    };
+}
+
+int ChunkedRequest::partCount() const {
+    return static_cast<int>(jobs.size());
+}
+
+void ChunkedRequest::setCachedReply(int index, const QString &reply) {
+    if (index < 0 || index >= jobs.size() || reply.isEmpty())
+        return;
+    Job &job = jobs[index];
+    job.cached = true;
+    job.finished = true;
+    job.reply = reply;
+    StreamBatch batch;
+    batch.text = reply;
+    job.batches.append(batch);
+}
+
+ChunkedRequest::Progress ChunkedRequest::start() {
+    sendNext();
+    Progress progress;
+    if (sendFailed) {
+        progress.sendFailed = true;
+        return progress;
+    }
+    if (reduce) {
+        for (const Job &job : jobs) {
+            if (!job.finished)
+                return progress;
+        }
+        progress.reduceMessages = buildReduceMessages();
+        return progress;
+    }
+    // A cached first part has no stream, so its reply is replayed
+    progress.replay = std::move(jobs[current].batches);
+    jobs[current].batches.clear();
+    advance(&progress);
+    return progress;
+}
+
+bool ChunkedRequest::owns(int requestId) const {
+    return indexOf(requestId) >= 0;
+}
+
+bool ChunkedRequest::addBatch(int requestId, const StreamBatch &batch) {
+    const int index = indexOf(requestId);
+    if (index < 0)
+        return false;
+    Job &job = jobs[index];
+    if (!batch.text.isEmpty() && job.firstTokenMs < 0)
+        job.firstTokenMs = job.clock.elapsed();
+    if (batch.hasUsage)
+        job.usageTokens = batch.usage.completionTokens;
+    job.reply += batch.text;
+    if (!batch.errorMessage.isEmpty())
+        job.sawError = true;
+    // The reduce pass only needs the reply text
+    if (reduce)
+        return true;
+    if (index == current)
+        return false;
+    job.batches.append(batch);
+    return true;
+}
+
+ChunkedRequest::Progress ChunkedRequest::finishPart(int requestId) {
+    Progress progress;
+    const int index = indexOf(requestId);
+    if (index < 0)
+        return progress;
+    Job &job = jobs[index];
+    job.finished = true;
+    --inFlight;
+    if (!job.sawError && !job.part.cacheKey.isEmpty()) {
+        progress.storeKey = job.part.cacheKey;
+        progress.storeReply = job.reply;
+    }
+    progress.partStats = statsOf(requestId);
+
+    sendNext();
+    if (sendFailed) {
+        progress.sendFailed = true;
+        return progress;
+    }
+    if (reduce) {
+        for (const Job &other : jobs) {
+            if (!other.finished)
+                return progress;
+        }
+        progress.reduceMessages = buildReduceMessages();
+        return progress;
+    }
+    // Stays the current request when only cached parts follow
+    progress.currentRequestId = requestId;
+    advance(&progress);
+    return progress;
+}
+
+QList<int> ChunkedRequest::inFlightRequests() const {
+    QList<int> requests;
+    for (const Job &job : jobs) {
+        if (job.requestId != 0 && !job.finished)
+            requests.append(job.requestId);
+    }
+    return requests;
+}
+
+ChunkedRequest::PartStats ChunkedRequest::statsOf(int requestId) const {
+    PartStats stats;
+    const int index = indexOf(requestId);
+    if (index < 0)
+        return stats;
+    const Job &job = jobs.at(index);
+    stats.elapsedMs = job.clock.elapsed();
+    stats.firstTokenMs = job.firstTokenMs;
+    stats.tokens = job.usageTokens > 0 ? job.usageTokens : ContextBudget::estimateTokens(job.reply);
+    stats.failed = job.sawError && job.reply.isEmpty();
+    return stats;
+}
+
+int ChunkedRequest::indexOf(int requestId) const {
+    if (requestId == 0)
+        return -1;
+    for (int i = 0; i < jobs.size(); ++i) {
+        if (jobs.at(i).requestId == requestId)
+            return i;
+    }
+    return -1;
+}
+
+void ChunkedRequest::sendNext() {
+    while (!sendFailed && nextToSend < jobs.size() && inFlight < maxParallel) {
+        Job &job = jobs[nextToSend++];
+        if (job.finished)
+            continue;
+        job.clock.start();
+        job.requestId = send(partMessages(systemPrompt, job.part.text));
+        // No finish would ever arrive for it
+        if (job.requestId == 0) {
+            sendFailed = true;
+            break;
+        }
+        ++inFlight;
+    }
+}
+
+void ChunkedRequest::advance(Progress *progress) {
+    while (jobs.at(current).finished) {
+        if (current == jobs.size() - 1) {
+            progress->finished = true;
+            break;
+        }
+        StreamBatch separator;
+        separator.text = QStringLiteral("\n\n");
+        progress->replay.append(separator);
+
+        Job &next = jobs[++current];
+        progress->replay += std::move(next.batches);
+        next.batches.clear();
+    }
+    if (jobs.at(current).requestId != 0)
+        progress->currentRequestId = jobs.at(current).requestId;
+}
+
+QList<ChatMessage> ChunkedRequest::buildReduceMessages() const {
+    QStringList partials;
+    for (const Job &job : jobs)
+        partials.append(job.reply.trimmed());
+    const QString combined = QStringLiteral(
+        "The text was processed in %1 consecutive parts. Combine the partial results below, "
+        "in order, into one coherent result.\n\n").arg(partials.size())
+        + partials.join(QStringLiteral("\n\n---\n\n"));
+    return partMessages(systemPrompt, combined);
+}
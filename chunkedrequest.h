@@ -0,0 +1,110 @@
+#ifndef CHUNKEDREQUEST_H
+#define CHUNKEDREQUEST_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+
+#include <functional>
+
+#include "contextbudget.h"
+#include "llmclient.h"
+
+// Parts of a selection that was too long for a single request, sent as
+// concurrent requests. Replies are passed on in part order; parts that finish
+// early are buffered until their turn. With a reduce pass every reply is
+// buffered and combined by one more request. Parts the response cache already
+// answered start out finished and are never sent. The owner routes the
+// batches and finishes of the run's requests here and acts on the returned
+// Progress.
+class ChunkedRequest {
+public:
+    // Sends one part and returns its request id, 0 when it could not be sent
+    using SendFunction = std::function<int(const QList<ChatMessage> &messages)>;
+
+    struct Part {
+        QString text;
+        // Empty when replies for this part are not cached
+        QByteArray cacheKey;
+    };
+
+    // Timing of one sent part, for the model's latency stats
+    struct PartStats {
+        // < 0 for parts that were never sent
+        qint64 elapsedMs = -1;
+        qint64 firstTokenMs = -1;
+        int tokens = 0;
+        bool failed = false;
+    };
+
+    struct Progress {
+        // Request whose reply streams as the primary one; 0 while every reply
+        // is buffered for the reduce pass or when only cached parts are left
+        int currentRequestId = 0;
+        // Buffered replies to append to the primary reply, in order
+        QList<StreamBatch> replay;
+        // The last part is done; the primary reply finishes now
+        bool finished = false;
+        // Every part is done and the combining request is due
+        QList<ChatMessage> reduceMessages;
+        // Reply of the part that just finished, for the response cache
+        QByteArray storeKey;
+        QString storeReply;
+        // Timing of the part that just finished
+        PartStats partStats;
+        // A part could not be sent, so the run cannot finish; the owner ends
+        // it as a failed request
+        bool sendFailed = false;
+    };
+
+    ChunkedRequest(const QString &systemPrompt, const QList<Part> &parts, bool reduce,
+                   int maxParallel, SendFunction send);
+
+    static QList<ChatMessage> partMessages(const QString &systemPrompt, const QString &text);
+
+    int partCount() const;
+    // A cache hit for the part at index; call before start()
+    void setCachedReply(int index, const QString &reply);
+    Progress start();
+
+    bool owns(int requestId) const;
+    // Returns true when the batch was buffered rather than belonging to the
+    // part that streams as the primary reply
+    bool addBatch(int requestId, const StreamBatch &batch);
+    Progress finishPart(int requestId);
+    // Requests still on the network
+    QList<int> inFlightRequests() const;
+    PartStats statsOf(int requestId) const;
+
+private:
+    struct Job {
+        Part part;
+        int requestId = 0;
+        QElapsedTimer clock;
+        qint64 firstTokenMs = -1;
+        int usageTokens = 0;
+        QList<StreamBatch> batches;
+        QString reply;
+        bool sawError = false;
+        bool cached = false;
+        bool finished = false;
+    };
+
+    QString systemPrompt;
+    QList<Job> jobs;
+    SendFunction send;
+    int maxParallel;
+    int current = 0;
+    int nextToSend = 0;
+    int inFlight = 0;
+    bool reduce;
+    bool sendFailed = false;
+
+    int indexOf(int requestId) const;
+    void sendNext();
+    void advance(Progress *progress);
+    QList<ChatMessage> buildReduceMessages() const;
+};
+
+#endif // CHUNKEDREQUEST_H
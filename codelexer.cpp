@@ -0,0 +1,348 @@
+#include "codelexer.h"
+
+#include <QHash>
+
+#include <initializer_list>
+
+namespace {
+constexpr int kMaxKeywordLength = 32;
+
+QSet<QStringView> keywordSet(std::initializer_list<QStringView> words) {
+    return QSet<QStringView>(words.begin(), words.end());
+}
+
+CodeLanguage makeDefaultLanguage() {
+    CodeLanguage language;
+    language.keywords = keywordSet({
+        u"auto", u"bool", u"break", u"case", u"catch", u"class", u"const", u"continue", u"def",
+        u"default", u"delete", u"do", u"else", u"enum", u"export", u"extends", u"false", u"final",
+        u"finally", u"for", u"foreach", u"from", u"function", u"if", u"implements", u"import",
+        u"inline", u"interface", u"lambda", u"let", u"namespace", u"new", u"nullptr", u"null",
+        u"operator", u"private", u"protected", u"public", u"return", u"static", u"struct",
+        u"switch", u"template", u"this", u"throw", u"true", u"try", u"typedef", u"typename",
+        u"using", u"var", u"virtual", u"void", u"volatile", u"while"
+    });
+    language.lineComment = u"//";
+    language.altLineComment = u"#";
+    language.blockComments = true;
+    language.singleQuoteStrings = true;
+    return language;
+}
+
+CodeLanguage makeCppLanguage() {
+    CodeLanguage language;
+    language.keywords = keywordSet({
+        u"alignas", u"alignof", u"auto", u"bool", u"break", u"case", u"catch", u"char",
+        u"class", u"const", u"constexpr", u"const_cast", u"continue", u"decltype", u"default",
+        u"delete", u"do", u"double", u"dynamic_cast", u"else", u"enum", u"explicit", u"export",
+        u"extern", u"false", u"final", u"float", u"for", u"friend", u"goto", u"if", u"inline",
+        u"int", u"long", u"mutable", u"namespace", u"new", u"noexcept", u"nullptr", u"operator",
+        u"override", u"private", u"protected", u"public", u"register", u"reinterpret_cast",
+        u"return", u"short", u"signed", u"sizeof", u"static", u"static_assert", u"static_cast",
+        u"struct", u"switch", u"template", u"this", u"throw", u"true", u"try", u"typedef",
+        u"typename", u"union", u"unsigned", u"using", u"virtual", u"void", u"volatile",
+        u"while", u"NULL"
+    });
+    language.lineComment = u"//";
+    language.altLineComment = u"#";
+    language.blockComments = true;
+    language.singleQuoteStrings = true;
+    return language;
+}
+
+CodeLanguage makeCSharpLanguage() {
+    CodeLanguage language;
+    language.keywords = keywordSet({
+        u"abstract", u"as", u"async", u"await", u"base", u"bool", u"break", u"case", u"catch",
+        u"char", u"class", u"const", u"continue", u"decimal", u"default", u"delegate", u"do",
+        u"double", u"else", u"enum", u"event", u"explicit", u"false", u"finally", u"float",
+        u"for", u"foreach", u"get", u"if", u"implicit", u"in", u"int", u"interface", u"internal",
+        u"is", u"lock", u"long", u"namespace", u"new", u"null", u"object", u"out", u"override",
+        u"params", u"private", u"protected", u"public", u"readonly", u"record", u"ref",
+        u"return", u"sealed", u"set", u"static", u"string", u"struct", u"switch", u"this",
+        u"throw", u"true", u"try", u"typeof", u"using", u"var", u"virtual", u"void", u"while"
+    });
+    language.lineComment = u"//";
+    language.blockComments = true;
+    language.singleQuoteStrings = true;
+    return language;
+}
+
+CodeLanguage makeJavaLanguage() {
+    CodeLanguage language;
+    language.keywords = keywordSet({
+        u"abstract", u"boolean", u"break", u"byte", u"case", u"catch", u"char", u"class",
+        u"continue", u"default", u"do", u"double", u"else", u"enum", u"extends", u"false",
+        u"final", u"finally", u"float", u"for", u"if", u"implements", u"import", u"instanceof",
+        u"int", u"interface", u"long", u"new", u"null", u"package", u"private", u"protected",
+        u"public", u"record", u"return", u"short", u"static", u"super", u"switch",
+        u"synchronized", u"this", u"throw", u"throws", u"true", u"try", u"var", u"void",
+        u"volatile", u"while", u"fun", u"val", u"when", u"object"
+    });
+    language.lineComment = u"//";
+    language.blockComments = true;
+    language.singleQuoteStrings = true;
+    return language;
+}
+
+CodeLanguage makeJavaScriptLanguage() {
+    CodeLanguage language;
+    language.keywords = keywordSet({
+        u"abstract", u"any", u"as", u"async", u"await", u"boolean", u"break", u"case",
+        u"catch", u"class", u"const", u"continue", u"debugger", u"declare", u"default",
+        u"delete", u"do", u"else", u"enum", u"export", u"extends", u"false", u"finally",
+        u"for", u"from", u"function", u"if", u"implements", u"import", u"in", u"instanceof",
+        u"interface", u"let", u"new", u"null", u"number", u"of", u"private", u"protected",
+        u"public", u"readonly", u"return", u"static", u"string", u"super", u"switch", u"this",
+        u"throw", u"true", u"try", u"type", u"typeof", u"undefined", u"var", u"void",
+        u"while", u"yield"
+    });
+    language.lineComment = u"//";
+    language.blockComments = true;
+    language.singleQuoteStrings = true;
+    language.backtickStrings = true;
+    return language;
+}
+
+CodeLanguage makePythonLanguage() {
+    CodeLanguage language;
+    language.keywords = keywordSet({
+        u"and", u"as", u"assert", u"async", u"await", u"break", u"class", u"continue", u"def",
+        u"del", u"elif", u"else", u"except", u"False", u"finally", u"for", u"from", u"global",
+        u"if", u"import", u"in", u"is", u"lambda", u"match", u"case", u"None", u"nonlocal",
+        u"not", u"or", u"pass", u"raise", u"return", u"self", u"True", u"try", u"while",
+        u"with", u"yield"
+    });
+    language.lineComment = u"#";
+    language.singleQuoteStrings = true;
+    return language;
+}
+
+CodeLanguage makeGoLanguage() {
+    CodeLanguage language;
+    language.keywords = keywordSet({
+        u"break", u"case", u"chan", u"const", u"continue", u"default", u"defer", u"else",
+        u"fallthrough", u"false", u"for", u"func", u"go", u"goto", u"if", u"import",
+        u"interface", u"map", u"nil", u"package", u"range", u"return", u"select", u"struct",
+        u"switch", u"true", u"type", u"var"
+    });
+    language.lineComment = u"//";
+    language.blockComments = true;
+    language.singleQuoteStrings = true;
+    language.backtickStrings = true;
+    return language;
+}
+
+CodeLanguage makeRustLanguage() {
+    CodeLanguage language;
+    language.keywords = keywordSet({
+        u"as", u"async", u"await", u"break", u"const", u"continue", u"crate", u"dyn", u"else",
+        u"enum", u"extern", u"false", u"fn", u"for", u"if", u"impl", u"in", u"let", u"loop",
+        u"match", u"mod", u"move", u"mut", u"pub", u"ref", u"return", u"self", u"Self",
+        u"static", u"struct", u"super", u"trait", u"true", u"type", u"unsafe", u"use",
+        u"where", u"while"
+    });
+    language.lineComment = u"//";
+    language.blockComments = true;
+    return language;
+}
+
+CodeLanguage makeShellLanguage() {
+    CodeLanguage language;
+    language.keywords = keywordSet({
+        u"case", u"do", u"done", u"elif", u"else", u"esac", u"export", u"fi", u"for",
+        u"function", u"if", u"in", u"local", u"return", u"then", u"until", u"while",
+        u"echo", u"exit", u"set", u"unset"
+    });
+    language.lineComment = u"#";
+    language.singleQuoteStrings = true;
+    language.backtickStrings = true;
+    return language;
+}
+
+CodeLanguage makePowerShellLanguage() {
+    CodeLanguage language;
+    language.keywords = keywordSet({
+        u"begin", u"break", u"catch", u"class", u"continue", u"do", u"else", u"elseif", u"end",
+        u"exit", u"filter", u"finally", u"for", u"foreach", u"function", u"if", u"in",
+        u"param", u"process", u"return", u"switch", u"throw", u"trap", u"try", u"until",
+        u"while"
+    });
+    language.lineComment = u"#";
+    language.singleQuoteStrings = true;
+    language.caseInsensitiveKeywords = true;
+    return language;
+}
+
+CodeLanguage makeSqlLanguage() {
+    CodeLanguage language;
+    language.keywords = keywordSet({
+        u"add", u"all", u"alter", u"and", u"as", u"asc", u"between", u"by", u"case", u"create",
+        u"delete", u"desc", u"distinct", u"drop", u"else", u"end", u"exists", u"false", u"from",
+        u"group", u"having", u"in", u"index", u"inner", u"insert", u"into", u"is", u"join",
+        u"key", u"left", u"like", u"limit", u"not", u"null", u"offset", u"on", u"or", u"order",
+        u"outer", u"primary", u"right", u"select", u"set", u"table", u"then", u"true",
+        u"union", u"update", u"values", u"when", u"where", u"with"
+    });
+    language.lineComment = u"--";
+    language.blockComments = true;
+    language.singleQuoteStrings = true;
+    language.caseInsensitiveKeywords = true;
+    return language;
+}
+
+CodeLanguage makeJsonLanguage() {
+    CodeLanguage language;
+    language.keywords = keywordSet({u"true", u"false", u"null"});
+    return language;
+}
+
+const QHash<QString, const CodeLanguage *> &languageTable() {
+    static const CodeLanguage cpp = makeCppLanguage();
+    static const CodeLanguage csharp = makeCSharpLanguage();
+    static const CodeLanguage java = makeJavaLanguage();
+    static const CodeLanguage javascript = makeJavaScriptLanguage();
+    static const CodeLanguage python = makePythonLanguage();
+    static const CodeLanguage go = makeGoLanguage();
+    static const CodeLanguage rust = makeRustLanguage();
+    static const CodeLanguage shell = makeShellLanguage();
+    static const CodeLanguage powershell = makePowerShellLanguage();
+    static const CodeLanguage sql = makeSqlLanguage();
+    static const CodeLanguage json = makeJsonLanguage();
+    static const QHash<QString, const CodeLanguage *> table{
+        {"c", &cpp}, {"cpp", &cpp}, {"c++", &cpp}, {"cc", &cpp}, {"h", &cpp}, {"hpp", &cpp},
+        {"cs", &csharp}, {"c#", &csharp}, {"csharp", &csharp},
+        {"java", &java}, {"kotlin", &java}, {"kt", &java},
+        {"js", &javascript}, {"javascript", &javascript}, {"jsx", &javascript},
+        {"ts", &javascript}, {"typescript", &javascript}, {"tsx", &javascript},
+        {"py", &python}, {"python", &python},
+        {"go", &go}, {"golang", &go},
+        {"rs", &rust}, {"rust", &rust},
+        {"sh", &shell}, {"bash", &shell}, {"shell", &shell}, {"zsh", &shell},
+        {"ps1", &powershell}, {"powershell", &powershell}, {"pwsh", &powershell},
+        {"sql", &sql},
+        {"json", &json}
+    };
+    return table;
+}
+
+bool isIdentifierStart(QChar ch) {
+    return ch.isLetter() || ch == u'_' || ch == u'$';
+}
+
+bool isIdentifierPart(QChar ch) {
+    return ch.isLetterOrNumber() || ch == u'_' || ch == u'$';
+}
+
+bool startsWithAt(QStringView line, qsizetype pos, QStringView token) {
+    return !token.isEmpty() && line.mid(pos, token.size()) == token;
+}
+
+bool isKeyword(const CodeLanguage &language, QStringView word) {
+    if (!language.caseInsensitiveKeywords)
+        return language.keywords.contains(word);
+    if (word.size() > kMaxKeywordLength)
+        return false;
+    char16_t lowered[kMaxKeywordLength];
+    for (qsizetype i = 0; i < word.size(); ++i)
+        lowered[i] = word.at(i).toLower().unicode();
+    return language.keywords.contains(QStringView(lowered, word.size()));
+}
+
+void addToken(QList<CodeToken> *tokens, qsizetype start, qsizetype end, CodeTokenKind kind) {
+    tokens->append(CodeToken{static_cast<int>(start), static_cast<int>(end - start), kind});
+}
+}
+
+const CodeLanguage &CodeLexer::languageFor(const QString &name) {
+    static const CodeLanguage fallback = makeDefaultLanguage();
+    const QString key = name.trimmed().toLower();
+    if (key.isEmpty())
+        return fallback;
+    const QHash<QString, const CodeLanguage *> &table = languageTable();
+    const auto it = table.constFind(key);
+    return it != table.cend() ? **it : fallback;
+}
+
+int CodeLexer::tokenize(QStringView line,
+                        int previousState,
+                        const CodeLanguage &language,
+                        QList<CodeToken> *tokens) {
+    tokens->clear();
+    const qsizetype length = line.size();
+    qsizetype pos = 0;
+
+    if (previousState == BlockCommentState) {
+        const qsizetype end = line.indexOf(u"*/");
+        if (end < 0) {
+            addToken(tokens, 0, length, CodeTokenKind::Comment);
+            return BlockCommentState;
+        }
+        addToken(tokens, 0, end + 2, CodeTokenKind::Comment);
+        pos = end + 2;
+    }
+
+    while (pos < length) {
+        const QChar ch = line.at(pos);
+
+        if (language.blockComments && ch == u'/' && pos + 1 < length && line.at(pos + 1) == u'*') {
+            const qsizetype end = line.indexOf(u"*/", pos + 2);
+            if (end < 0) {
+                addToken(tokens, pos, length, CodeTokenKind::Comment);
+                return BlockCommentState;
+            }
+            addToken(tokens, pos, end + 2, CodeTokenKind::Comment);
+            pos = end + 2;
+            continue;
+        }
+
+        if (startsWithAt(line, pos, language.lineComment)
+            || startsWithAt(line, pos, language.altLineComment)) {
+            addToken(tokens, pos, length, CodeTokenKind::Comment);
+            break;
+        }
+
+        if (ch == u'"' || (ch == u'\'' && language.singleQuoteStrings)
+            || (ch == u'`' && language.backtickStrings)) {
+            qsizetype end = pos + 1;
+            while (end < length && line.at(end) != ch) {
+                if (line.at(end) == u'\\')
+                    ++end;
+                ++end;
+            }
+            end = qMin(end + 1, length);
+            addToken(tokens, pos, end, CodeTokenKind::String);
+            pos = end;
+            continue;
+        }
+
+        if (ch.isDigit()) {
+            qsizetype end = pos + 1;
+            while (end < length) {
+                const QChar next = line.at(end);
+                if (next.isLetterOrNumber() || next == u'_'
+                    || (next == u'.' && end + 1 < length && line.at(end + 1).isDigit())) {
+                    ++end;
+                    continue;
+                }
+                break;
+            }
+            addToken(tokens, pos, end, CodeTokenKind::Number);
+            pos = end;
+            continue;
+        }
+
+        if (isIdentifierStart(ch)) {
+            qsizetype end = pos + 1;
+            while (end < length && isIdentifierPart(line.at(end)))
+                ++end;
+            if (isKeyword(language, line.mid(pos, end - pos)))
+                addToken(tokens, pos, end, CodeTokenKind::Keyword);
+            pos = end;
+            continue;
+        }
+
+        ++pos;
+    }
+    return NormalState;
+}
@@ -0,0 +1,48 @@
+#ifndef CODELEXER_H
+#define CODELEXER_H
+
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QStringView>
+
+enum class CodeTokenKind {
+    Keyword,
+    String,
+    Number,
+    Comment
+};
+
+struct CodeToken {
+    int start = 0;
+    int length = 0;
+    CodeTokenKind kind = CodeTokenKind::Keyword;
+};
+
+struct CodeLanguage {
+    QSet<QStringView> keywords;
+    QStringView lineComment;
+    QStringView altLineComment;
+    bool blockComments = false;
+    bool singleQuoteStrings = false;
+    bool backtickStrings = false;
+    bool caseInsensitiveKeywords = false;
+};
+
+// Table-driven lexer that produces keyword, string, number and comment
+// tokens for one line of code in a single left-to-right scan.
+class CodeLexer {
+public:
+    enum LineState {
+        NormalState = 0,
+        BlockCommentState = 1
+    };
+
+    static const CodeLanguage &languageFor(const QString &name);
+    static int tokenize(QStringView line,
+                        int previousState,
+                        const CodeLanguage &language,
+                        QList<CodeToken> *tokens);
+};
+
+#endif // CODELEXER_H
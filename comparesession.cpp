@@ -0,0 +1,207 @@
+#include "comparesession.h"
+#include "modelstats.h"
+#include "perflog.h"
+#include "transcriptrenderer.h"
+
+#include <QFont>
+#include <QLabel>
+#include <QNetworkReply>
+#include <QScrollBar>
+#include <QSplitter>
+#include <QTextBrowser>
+#include <QTextDocument>
+#include <QTimer>
+#include <QVBoxLayout>
+
+#include <utility>
+
+CompareSession::CompareSession(const QStringList &modelNames, const QList<ChatMessage> &history,
+                               int renderIntervalMs, SendFunction send, AbortFunction abort,
+                               EstimateFunction estimate, QObject *parent)
+    : QObject(parent)
+    , renderTimer(new QTimer(this))
+    , renderIntervalMs(renderIntervalMs)
+    , send(std::move(send))
+    , abortRequest(std::move(abort))
+    , estimate(std::move(estimate)) {
+    for (const QString &model : modelNames) {
+        Stream stream;
+        stream.modelName = model;
+        stream.history = history;
+        streams.append(stream);
+    }
+    renderTimer->setSingleShot(true);
+    connect(renderTimer, &QTimer::timeout, this, &CompareSession::renderPanes);
+}
+
+QWidget *CompareSession::createColumn(QWidget *parent, QTextBrowser *view, QLabel **statsLabel) {
+    auto *column = new QWidget(parent);
+    auto *columnLayout = new QVBoxLayout(column);
+    columnLayout->setContentsMargins(0, 0, 0, 0);
+    columnLayout->setSpacing(2);
+    auto *label = new QLabel(column);
+    label->setStyleSheet("QLabel { color: #505050; }");
+    columnLayout->addWidget(label);
+    view->setParent(column);
+    columnLayout->addWidget(view, 1);
+    *statsLabel = label;
+    return column;
+}
+
+void CompareSession::addPanes(QSplitter *splitter, const QFont &font) {
+    for (Stream &stream : streams) {
+        auto *view = new QTextBrowser(splitter);
+        view->setFont(font);
+        view->document()->setDefaultFont(font);
+        view->setReadOnly(true);
+        view->setOpenExternalLinks(true);
+        view->setStyleSheet("QTextBrowser { background-color: #ffffff; }");
+        QLabel *statsLabel = nullptr;
+        splitter->addWidget(createColumn(splitter, view, &statsLabel));
+        stream.view = view;
+        stream.renderer = new TranscriptRenderer(view->document());
+        stream.statsLabel = statsLabel;
+        stream.dirty = true;
+    }
+}
+
+void CompareSession::setRenderInterval(int intervalMs) {
+    renderIntervalMs = intervalMs;
+}
+
+void CompareSession::sendRequests() {
+    for (Stream &stream : streams) {
+        if (stream.inFlight)
+            continue;
+        stream.transcript.clearPending();
+        stream.firstTokenMs = -1;
+        stream.completionTokens = 0;
+        stream.clock.start();
+        stream.requestId = send(stream.modelName, stream.history);
+        stream.inFlight = stream.requestId != 0;
+        stream.dirty = true;
+    }
+    renderTimer->start(renderIntervalMs);
+}
+
+void CompareSession::sendFollowUp(const QString &text) {
+    for (Stream &stream : streams) {
+        ChatMessage message{QStringLiteral("user"), text};
+        message.estimatedTokens = estimate(message);
+        stream.history.append(message);
+        stream.transcript.appendBlock(TranscriptStore::userMessageBlock(text));
+    }
+    sendRequests();
+}
+
+bool CompareSession::inFlight() const {
+    for (const Stream &stream : streams) {
+        if (stream.inFlight)
+            return true;
+    }
+    return false;
+}
+
+void CompareSession::abort() {
+    for (const Stream &stream : streams) {
+        if (stream.inFlight)
+            abortRequest(stream.requestId);
+    }
+}
+
+bool CompareSession::handleBatch(int requestId, const StreamBatch &batch) {
+    const int index = indexFor(requestId);
+    if (index < 0)
+        return false;
+    Stream &stream = streams[index];
+    if (!batch.text.isEmpty()) {
+        if (stream.firstTokenMs < 0)
+            stream.firstTokenMs = stream.clock.elapsed();
+        stream.transcript.appendPending(batch.text);
+    }
+    if (!batch.errorMessage.isEmpty())
+        stream.transcript.appendPending(QStringLiteral("\n\n*%1*").arg(batch.errorMessage));
+    if (batch.hasUsage)
+        stream.completionTokens = batch.usage.completionTokens;
+    stream.dirty = true;
+    if (!renderTimer->isActive())
+        renderTimer->start(renderIntervalMs);
+    return true;
+}
+
+bool CompareSession::handleFinished(int requestId, int error, const QString &errorString, int statusCode) {
+    const int index = indexFor(requestId);
+    if (index < 0)
+        return false;
+    Stream &stream = streams[index];
+    stream.inFlight = false;
+    if (error == QNetworkReply::OperationCanceledError) {
+        stream.transcript.appendPending(QStringLiteral("\n\n*Response canceled*"));
+    } else if (error != QNetworkReply::NoError) {
+        stream.transcript.appendPending(QStringLiteral("\n\n*Request failed (%1): HTTP status %2*")
+                                            .arg(errorString)
+                                            .arg(statusCode));
+    } else {
+        ChatMessage message{QStringLiteral("assistant"), stream.transcript.pending()};
+        message.estimatedTokens = estimate(message);
+        if (!message.content.trimmed().isEmpty())
+            stream.history.append(message);
+    }
+    if (stream.completionTokens == 0)
+        stream.completionTokens = ContextBudget::estimateTokens(stream.transcript.pending());
+    // Cancels say nothing about the model's speed
+    if (error != QNetworkReply::OperationCanceledError) {
+        ModelStatsStore::instance()->recordStream(stream.modelName, stream.firstTokenMs, stream.clock.elapsed(),
+                                                  stream.completionTokens, error != QNetworkReply::NoError);
+    }
+    qCDebug(lcPerf) << "compare stream" << stream.modelName << "first token after"
+                    << stream.firstTokenMs << "ms, finished after" << stream.clock.elapsed() << "ms,"
+                    << stream.completionTokens << "tokens";
+    const QString reply = TranscriptStore::normalizedBlock(stream.transcript.takePending());
+    if (!reply.trimmed().isEmpty())
+        stream.transcript.appendBlock(reply);
+    stream.dirty = true;
+    renderPanes();
+    emit streamFinished();
+    return true;
+}
+
+int CompareSession::indexFor(int requestId) const {
+    if (requestId == 0)
+        return -1;
+    for (int i = 0; i < streams.size(); ++i) {
+        if (streams.at(i).inFlight && streams.at(i).requestId == requestId)
+            return i;
+    }
+    return -1;
+}
+
+void CompareSession::renderPanes() {
+    for (Stream &stream : streams) {
+        if (!stream.dirty)
+            continue;
+        stream.dirty = false;
+        if (stream.statsLabel) {
+            const int tokens = stream.completionTokens > 0
+                ? stream.completionTokens
+                : ContextBudget::estimateTokens(stream.transcript.pending());
+            stream.statsLabel->setText(streamStatsText(stream.modelName, stream.firstTokenMs,
+                                                       stream.clock.elapsed(), tokens));
+        }
+        if (!stream.view || !stream.renderer)
+            continue;
+        QScrollBar *bar = stream.view->verticalScrollBar();
+        const bool atBottom = !bar || bar->value() >= bar->maximum() - 4;
+        stream.renderer->render(stream.transcript);
+        if (atBottom && bar)
+            bar->setValue(bar->maximum());
+    }
+    if (inFlight() && !renderTimer->isActive()) {
+        for (const Stream &stream : streams) {
+            if (stream.dirty) {
+                renderTimer->start(renderIntervalMs);
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef COMPARESESSION_H
+#define COMPARESESSION_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+
+#include "contextbudget.h"
+#include "llmclient.h"
+#include "transcriptstore.h"
+
+class QFont;
+class QLabel;
+class QSplitter;
+class QTextBrowser;
+class QTimer;
+class QWidget;
+class TranscriptRenderer;
+
+// Extra models that answer the same conversation next to the task's own
+// model, one pane each. Every stream keeps its own history so follow-ups
+// continue each thread. The owning window sends the requests and routes the
+// batches and finishes of this session's requests here; panes are repainted
+// on a timer so bursts of small deltas cost one layout.
+class CompareSession : public QObject {
+    Q_OBJECT
+
+public:
+    // Sends a stream's history to modelName; returns the request id, 0 when
+    // nothing was sent
+    using SendFunction = std::function<int(const QString &modelName, const QList<ChatMessage> &history)>;
+    using AbortFunction = std::function<void(int requestId)>;
+    // Token count cached on every message added to a history
+    using EstimateFunction = std::function<int(const ChatMessage &message)>;
+
+    CompareSession(const QStringList &modelNames, const QList<ChatMessage> &history, int renderIntervalMs,
+                   SendFunction send, AbortFunction abort, EstimateFunction estimate,
+                   QObject *parent = nullptr);
+
+    // Column with a stats label above view, shared with the primary pane
+    static QWidget *createColumn(QWidget *parent, QTextBrowser *view, QLabel **statsLabel);
+
+    // Adds one pane per model to splitter
+    void addPanes(QSplitter *splitter, const QFont &font);
+    // Follows the refresh rate of the screen the panes ended up on
+    void setRenderInterval(int intervalMs);
+    // Sends every stream that is not already waiting for a reply
+    void sendRequests();
+    void sendFollowUp(const QString &text);
+    bool inFlight() const;
+    void abort();
+
+    // Both return false for requests that are not this session's
+    bool handleBatch(int requestId, const StreamBatch &batch);
+    bool handleFinished(int requestId, int error, const QString &errorString, int statusCode);
+
+signals:
+    // A stream got its last reply, so the conversation may be idle now
+    void streamFinished();
+
+private:
+    struct Stream {
+        QString modelName;
+        QList<ChatMessage> history;
+        TranscriptStore transcript;
+        int requestId = 0;
+        bool inFlight = false;
+        bool dirty = false;
+        QElapsedTimer clock;
+        qint64 firstTokenMs = -1;
+        int completionTokens = 0;
+        QPointer<QTextBrowser> view;
+        QPointer<TranscriptRenderer> renderer;
+        QPointer<QLabel> statsLabel;
+    };
+
+    QList<Stream> streams;
+    QTimer *renderTimer;
+    int renderIntervalMs;
+    SendFunction send;
+    AbortFunction abortRequest;
+    EstimateFunction estimate;
+
+    int indexFor(int requestId) const;
+    void renderPanes();
+};
+
+#endif // COMPARESESSION_H
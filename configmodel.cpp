@@ -0,0 +1,65 @@
+#include "configmodel.h"
+
+ConfigModel::ConfigModel(QObject *parent)
+    : QObject(parent) {
+}
+
+AppConfig ConfigModel::snapshot() const {
+    return config;
+}
+
+const AppSettings &ConfigModel::settings() const {
+    return config.settings;
+}
+
+int ConfigModel::taskCount() const {
+    return static_cast<int>(config.tasks.size());
+}
+
+const TaskDefinition &ConfigModel::task(int index) const {
+    return config.tasks.at(index);
+}
+
+int ConfigModel::indexOfTask(const QString &id) const {
+    if (id.isEmpty())
+        return -1;
+    for (int i = 0; i < config.tasks.size(); ++i) {
+        if (config.tasks.at(i).id == id)
+            return i;
+    }
+    return -1;
+}
+
+void ConfigModel::reset(const AppConfig &newConfig) {
+    config = newConfig;
+    emit changed();
+}
+
+void ConfigModel::setSettings(const AppSettings &settings) {
+    config.settings = settings;
+    emit changed();
+}
+
+void ConfigModel::setTask(int index, const TaskDefinition &task) {
+    if (index < 0 || index >= config.tasks.size())
+        return;
+    config.tasks[index] = task;
+    emit changed();
+}
+
+void ConfigModel::insertTask(int index, const TaskDefinition &task) {
+    config.tasks.insert(qBound(0, index, taskCount()), task);
+    emit changed();
+}
+
+void ConfigModel::removeTask(int index) {
+    if (index < 0 || index >= config.tasks.size())
+        return;
+    config.tasks.removeAt(index);
+    emit changed();
+}
+
+void ConfigModel::setTasks(const QList<TaskDefinition> &tasks) {
+    config.tasks = tasks;
+    emit changed();
+}
@@ -0,0 +1,40 @@
+#ifndef CONFIGMODEL_H
+#define CONFIGMODEL_H
+
+#include <QObject>
+
+#include "configstore.h"
+
+// The authoritative in-memory config. Settings widgets push their edits here
+// as they happen, so readers never walk the widgets. Snapshots are plain
+// AppConfig copies; the lists and strings inside are implicitly shared, so a
+// copy costs a few reference count bumps however long the prompts are.
+class ConfigModel : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ConfigModel(QObject *parent = nullptr);
+
+    AppConfig snapshot() const;
+    const AppSettings &settings() const;
+    int taskCount() const;
+    const TaskDefinition &task(int index) const;
+    // -1 when no task has that id
+    int indexOfTask(const QString &id) const;
+
+    // Replaces everything, e.g. after loading or importing a file
+    void reset(const AppConfig &config);
+    void setSettings(const AppSettings &settings);
+    void setTask(int index, const TaskDefinition &task);
+    void insertTask(int index, const TaskDefinition &task);
+    void removeTask(int index);
+    void setTasks(const QList<TaskDefinition> &tasks);
+
+signals:
+    void changed();
+
+private:
+    AppConfig config;
+};
+
+#endif // CONFIGMODEL_H
@@ -0,0 +1,86 @@
+#include "configpersistence.h"
+#include "backgroundwriter.h"
+#include "perflog.h"
+
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include <utility>
+
+namespace {
+// Long enough to cover a burst of typing, short enough that a crash loses little
+constexpr int kQuietPeriodMs = 750;
+}
+
+ConfigPersistence::ConfigPersistence(const QString &path, SnapshotProvider snapshot, QObject *parent)
+    : QObject(parent)
+    , filePath(path)
+    , snapshotProvider(std::move(snapshot))
+    , writer(BackgroundWriter::instance())
+    , quietTimer(new QTimer(this))
+    , dirty(false)
+    , coalescedEdits(0)
+    , writes(0) {
+    quietTimer->setSingleShot(true);
+    quietTimer->setInterval(kQuietPeriodMs);
+    connect(quietTimer, &QTimer::timeout, this, [this]() {
+        writeSnapshot(false);
+    });
+}
+
+ConfigPersistence::~ConfigPersistence() {
+    // The snapshot provider may already be gone here, so pending edits are
+    // only written by an explicit flush(). Saves already posted still count
+    // on this object.
+    writer->waitForIdle();
+}
+
+void ConfigPersistence::markDirty() {
+    dirty = true;
+    ++coalescedEdits;
+    quietTimer->start();
+}
+
+bool ConfigPersistence::isDirty() const {
+    return dirty;
+}
+
+int ConfigPersistence::writeCount() const {
+    return writes.load();
+}
+
+void ConfigPersistence::flush() {
+    quietTimer->stop();
+    if (dirty) {
+        writeSnapshot(true);
+        return;
+    }
+    // Nothing new to write, but an earlier save may still be queued
+    writer->waitForIdle();
+}
+
+void ConfigPersistence::writeSnapshot(bool wait) {
+    if (!dirty || !snapshotProvider)
+        return;
+    dirty = false;
+    qCDebug(lcPerf) << "config save coalesced" << coalescedEdits << "edits";
+    coalescedEdits = 0;
+
+    const AppConfig config = snapshotProvider();
+    const QString path = filePath;
+    std::atomic<int> *counter = &writes;
+    writer->post([path, config, counter]() {
+        QElapsedTimer timer;
+        timer.start();
+        if (!ConfigStore::saveToFile(path, config)) {
+            qCDebug(lcPerf) << "config save to" << path << "failed";
+            return false;
+        }
+        const int count = ++*counter;
+        qCDebug(lcPerf) << "config written in" << timer.elapsed() << "ms, write" << count;
+        return true;
+    });
+    // Queued saves run in order, so this also waits for any still in flight
+    if (wait)
+        writer->waitForIdle();
+}
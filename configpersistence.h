@@ -0,0 +1,47 @@
+#ifndef CONFIGPERSISTENCE_H
+#define CONFIGPERSISTENCE_H
+
+#include <QObject>
+#include <QString>
+
+#include <atomic>
+#include <functional>
+
+#include "configstore.h"
+
+class BackgroundWriter;
+class QTimer;
+
+// Coalesces settings edits into one write after a quiet period. The snapshot
+// callback runs on the GUI thread only when a write is due, so keystrokes just
+// restart a timer. Call flush() before the widgets behind the snapshot go away.
+class ConfigPersistence : public QObject {
+    Q_OBJECT
+
+public:
+    using SnapshotProvider = std::function<AppConfig()>;
+
+    ConfigPersistence(const QString &path, SnapshotProvider snapshot, QObject *parent = nullptr);
+    ~ConfigPersistence() override;
+
+    void markDirty();
+    bool isDirty() const;
+    // Disk writes completed so far, for checking how well edits coalesce
+    int writeCount() const;
+
+public slots:
+    void flush();
+
+private:
+    QString filePath;
+    SnapshotProvider snapshotProvider;
+    BackgroundWriter *writer;
+    QTimer *quietTimer;
+    bool dirty;
+    int coalescedEdits;
+    std::atomic<int> writes;
+
+    void writeSnapshot(bool wait);
+};
+
+#endif // CONFIGPERSISTENCE_H
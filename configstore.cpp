@@ -8,6 +8,7 @@
 #include <QJsonParseError>
 #include <QSaveFile>
 #include <QStandardPaths>
+#include <QUuid>
 
 namespace {
 constexpr const char kDefaultModelName[] = "Default";
@@ -20,33 +21,49 @@ QString normalizeModelName(const QString &value) {
 
 TaskDefinition taskFromJson(const QJsonObject &obj) {
     TaskDefinition task;
+    task.id = obj.value("id").toString();
+    if (task.id.isEmpty())
+        task.id = ConfigStore::newTaskId();
     task.name = obj.value("name").toString();
     task.prompt = obj.value("prompt").toString();
     task.modelName = normalizeModelName(obj.value("modelName").toString());
     task.insertMode = obj.value("insert").toBool(true);
+    const QJsonArray compareArray = obj.value("compareModels").toArray();
+    for (const QJsonValue &value : compareArray) {
+        const QString model = normalizeModelName(value.toString());
+        if (!model.isEmpty())
+            task.compareModels.append(model);
+    }
     task.maxTokens = obj.value("maxTokens").toInt(300);
+    task.contextBudget = obj.value("contextBudget").toInt(0);
     task.temperature = obj.value("temperature").toDouble(0.5);
     const int width = obj.value("responseWidth").toInt(600);
     const int height = obj.value("responseHeight").toInt(200);
     task.responseWidth = width > 0 ? width : 600;
     task.responseHeight = height > 0 ? height : 200;
     task.responseZoom = obj.value("responseZoom").toInt(0);
+    task.useCount = qMax(0, obj.value("useCount").toInt(0));
     return task;
 }
 
 QJsonObject taskToJson(const TaskDefinition &task) {
     QJsonObject obj{
+        {"id", task.id},
         {"name", task.name},
         {"prompt", task.prompt},
         {"insert", task.insertMode},
         {"maxTokens", task.maxTokens},
+        {"contextBudget", task.contextBudget},
         {"temperature", task.temperature},
         {"responseWidth", task.responseWidth},
         {"responseHeight", task.responseHeight},
-        {"responseZoom", task.responseZoom}
+        {"responseZoom", task.responseZoom},
+        {"useCount", task.useCount}
     };
     if (!task.modelName.isEmpty())
         obj.insert("modelName", task.modelName);
+    if (!task.compareModels.isEmpty())
+        obj.insert("compareModels", QJsonArray::fromStringList(task.compareModels));
     return obj;
 }
 } // namespace
@@ -59,6 +76,10 @@ QString ConfigStore::configFilePath() {
     return configDir + QDir::separator() + "config.json";
 }
 
+QString ConfigStore::newTaskId() {
+    return QUuid::createUuid().toString(QUuid::WithoutBraces);
+}
+
 AppConfig ConfigStore::defaultConfig() {
     AppConfig config;
     config.settings.apiEndpoint = "https://api.openai.com/v1/";
@@ -69,6 +90,7 @@ AppConfig ConfigStore::defaultConfig() {
     config.settings.maxChars = 1000;
 
     TaskDefinition task;
+    task.id = newTaskId();
     task.name = QString::fromUtf8("\xF0\x9F\xA7\xA0 Explane");
     task.prompt = "Explain the meaning of what will be written. The explanation should be brief, in 1-4 sentences.";
     task.insertMode = false;
@@ -95,6 +117,18 @@ AppConfig ConfigStore::fromJson(const QJsonDocument &doc, bool *ok) {
     config.settings.proxy = settings.value("proxy").toString();
     config.settings.hotkey = settings.value("hotkey").toString();
     config.settings.maxChars = settings.value("maxChars").toInt();
+    config.settings.renderIntervalMs = qMax(0, settings.value("renderIntervalMs").toInt(0));
+    config.settings.speculativePrefetch = settings.value("speculativePrefetch").toBool(false);
+    config.settings.maxParallelRequests = qMax(0, settings.value("maxParallelRequests").toInt(3));
+    config.settings.streamingInsert = settings.value("streamingInsert").toBool(false);
+    config.settings.tokenizerVocabularyPath = settings.value("tokenizerVocabularyPath").toString();
+    config.settings.maxInputTokens = qMax(0, settings.value("maxInputTokens").toInt(0));
+    config.settings.chunkLongSelections = settings.value("chunkLongSelections").toBool(false);
+    config.settings.maxParallelChunks = qMax(0, settings.value("maxParallelChunks").toInt(3));
+    config.settings.chunkReducePass = settings.value("chunkReducePass").toBool(false);
+    config.settings.responseCache = settings.value("responseCache").toBool(true);
+    config.settings.cacheAllTemperatures = settings.value("cacheAllTemperatures").toBool(false);
+    config.settings.responseCacheSizeMb = qMax(0, settings.value("responseCacheSizeMb").toInt(20));
 
     const QJsonArray tasksArray = root.value("tasks").toArray();
     for (const QJsonValue &value : tasksArray) {
@@ -114,7 +148,19 @@ QJsonDocument ConfigStore::toJson(const AppConfig &config) {
         {"apiKey", config.settings.apiKey},
         {"proxy", config.settings.proxy},
         {"hotkey", config.settings.hotkey},
-        {"maxChars", config.settings.maxChars}
+        {"maxChars", config.settings.maxChars},
+        {"renderIntervalMs", config.settings.renderIntervalMs},
+        {"speculativePrefetch", config.settings.speculativePrefetch},
+        {"maxParallelRequests", config.settings.maxParallelRequests},
+        {"streamingInsert", config.settings.streamingInsert},
+        {"tokenizerVocabularyPath", config.settings.tokenizerVocabularyPath},
+        {"maxInputTokens", config.settings.maxInputTokens},
+        {"chunkLongSelections", config.settings.chunkLongSelections},
+        {"maxParallelChunks", config.settings.maxParallelChunks},
+        {"chunkReducePass", config.settings.chunkReducePass},
+        {"responseCache", config.settings.responseCache},
+        {"cacheAllTemperatures", config.settings.cacheAllTemperatures},
+        {"responseCacheSizeMb", config.settings.responseCacheSizeMb}
     };
 
     QJsonArray tasksArray;
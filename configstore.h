@@ -4,6 +4,7 @@
 #include <QJsonDocument>
 #include <QList>
 #include <QString>
+#include <QStringList>
 
 struct AppSettings {
     QString apiEndpoint;
@@ -12,18 +13,38 @@ struct AppSettings {
     QString proxy;
     QString hotkey;
     int maxChars = 0;
+    int renderIntervalMs = 0;
+    bool speculativePrefetch = false;
+    int maxParallelRequests = 3;
+    bool streamingInsert = false;
+    QString tokenizerVocabularyPath;
+    int maxInputTokens = 0;
+    bool chunkLongSelections = false;
+    int maxParallelChunks = 3;
+    bool chunkReducePass = false;
+    bool responseCache = true;
+    bool cacheAllTemperatures = false;
+    int responseCacheSizeMb = 20;
 };
 
 struct TaskDefinition {
+    // Stable across renames and reorders; generated when a task is created
+    // or loaded without one
+    QString id;
     QString name;
     QString prompt;
     QString modelName;
     bool insertMode = true;
+    // Window-mode tasks also stream these models' answers side by side
+    QStringList compareModels;
     int maxTokens = 300;
+    // Estimated prompt tokens sent with follow-ups, 0 for no limit
+    int contextBudget = 0;
     double temperature = 0.5;
     int responseWidth = 600;
     int responseHeight = 200;
     int responseZoom = 0;
+    int useCount = 0;
 };
 
 struct AppConfig {
@@ -34,6 +55,7 @@ struct AppConfig {
 class ConfigStore {
 public:
     static QString configFilePath();
+    static QString newTaskId();
     static AppConfig defaultConfig();
     static AppConfig fromJson(const QJsonDocument &doc, bool *ok = nullptr);
     static QJsonDocument toJson(const AppConfig &config);
@@ -0,0 +1,117 @@
+#include "contextbudget.h"
+#include "bpetokenizer.h"
+
+namespace {
+// Roughly what chat templates add around every message
+constexpr int kMessageOverheadTokens = 4;
+// BPE vocabularies average about four UTF-8 bytes per token
+constexpr int kBytesPerToken = 4;
+constexpr int kMinElidedChars = 200;
+const QString kElisionMarker = QStringLiteral("\n\n[...]\n\n");
+
+// Messages up to and including the original selection are never trimmed
+int pinnedCount(const QList<ChatMessage> &messages) {
+    for (int i = 0; i < messages.size(); ++i) {
+        if (messages.at(i).role == QLatin1String("user"))
+            return i + 1;
+    }
+    return qMin(1, static_cast<int>(messages.size()));
+}
+
+// UTF-8 size of the code point at index; *units gets its UTF-16 length
+int utf8Width(QStringView text, qsizetype index, int *units) {
+    const char16_t unit = text.at(index).unicode();
+    *units = 1;
+    if (unit < 0x80)
+        return 1;
+    if (unit < 0x800)
+        return 2;
+    if (QChar::isHighSurrogate(unit) && index + 1 < text.size()) {
+        *units = 2;
+        return 4;
+    }
+    return 3;
+}
+
+// Moves a cut position off the middle of a surrogate pair
+qsizetype characterBoundary(const QString &text, qsizetype position) {
+    if (position > 0 && position < text.size() && text.at(position).isLowSurrogate())
+        return position - 1;
+    return position;
+}
+
+QString elideMiddle(const QString &text, int keepChars) {
+    if (text.size() <= keepChars)
+        return text;
+    const qsizetype head = characterBoundary(text, keepChars / 2);
+    const qsizetype tail = characterBoundary(text, text.size() - (keepChars - keepChars / 2));
+    return text.left(head) + kElisionMarker + text.mid(tail);
+}
+}
+
+int ContextBudget::estimateTokens(QStringView text) {
+    // Counts UTF-8 bytes without converting the string
+    qsizetype bytes = 0;
+    int units = 1;
+    for (qsizetype i = 0; i < text.size(); i += units)
+        bytes += utf8Width(text, i, &units);
+    return static_cast<int>((bytes + kBytesPerToken - 1) / kBytesPerToken);
+}
+
+QString ContextBudget::truncateToEstimate(const QString &text, int maxTokens) {
+    if (maxTokens <= 0)
+        return text;
+    const qsizetype maxBytes = static_cast<qsizetype>(maxTokens) * kBytesPerToken;
+    qsizetype bytes = 0;
+    int units = 1;
+    for (qsizetype i = 0; i < text.size(); i += units) {
+        bytes += utf8Width(text, i, &units);
+        if (bytes > maxBytes)
+            return text.left(i);
+    }
+    return text;
+}
+
+int ContextBudget::estimateMessageTokens(const ChatMessage &message, const BpeTokenizer *tokenizer) {
+    if (message.estimatedTokens > 0)
+        return message.estimatedTokens;
+    const int contentTokens = tokenizer ? tokenizer->count(message.content) : estimateTokens(message.content);
+    return contentTokens + kMessageOverheadTokens;
+}
+
+ContextBudgetResult ContextBudget::fit(const QList<ChatMessage> &history,
+                                       int budgetTokens,
+                                       const BpeTokenizer *tokenizer) {
+    ContextBudgetResult result;
+    result.messages = history;
+    for (const ChatMessage &message : history)
+        result.estimatedTokens += estimateMessageTokens(message, tokenizer);
+    if (budgetTokens <= 0 || result.estimatedTokens <= budgetTokens)
+        return result;
+
+    QList<ChatMessage> &messages = result.messages;
+    const int pinned = pinnedCount(messages);
+
+    // Drop whole assistant/user turns so roles keep alternating
+    while (result.estimatedTokens > budgetTokens && messages.size() - pinned >= 3) {
+        result.estimatedTokens -= estimateMessageTokens(messages.at(pinned), tokenizer);
+        result.estimatedTokens -= estimateMessageTokens(messages.at(pinned + 1), tokenizer);
+        messages.remove(pinned, 2);
+        result.droppedMessages += 2;
+    }
+
+    if (result.estimatedTokens > budgetTokens && messages.size() - pinned >= 2) {
+        ChatMessage &oldest = messages[pinned];
+        const int oldestTokens = estimateMessageTokens(oldest, tokenizer);
+        const int available = budgetTokens - (result.estimatedTokens - oldestTokens);
+        const int keepChars = qMax(kMinElidedChars, available * kBytesPerToken);
+        if (keepChars < oldest.content.size()) {
+            oldest.content = elideMiddle(oldest.content, keepChars);
+            oldest.estimatedTokens = 0;
+            oldest.estimatedTokens = estimateMessageTokens(oldest, tokenizer);
+            result.estimatedTokens += oldest.estimatedTokens - oldestTokens;
+            result.elided = true;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,43 @@
+#ifndef CONTEXTBUDGET_H
+#define CONTEXTBUDGET_H
+
+#include <QList>
+#include <QString>
+#include <QStringView>
+
+class BpeTokenizer;
+
+struct ChatMessage {
+    QString role;
+    QString content;
+    // Cached token estimate, 0 until computed
+    int estimatedTokens = 0;
+};
+
+struct ContextBudgetResult {
+    QList<ChatMessage> messages;
+    int estimatedTokens = 0;
+    int droppedMessages = 0;
+    bool elided = false;
+};
+
+// Keeps the messages sent with a request within a per-task token budget.
+// The system prompt and the original selection are pinned; the oldest
+// follow-up turns are dropped first and the oldest kept reply is elided
+// when dropping alone is not enough. The newest message is always sent.
+// Counts are exact when a tokenizer vocabulary is loaded and estimated
+// from the UTF-8 size otherwise.
+class ContextBudget {
+public:
+    static int estimateTokens(QStringView text);
+    // Prefix of text whose estimate fits into maxTokens, cut between characters
+    static QString truncateToEstimate(const QString &text, int maxTokens);
+    static int estimateMessageTokens(const ChatMessage &message,
+                                     const BpeTokenizer *tokenizer = nullptr);
+    // budgetTokens <= 0 means no limit
+    static ContextBudgetResult fit(const QList<ChatMessage> &history,
+                                   int budgetTokens,
+                                   const BpeTokenizer *tokenizer = nullptr);
+};
+
+#endif // CONTEXTBUDGET_H
@@ -0,0 +1,104 @@
+#include "conversationmanager.h"
+#include "llmclient.h"
+#include "perflog.h"
+#include "responsecache.h"
+#include "taskwindow.h"
+
+#include <QCursor>
+#include <QJsonDocument>
+#include <QTimer>
+
+namespace {
+// Leave the UI to the conversation that was just started before rebuilding
+constexpr int kRebuildDelayMs = 1000;
+
+QByteArray menuKeyFor(const AppConfig &config) {
+    // Buttons only depend on task names; the rest of each task is refreshed
+    // on popup, so edits to prompts, use counts or window sizes keep the menu
+    AppConfig layout;
+    layout.settings = config.settings;
+    for (const TaskDefinition &task : config.tasks) {
+        TaskDefinition named;
+        named.name = task.name;
+        layout.tasks.append(named);
+    }
+    return ConfigStore::toJson(layout).toJson(QJsonDocument::Compact);
+}
+}
+
+ConversationManager::ConversationManager(LlmClient *client, ResponseCache *cache,
+                                         ConfigProvider config, QObject *parent)
+    : QObject(parent)
+    , client(client)
+    , cache(cache)
+    , configProvider(std::move(config)) {
+}
+
+void ConversationManager::prepareMenu(const AppConfig &config) {
+    ensureMenu(config);
+}
+
+void ConversationManager::openMenu(const AppConfig &config, const QElapsedTimer &hotkeyClock) {
+    client->setMaxInFlight(config.settings.maxParallelRequests);
+    cache->setMaxBytes(static_cast<qint64>(config.settings.responseCacheSizeMb) * 1024 * 1024);
+    // The user is still picking a task, so open the connection meanwhile
+    client->warmUp(config.settings.apiEndpoint, config.settings.proxy);
+
+    const bool built = ensureMenu(config);
+    menuWindow->refreshTasks(config.tasks);
+    menuWindow->popupAt(QCursor::pos(), hotkeyClock);
+    qCDebug(lcPerf) << "menu" << (built ? "built on hotkey" : "reused") << "with"
+                    << conversationCount() << "conversations alive";
+}
+
+bool ConversationManager::ensureMenu(const AppConfig &config) {
+    pruneConversations();
+    if (menuWindow && menuWindow->hasConversation()) {
+        conversations.append(menuWindow);
+        menuWindow = nullptr;
+    }
+
+    const QByteArray key = menuKeyFor(config);
+    if (menuWindow && key == menuConfigKey)
+        return false;
+    if (menuWindow)
+        menuWindow->close();
+
+    menuWindow = new TaskWindow(config.tasks, config.settings, client, cache);
+    menuConfigKey = key;
+    connect(menuWindow, &TaskWindow::taskResponsePrefsChanged,
+            this, &ConversationManager::taskResponsePrefsChanged);
+    connect(menuWindow, &TaskWindow::taskResponsePrefsCommitRequested,
+            this, &ConversationManager::taskResponsePrefsCommitRequested);
+    connect(menuWindow, &TaskWindow::taskUsed,
+            this, &ConversationManager::taskUsed);
+    // The picked menu turns into a conversation; have the next one ready
+    connect(menuWindow, &TaskWindow::taskUsed, this, [this]() {
+        QTimer::singleShot(kRebuildDelayMs, this, [this]() {
+            ensureMenu(configProvider());
+        });
+    });
+    return true;
+}
+
+int ConversationManager::conversationCount() const {
+    int count = 0;
+    for (const QPointer<TaskWindow> &window : conversations) {
+        if (window)
+            ++count;
+    }
+    if (menuWindow && menuWindow->hasConversation())
+        ++count;
+    return count;
+}
+
+void ConversationManager::pruneConversations() {
+    // A handed-off window whose selection came back empty is idle again
+    for (const QPointer<TaskWindow> &window : std::as_const(conversations)) {
+        if (window && !window->hasConversation())
+            window->close();
+    }
+    conversations.removeIf([](const QPointer<TaskWindow> &window) {
+        return window.isNull() || !window->hasConversation();
+    });
+}
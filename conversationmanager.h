@@ -0,0 +1,58 @@
+#ifndef CONVERSATIONMANAGER_H
+#define CONVERSATIONMANAGER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QSize>
+#include <QString>
+
+#include "configstore.h"
+
+#include <functional>
+
+class LlmClient;
+class ResponseCache;
+class TaskWindow;
+
+// Keeps the task menu and every running conversation. The menu is built ahead
+// of time and kept hidden, so the hotkey only moves and shows it; it is rebuilt
+// when the config it was built from changes or after a task was picked from it.
+// Conversations already started stay alive with their own request, transcript
+// and response window until they finish.
+class ConversationManager : public QObject {
+    Q_OBJECT
+
+public:
+    // Returns the current config; the menu rebuilt after a pick reads it
+    // then, so edits made since the pick are not lost
+    using ConfigProvider = std::function<AppConfig()>;
+
+    ConversationManager(LlmClient *client, ResponseCache *cache, ConfigProvider config,
+                        QObject *parent = nullptr);
+
+    void prepareMenu(const AppConfig &config);
+    void openMenu(const AppConfig &config, const QElapsedTimer &hotkeyClock);
+    int conversationCount() const;
+
+signals:
+    void taskResponsePrefsChanged(const QString &taskId, const QSize &size, int zoom);
+    void taskResponsePrefsCommitRequested();
+    void taskUsed(const QString &taskId);
+
+private:
+    LlmClient *client;
+    ResponseCache *cache;
+    ConfigProvider configProvider;
+    QPointer<TaskWindow> menuWindow;
+    QByteArray menuConfigKey;
+    QList<QPointer<TaskWindow>> conversations;
+
+    // Returns true when a new menu had to be built
+    bool ensureMenu(const AppConfig &config);
+    void pruneConversations();
+};
+
+#endif // CONVERSATIONMANAGER_H
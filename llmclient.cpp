@@ -0,0 +1,372 @@
+#include "llmclient.h"
+#include "perflog.h"
+#include "ssestreamparser.h"
+
+#include <QMetaObject>
+#include <QNetworkAccessManager>
+#include <QNetworkProxy>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QPointer>
+#include <QThread>
+#include <QUrl>
+
+namespace {
+// Idle pooled connections are kept for a while, so a recent request or
+// warm-up to the same origin makes another one pointless.
+constexpr qint64 kWarmUpIntervalMs = 30000;
+
+QString originKey(const QUrl &url) {
+    return url.scheme().toLower() + QStringLiteral("://") + url.host().toLower()
+        + QLatin1Char(':') + QString::number(url.port(url.scheme() == QLatin1String("https") ? 443 : 80));
+}
+}
+
+struct LlmRequestWorker::RequestStream {
+    QPointer<QNetworkReply> reply;
+    // Raw bytes are kept only until the format is known; a plain JSON reply
+    // needs them at the end, a text/event-stream never does.
+    QByteArray responseBody;
+    SseStreamParser streamParser;
+    StreamDeltaExtractor deltaExtractor;
+    StreamDelta streamDelta;
+    bool sawStreamFormat = false;
+    bool streamFormatReported = false;
+    bool firstByteReported = false;
+    bool tlsHandshake = false;
+    qint64 receivedBytes = 0;
+    qsizetype peakBufferedBytes = 0;
+    QElapsedTimer clock;
+
+    void collectStreamEvents(StreamBatch *batch);
+    void appendDelta(StreamBatch *batch) const;
+    void releaseResponseBody();
+    void trackBufferedBytes();
+};
+
+bool StreamBatch::hasPayload() const {
+    return !text.isEmpty()
+        || !finishReason.isEmpty()
+        || !errorMessage.isEmpty()
+        || hasUsage;
+}
+
+void LlmRequestWorker::RequestStream::collectStreamEvents(StreamBatch *batch) {
+    SseEvent event;
+    while (streamParser.readEvent(&event)) {
+        sawStreamFormat = true;
+        if (event.data.trimmed() == "[DONE]")
+            continue;
+        if (deltaExtractor.extract(event.data, &streamDelta))
+            appendDelta(batch);
+    }
+    batch->streamFormat = sawStreamFormat;
+}
+
+void LlmRequestWorker::RequestStream::appendDelta(StreamBatch *batch) const {
+    batch->text += streamDelta.content;
+    if (!streamDelta.finishReason.isEmpty())
+        batch->finishReason = streamDelta.finishReason;
+    if (!streamDelta.errorMessage.isEmpty())
+        batch->errorMessage = streamDelta.errorMessage;
+    if (streamDelta.hasUsage) {
+        batch->hasUsage = true;
+        batch->usage = streamDelta.usage;
+    }
+}
+
+void LlmRequestWorker::RequestStream::releaseResponseBody() {
+    // clear() would keep the allocation, assigning a null array frees it
+    responseBody = QByteArray();
+}
+
+void LlmRequestWorker::RequestStream::trackBufferedBytes() {
+    const qsizetype buffered = responseBody.capacity() + streamParser.bufferedBytes();
+    peakBufferedBytes = qMax(peakBufferedBytes, buffered);
+}
+
+LlmRequestWorker::LlmRequestWorker(QObject *parent)
+    : QObject(parent)
+    , networkManager(nullptr)
+    , proxyApplied(false) {
+}
+
+LlmRequestWorker::~LlmRequestWorker() = default;
+
+void LlmRequestWorker::startRequest(int requestId,
+                                    const QUrl &url,
+                                    const QByteArray &authorizationHeader,
+                                    const QByteArray &body,
+                                    const QString &proxyText) {
+    ensureNetworkManager(proxyText);
+    markOriginWarm(url);
+
+    QNetworkRequest request(url);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    request.setRawHeader("Authorization", authorizationHeader);
+
+    auto stream = std::make_unique<RequestStream>();
+    stream->clock.start();
+    QNetworkReply *newReply = networkManager->post(request, body);
+    stream->reply = newReply;
+    requests[requestId] = std::move(stream);
+
+    connect(newReply, &QNetworkReply::encrypted, this, [this, requestId]() {
+        const auto it = requests.find(requestId);
+        if (it != requests.end())
+            it->second->tlsHandshake = true;
+    });
+    connect(newReply, &QNetworkReply::readyRead, this, [this, requestId]() {
+        const auto it = requests.find(requestId);
+        if (it == requests.end() || !it->second->reply)
+            return;
+        const QByteArray chunk = it->second->reply->readAll();
+        if (!chunk.isEmpty())
+            handleChunk(requestId, it->second.get(), chunk);
+    });
+    connect(newReply, &QNetworkReply::finished, this, [this, requestId, newReply]() {
+        newReply->deleteLater();
+        const auto it = requests.find(requestId);
+        if (it == requests.end())
+            return;
+        RequestStream *stream = it->second.get();
+
+        const QByteArray chunk = newReply->readAll();
+        if (!chunk.isEmpty())
+            handleChunk(requestId, stream, chunk);
+        flushStream(requestId, stream);
+
+        const int error = static_cast<int>(newReply->error());
+        const QString errorString = newReply->errorString();
+        const int statusCode = newReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        qCDebug(lcPerf) << "request" << requestId << "finished after"
+                        << stream->clock.nsecsElapsed() / 1000000.0 << "ms,"
+                        << stream->receivedBytes << "bytes received, peak buffer"
+                        << stream->peakBufferedBytes << "bytes";
+        requests.erase(it);
+        emit finished(requestId, error, errorString, statusCode);
+    });
+}
+
+void LlmRequestWorker::abortRequest(int requestId) {
+    const auto it = requests.find(requestId);
+    if (it != requests.end() && it->second->reply)
+        it->second->reply->abort();
+}
+
+void LlmRequestWorker::warmUp(const QUrl &url, const QString &proxyText) {
+    if (!url.isValid() || url.host().isEmpty())
+        return;
+    ensureNetworkManager(proxyText);
+    if (warmClock.isValid() && warmOrigin == originKey(url)
+        && warmClock.elapsed() < kWarmUpIntervalMs) {
+        return;
+    }
+    markOriginWarm(url);
+
+    qCDebug(lcPerf) << "pre-warming connection to" << url.host();
+    if (url.scheme().compare(QLatin1String("https"), Qt::CaseInsensitive) == 0)
+        networkManager->connectToHostEncrypted(url.host(), static_cast<quint16>(url.port(443)));
+    else
+        networkManager->connectToHost(url.host(), static_cast<quint16>(url.port(80)));
+}
+
+void LlmRequestWorker::handleChunk(int requestId, RequestStream *stream, const QByteArray &chunk) {
+    if (!stream->firstByteReported) {
+        stream->firstByteReported = true;
+        qCDebug(lcPerf) << "request" << requestId << "first byte after"
+                        << stream->clock.nsecsElapsed() / 1000000.0 << "ms"
+                        << (stream->tlsHandshake ? "(new TLS handshake)" : "(reused connection)");
+    }
+
+    stream->receivedBytes += chunk.size();
+    if (!stream->sawStreamFormat)
+        stream->responseBody.append(chunk);
+    stream->streamParser.feed(chunk);
+    stream->trackBufferedBytes();
+
+    StreamBatch batch;
+    stream->collectStreamEvents(&batch);
+    if (stream->sawStreamFormat)
+        stream->releaseResponseBody();
+    emitBatch(requestId, stream, &batch);
+}
+
+void LlmRequestWorker::flushStream(int requestId, RequestStream *stream) {
+    stream->streamParser.finish();
+
+    StreamBatch batch;
+    stream->collectStreamEvents(&batch);
+    if (!stream->sawStreamFormat
+        && stream->deltaExtractor.extract(stream->responseBody, &stream->streamDelta)) {
+        stream->appendDelta(&batch);
+    }
+    stream->releaseResponseBody();
+    emitBatch(requestId, stream, &batch);
+}
+
+void LlmRequestWorker::emitBatch(int requestId, RequestStream *stream, StreamBatch *batch) {
+    // The first batch after the format is known is sent even when empty so the
+    // window can switch to streaming presentation right away.
+    const bool announceFormat = batch->streamFormat && !stream->streamFormatReported;
+    if (!batch->hasPayload() && !announceFormat)
+        return;
+    stream->streamFormatReported = stream->streamFormatReported || batch->streamFormat;
+    emit streamBatchReady(requestId, *batch);
+}
+
+void LlmRequestWorker::ensureNetworkManager(const QString &proxyText) {
+    if (!networkManager)
+        networkManager = new QNetworkAccessManager(this);
+    applyProxy(proxyText);
+}
+
+void LlmRequestWorker::markOriginWarm(const QUrl &url) {
+    warmOrigin = originKey(url);
+    warmClock.start();
+}
+
+void LlmRequestWorker::applyProxy(const QString &proxyText) {
+    if (!networkManager)
+        return;
+    // Changing the proxy drops pooled connections, so only do it on change
+    if (proxyApplied && proxyText == appliedProxyText)
+        return;
+    proxyApplied = true;
+    warmClock.invalidate();
+    appliedProxyText = proxyText;
+
+    const QString trimmed = proxyText.trimmed();
+    if (trimmed.isEmpty()) {
+        QNetworkProxy proxy;
+        proxy.setType(QNetworkProxy::NoProxy);
+        networkManager->setProxy(proxy);
+        return;
+    }
+
+    const QUrl proxyUrl(trimmed);
+    if (!proxyUrl.isValid()) {
+        QNetworkProxy proxy;
+        proxy.setType(QNetworkProxy::NoProxy);
+        networkManager->setProxy(proxy);
+        return;
+    }
+
+    QNetworkProxy proxy;
+    proxy.setType(QNetworkProxy::HttpProxy);
+    proxy.setHostName(proxyUrl.host());
+    proxy.setPort(proxyUrl.port());
+    networkManager->setProxy(proxy);
+}
+
+LlmClient::LlmClient(QObject *parent)
+    : QObject(parent)
+    , networkThread(new QThread(this))
+    , worker(new LlmRequestWorker)
+    , lastRequestId(0)
+    , maxInFlight(0) {
+    qRegisterMetaType<StreamBatch>("StreamBatch");
+    worker->moveToThread(networkThread);
+    connect(networkThread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(worker, &LlmRequestWorker::streamBatchReady,
+            this, &LlmClient::streamBatchReady);
+    connect(worker, &LlmRequestWorker::finished,
+            this, &LlmClient::handleWorkerFinished);
+    networkThread->start();
+}
+
+LlmClient::~LlmClient() {
+    networkThread->quit();
+    networkThread->wait();
+}
+
+int LlmClient::startRequest(const QUrl &url,
+                            const QByteArray &authorizationHeader,
+                            const QByteArray &body,
+                            const QString &proxyText) {
+    QueuedRequest request;
+    request.requestId = ++lastRequestId;
+    request.url = url;
+    request.authorizationHeader = authorizationHeader;
+    request.body = body;
+    request.proxyText = proxyText;
+    if (maxInFlight > 0 && inFlightRequests.size() >= maxInFlight) {
+        request.queuedClock.start();
+        queuedRequests.append(request);
+        qCDebug(lcPerf) << "request" << request.requestId << "queued behind"
+                        << inFlightRequests.size() << "in flight";
+    } else {
+        dispatch(request);
+    }
+    return request.requestId;
+}
+
+void LlmClient::abortRequest(int requestId) {
+    for (int i = 0; i < queuedRequests.size(); ++i) {
+        if (queuedRequests.at(i).requestId != requestId)
+            continue;
+        queuedRequests.removeAt(i);
+        // Reported later so callers never see finished() from inside abortRequest()
+        QMetaObject::invokeMethod(this, [this, requestId]() {
+            emit finished(requestId,
+                          static_cast<int>(QNetworkReply::OperationCanceledError),
+                          tr("Operation canceled"),
+                          0);
+        }, Qt::QueuedConnection);
+        return;
+    }
+    if (!inFlightRequests.contains(requestId))
+        return;
+    QMetaObject::invokeMethod(worker,
+                              "abortRequest",
+                              Qt::QueuedConnection,
+                              Q_ARG(int, requestId));
+}
+
+void LlmClient::setMaxInFlight(int limit) {
+    maxInFlight = qMax(0, limit);
+    dispatchQueued();
+}
+
+void LlmClient::dispatch(const QueuedRequest &request) {
+    if (request.queuedClock.isValid()) {
+        qCDebug(lcPerf) << "request" << request.requestId << "waited"
+                        << request.queuedClock.elapsed() << "ms in queue";
+    }
+    inFlightRequests.insert(request.requestId);
+    QMetaObject::invokeMethod(worker,
+                              "startRequest",
+                              Qt::QueuedConnection,
+                              Q_ARG(int, request.requestId),
+                              Q_ARG(QUrl, request.url),
+                              Q_ARG(QByteArray, request.authorizationHeader),
+                              Q_ARG(QByteArray, request.body),
+                              Q_ARG(QString, request.proxyText));
+}
+
+void LlmClient::dispatchQueued() {
+    while (!queuedRequests.isEmpty()
+           && (maxInFlight <= 0 || inFlightRequests.size() < maxInFlight)) {
+        dispatch(queuedRequests.takeFirst());
+    }
+}
+
+void LlmClient::handleWorkerFinished(int requestId,
+                                     int error,
+                                     const QString &errorString,
+                                     int statusCode) {
+    inFlightRequests.remove(requestId);
+    dispatchQueued();
+    emit finished(requestId, error, errorString, statusCode);
+}
+
+void LlmClient::warmUp(const QString &apiEndpoint, const QString &proxyText) {
+    const QUrl url(apiEndpoint.trimmed());
+    if (!url.isValid() || url.host().isEmpty())
+        return;
+    QMetaObject::invokeMethod(worker,
+                              "warmUp",
+                              Qt::QueuedConnection,
+                              Q_ARG(QUrl, url),
+                              Q_ARG(QString, proxyText));
+}
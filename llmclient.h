@@ -0,0 +1,120 @@
+#ifndef LLMCLIENT_H
+#define LLMCLIENT_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QMetaType>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QUrl>
+
+#include <map>
+#include <memory>
+
+#include "streamdeltaextractor.h"
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QThread;
+
+struct StreamBatch {
+    QString text;
+    QString finishReason;
+    QString errorMessage;
+    bool hasUsage = false;
+    TokenUsage usage;
+    bool streamFormat = false;
+
+    bool hasPayload() const;
+};
+
+Q_DECLARE_METATYPE(StreamBatch)
+
+// Lives on the client's network thread. One QNetworkAccessManager serves every
+// request, so keep-alive connections and TLS sessions outlive task windows.
+class LlmRequestWorker : public QObject {
+    Q_OBJECT
+
+public:
+    explicit LlmRequestWorker(QObject *parent = nullptr);
+    ~LlmRequestWorker() override;
+
+public slots:
+    void startRequest(int requestId,
+                      const QUrl &url,
+                      const QByteArray &authorizationHeader,
+                      const QByteArray &body,
+                      const QString &proxyText);
+    void abortRequest(int requestId);
+    void warmUp(const QUrl &url, const QString &proxyText);
+
+signals:
+    void streamBatchReady(int requestId, const StreamBatch &batch);
+    void finished(int requestId, int error, const QString &errorString, int statusCode);
+
+private:
+    struct RequestStream;
+
+    QNetworkAccessManager *networkManager;
+    QString appliedProxyText;
+    bool proxyApplied;
+    std::map<int, std::unique_ptr<RequestStream>> requests;
+    QString warmOrigin;
+    QElapsedTimer warmClock;
+
+    void ensureNetworkManager(const QString &proxyText);
+    void applyProxy(const QString &proxyText);
+    void markOriginWarm(const QUrl &url);
+    void handleChunk(int requestId, RequestStream *stream, const QByteArray &chunk);
+    void flushStream(int requestId, RequestStream *stream);
+    void emitBatch(int requestId, RequestStream *stream, StreamBatch *batch);
+};
+
+// Application-wide LLM client. Task windows submit requests here instead of
+// owning a network thread, and filter the shared signals by request id.
+class LlmClient : public QObject {
+    Q_OBJECT
+
+public:
+    explicit LlmClient(QObject *parent = nullptr);
+    ~LlmClient() override;
+
+    int startRequest(const QUrl &url,
+                     const QByteArray &authorizationHeader,
+                     const QByteArray &body,
+                     const QString &proxyText);
+    void abortRequest(int requestId);
+    // Opens the DNS, TCP and TLS path to the endpoint ahead of a request.
+    void warmUp(const QString &apiEndpoint, const QString &proxyText);
+    // Requests beyond the limit wait in a FIFO queue; 0 means no limit.
+    void setMaxInFlight(int limit);
+
+signals:
+    void streamBatchReady(int requestId, const StreamBatch &batch);
+    void finished(int requestId, int error, const QString &errorString, int statusCode);
+
+private:
+    struct QueuedRequest {
+        int requestId = 0;
+        QUrl url;
+        QByteArray authorizationHeader;
+        QByteArray body;
+        QString proxyText;
+        QElapsedTimer queuedClock;
+    };
+
+    QThread *networkThread;
+    LlmRequestWorker *worker;
+    int lastRequestId;
+    int maxInFlight;
+    QSet<int> inFlightRequests;
+    QList<QueuedRequest> queuedRequests;
+
+    void dispatch(const QueuedRequest &request);
+    void dispatchQueued();
+    void handleWorkerFinished(int requestId, int error, const QString &errorString, int statusCode);
+};
+
+#endif // LLMCLIENT_H
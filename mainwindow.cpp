@@ -5,12 +5,22 @@
 #include "hotkeymanager.h"
 #include "modelselectbox.h"
 #include "modellistloader.h"
+#include "llmclient.h"
+#include "conversationmanager.h"
+#include "responsecache.h"
+#include "configmodel.h"
+#include "configpersistence.h"
+#include "bpetokenizer.h"
+#include "perflog.h"
 
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QJsonDocument>
 #include <QCoreApplication>
+#include <QCheckBox>
 #include <QLineEdit>
 #include <QMetaObject>
 #include <QTabBar>
@@ -30,10 +40,12 @@
 #include <QMessageBox>
 #include <QStandardPaths>
 #include <QThread>
+#include <QTimer>
 
 #include <functional>
 
 #include <windows.h>
+#include <psapi.h>
 
 QPointer<MainWindow> MainWindow::instance = nullptr;
 
@@ -41,6 +53,29 @@ namespace {
 constexpr const char kAddTabMarker[] = "add_tab";
 constexpr const char kDefaultModelLabel[] = "Default";
 
+qint64 fileTimeToMs(const FILETIME &time) {
+    ULARGE_INTEGER value;
+    value.LowPart = time.dwLowDateTime;
+    value.HighPart = time.dwHighDateTime;
+    return static_cast<qint64>(value.QuadPart / 10000);
+}
+
+qint64 msSinceProcessStart() {
+    FILETIME created, exited, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user))
+        return -1;
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    return fileTimeToMs(now) - fileTimeToMs(created);
+}
+
+qint64 workingSetBytes() {
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return static_cast<qint64>(counters.WorkingSetSize);
+}
+
 class TaskTabBar : public QTabBar {
 public:
     explicit TaskTabBar(QWidget *parent = nullptr)
@@ -388,18 +423,80 @@ int GlobalKeyInterceptor::modState = 0;
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
-      , ui(new Ui::MainWindow)
+      , ui(nullptr)
       , hotkeyCaptured(false)
       , hotkeyManager(new HotkeyManager(this))
+      , hotkeyRegistered(false)
       , loadingConfig(false)
       , trayIcon(nullptr)
-      , menuWindow(nullptr)
+      , llmClient(new LlmClient(this))
+      , responseCache(new ResponseCache(this))
+      , conversationManager(new ConversationManager(llmClient, responseCache,
+                                                    [this]() { return configModel->snapshot(); }, this))
+      , configModel(new ConfigModel(this))
+      , configPersistence(new ConfigPersistence(ConfigStore::configFilePath(),
+                                                [this]() { return configModel->snapshot(); }, this))
       , modelLoaderThread(new QThread(this))
-      , modelListLoader(new ModelListLoader)
+      , modelListLoader(nullptr)
       , nextModelRequestId(0)
-      , hasCachedModelList(false) {
+      , hasCachedModelList(false)
+      , startupMs(-1)
+      , startupWorkingSet(0) {
     instance = this;
     qRegisterMetaType<ModelInfoList>("ModelInfoList");
+
+    // Only what the hotkey needs starts here; the settings UI waits until opened
+    createTrayIcon();
+
+    connect(hotkeyManager, &HotkeyManager::hotkeyPressed,
+            this, &MainWindow::handleGlobalHotkey);
+    connect(conversationManager, &ConversationManager::taskResponsePrefsChanged,
+            this, &MainWindow::updateTaskResponsePrefs);
+    connect(conversationManager, &ConversationManager::taskResponsePrefsCommitRequested,
+            this, &MainWindow::commitTaskResponsePrefs);
+    connect(conversationManager, &ConversationManager::taskUsed,
+            this, &MainWindow::recordTaskUse);
+
+    connect(configModel, &ConfigModel::changed, this, &MainWindow::saveConfig);
+    connect(qApp, &QCoreApplication::aboutToQuit, configPersistence, &ConfigPersistence::flush);
+
+    loadConfig();
+    updateHotkeyRegistration();
+    preloadTokenizer();
+    startupMs = msSinceProcessStart();
+    startupWorkingSet = workingSetBytes();
+    qCDebug(lcPerf) << "hotkey ready" << startupMs << "ms after process start, working set"
+                    << startupWorkingSet / 1024 << "KiB";
+    // Have the task menu ready before the first hotkey press
+    QTimer::singleShot(0, this, [this]() {
+        conversationManager->prepareMenu(configModel->snapshot());
+    });
+}
+
+qint64 MainWindow::hotkeyReadyMs() const {
+    return startupMs;
+}
+
+qint64 MainWindow::hotkeyReadyWorkingSet() const {
+    return startupWorkingSet;
+}
+
+MainWindow::~MainWindow() {
+    configPersistence->flush();
+    GlobalKeyInterceptor::stop();
+    modelLoaderThread->quit();
+    modelLoaderThread->wait();
+    delete ui;
+    instance = nullptr;
+}
+
+void MainWindow::ensureSettingsUi() {
+    if (ui)
+        return;
+
+    QElapsedTimer buildClock;
+    buildClock.start();
+    ui = new Ui::MainWindow;
     ui->setupUi(this);
     // Include application name in the window title
     setWindowTitle(QCoreApplication::applicationName() + " - " + tr("Settings"));
@@ -430,13 +527,25 @@ MainWindow::MainWindow(QWidget *parent)
             this, &MainWindow::handleTaskTabClicked);
     ensureAddTab();
 
-    connect(ui->lineEditApiEndpoint, &QLineEdit::textChanged, this, &MainWindow::saveConfig);
+    connect(ui->lineEditApiEndpoint, &QLineEdit::textChanged, this, &MainWindow::syncSettingsFromUi);
     connect(ui->modelSelectBoxModelName, &ModelSelectBox::currentModelChanged,
-            this, &MainWindow::saveConfig);
-    connect(ui->lineEditApiKey, &QLineEdit::textChanged, this, &MainWindow::saveConfig);
-    connect(ui->lineEditProxy, &QLineEdit::textChanged, this, &MainWindow::saveConfig);
-    connect(ui->lineEditHotkey, &QLineEdit::textChanged, this, &MainWindow::saveConfig);
-    connect(ui->lineEditMaxChars, &QLineEdit::textChanged, this, &MainWindow::saveConfig);
+            this, &MainWindow::syncSettingsFromUi);
+    connect(ui->lineEditApiKey, &QLineEdit::textChanged, this, &MainWindow::syncSettingsFromUi);
+    connect(ui->lineEditProxy, &QLineEdit::textChanged, this, &MainWindow::syncSettingsFromUi);
+    connect(ui->lineEditHotkey, &QLineEdit::textChanged, this, &MainWindow::syncSettingsFromUi);
+    connect(ui->lineEditMaxChars, &QLineEdit::textChanged, this, &MainWindow::syncSettingsFromUi);
+    connect(ui->lineEditRenderInterval, &QLineEdit::textChanged, this, &MainWindow::syncSettingsFromUi);
+    connect(ui->checkBoxSpeculativePrefetch, &QCheckBox::toggled, this, &MainWindow::syncSettingsFromUi);
+    connect(ui->lineEditMaxParallelRequests, &QLineEdit::textChanged, this, &MainWindow::syncSettingsFromUi);
+    connect(ui->checkBoxStreamingInsert, &QCheckBox::toggled, this, &MainWindow::syncSettingsFromUi);
+    connect(ui->lineEditTokenizerVocabulary, &QLineEdit::textChanged, this, &MainWindow::syncSettingsFromUi);
+    connect(ui->lineEditMaxInputTokens, &QLineEdit::textChanged, this, &MainWindow::syncSettingsFromUi);
+    connect(ui->checkBoxChunkLongSelections, &QCheckBox::toggled, this, &MainWindow::syncSettingsFromUi);
+    connect(ui->lineEditMaxParallelChunks, &QLineEdit::textChanged, this, &MainWindow::syncSettingsFromUi);
+    connect(ui->checkBoxChunkReducePass, &QCheckBox::toggled, this, &MainWindow::syncSettingsFromUi);
+    connect(ui->checkBoxResponseCache, &QCheckBox::toggled, this, &MainWindow::syncSettingsFromUi);
+    connect(ui->checkBoxCacheAllTemperatures, &QCheckBox::toggled, this, &MainWindow::syncSettingsFromUi);
+    connect(ui->lineEditResponseCacheSize, &QLineEdit::textChanged, this, &MainWindow::syncSettingsFromUi);
     connect(ui->modelSelectBoxModelName, &ModelSelectBox::modelsReloadRequested,
             this, &MainWindow::requestModelList);
     connect(ui->pushButtonExportSettings, &QPushButton::clicked,
@@ -446,11 +555,12 @@ MainWindow::MainWindow(QWidget *parent)
 
     ui->lineEditHotkey->installEventFilter(this);
 
-    createTrayIcon();
-
-    connect(hotkeyManager, &HotkeyManager::hotkeyPressed,
-            this, &MainWindow::handleGlobalHotkey);
+    connect(responseCache, &ResponseCache::statsChanged,
+            this, &MainWindow::updateResponseCacheStats);
+    updateResponseCacheStats();
 
+    // Model lists are only requested from the settings UI
+    modelListLoader = new ModelListLoader;
     modelListLoader->moveToThread(modelLoaderThread);
     connect(modelLoaderThread, &QThread::finished, modelListLoader, &QObject::deleteLater);
     connect(this, &MainWindow::modelListLoadRequested,
@@ -461,20 +571,22 @@ MainWindow::MainWindow(QWidget *parent)
             this, &MainWindow::handleModelListFailed);
     modelLoaderThread->start();
 
-    loadConfig();
-    hotkeyManager->registerHotkey(ui->lineEditHotkey->text());
+    loadingConfig = true;
+    applyConfig(configModel->snapshot());
+    loadingConfig = false;
+    qCDebug(lcPerf) << "settings window built in" << buildClock.elapsed() << "ms with"
+                    << configModel->taskCount() << "tasks";
 }
 
-MainWindow::~MainWindow() {
-    GlobalKeyInterceptor::stop();
-    modelLoaderThread->quit();
-    modelLoaderThread->wait();
-    delete ui;
-    instance = nullptr;
+void MainWindow::showSettings() {
+    ensureSettingsUi();
+    showNormal();
+    raise();
+    activateWindow();
 }
 
 bool MainWindow::eventFilter(QObject *obj, QEvent *ev) {
-    if (obj == ui->lineEditHotkey) {
+    if (ui && obj == ui->lineEditHotkey) {
         if (ev->type() == QEvent::FocusIn) {
             prevHotkey = ui->lineEditHotkey->text();
             hotkeyCaptured = false;
@@ -495,22 +607,16 @@ void MainWindow::closeEvent(QCloseEvent *event) {
 }
 
 void MainWindow::setHotkeyText(const QString &text) {
+    if (!ui)
+        return;
     ui->lineEditHotkey->setText(text);
     hotkeyCaptured = true;
-    saveConfig();
-}
-
-void MainWindow::applyDefaultSettings() {
-    applyConfig(ConfigStore::defaultConfig());
 }
 
 void MainWindow::loadConfig() {
     const QString path = ConfigStore::configFilePath();
     if (!QFile::exists(path)) {
-        loadingConfig = true;
-        applyDefaultSettings();
-        loadingConfig = false;
-        saveConfig();
+        configModel->reset(ConfigStore::defaultConfig());
         return;
     }
 
@@ -519,7 +625,7 @@ void MainWindow::loadConfig() {
         return;
 
     loadingConfig = true;
-    applyConfig(config);
+    configModel->reset(config);
     loadingConfig = false;
 }
 
@@ -527,10 +633,60 @@ void MainWindow::saveConfig() {
     if (loadingConfig)
         return;
 
-    const AppConfig config = buildConfigFromUi();
-    ConfigStore::saveToFile(ConfigStore::configFilePath(), config);
+    configPersistence->markDirty();
+    updateHotkeyRegistration();
+    preloadTokenizer();
+}
+
+void MainWindow::preloadTokenizer() {
+    // Parsed off the GUI thread so the first request after a path change
+    // finds it ready. Most edits touch other fields, so only a new path
+    // queues a load, and partial paths typed on the way are skipped.
+    const QString path = configModel->settings().tokenizerVocabularyPath;
+    if (path == preloadedVocabularyPath || !QFileInfo(path).isFile())
+        return;
+    preloadedVocabularyPath = path;
+    BpeTokenizer::preload(path);
+}
+
+void MainWindow::syncSettingsFromUi() {
+    if (loadingConfig)
+        return;
+    configModel->setSettings(settingsFromUi());
+}
+
+void MainWindow::syncTaskFromUi(TaskWidget *task) {
+    if (loadingConfig)
+        return;
+    configModel->setTask(taskWidgets.indexOf(task), task->toDefinition());
+}
+
+void MainWindow::syncTaskOrder() {
+    if (loadingConfig)
+        return;
+    QList<TaskDefinition> ordered;
+    QList<TaskWidget *> widgets;
+    for (int i = 0; i < ui->tasksTabWidget->count(); ++i) {
+        auto *task = qobject_cast<TaskWidget *>(ui->tasksTabWidget->widget(i));
+        const int modelIndex = taskWidgets.indexOf(task);
+        if (!task || modelIndex < 0)
+            continue;
+        ordered.append(configModel->task(modelIndex));
+        widgets.append(task);
+    }
+    if (widgets == taskWidgets)
+        return;
+    taskWidgets = widgets;
+    configModel->setTasks(ordered);
+}
 
-    hotkeyManager->registerHotkey(config.settings.hotkey);
+void MainWindow::updateHotkeyRegistration() {
+    const QString hotkey = configModel->settings().hotkey;
+    if (hotkeyRegistered && hotkey == registeredHotkey)
+        return;
+    hotkeyRegistered = true;
+    registeredHotkey = hotkey;
+    hotkeyManager->registerHotkey(hotkey);
 }
 
 QString MainWindow::suggestedSettingsPath() const {
@@ -551,8 +707,7 @@ void MainWindow::exportSettings() {
     if (path.isEmpty())
         return;
 
-    const AppConfig config = buildConfigFromUi();
-    if (!ConfigStore::saveToFile(path, config)) {
+    if (!ConfigStore::saveToFile(path, configModel->snapshot())) {
         QMessageBox::warning(this, tr("Export Settings"),
                              tr("Failed to export settings."));
     }
@@ -587,13 +742,13 @@ void MainWindow::handleTaskTabClicked(int index) {
         return;
 
     TaskDefinition definition;
+    definition.id = ConfigStore::newTaskId();
     addTaskTab(definition, true);
-    saveConfig();
 }
 
 void MainWindow::handleTaskTabMoved(int, int) {
     ensureAddTabLast();
-    saveConfig();
+    syncTaskOrder();
 }
 
 void MainWindow::requestCloseTask(int index) {
@@ -625,32 +780,69 @@ void MainWindow::removeTaskWidget(TaskWidget *task) {
         QWidget *page = ui->tasksTabWidget->widget(index);
         ui->tasksTabWidget->removeTab(index);
         page->deleteLater();
-        saveConfig();
+        const int modelIndex = taskWidgets.indexOf(task);
+        if (modelIndex >= 0) {
+            taskWidgets.removeAt(modelIndex);
+            configModel->removeTask(modelIndex);
+        }
     }
 }
 
-void MainWindow::updateTaskResponsePrefs(int taskIndex, const QSize &size, int zoom) {
-    if (taskIndex < 0 || taskIndex >= ui->tasksTabWidget->count())
-        return;
-    if (isAddTabIndex(taskIndex))
-        return;
-    auto *task = qobject_cast<TaskWidget *>(ui->tasksTabWidget->widget(taskIndex));
-    if (!task)
+void MainWindow::updateTaskResponsePrefs(const QString &taskId, const QSize &size, int zoom) {
+    const int taskIndex = configModel->indexOfTask(taskId);
+    if (taskIndex < 0)
         return;
-    task->setResponseWindowSize(size);
-    task->setResponseZoom(zoom);
+    TaskDefinition definition = configModel->task(taskIndex);
+    definition.responseWidth = size.width();
+    definition.responseHeight = size.height();
+    definition.responseZoom = zoom;
+    configModel->setTask(taskIndex, definition);
+    if (TaskWidget *task = taskWidgets.value(taskIndex)) {
+        task->setResponseWindowSize(size);
+        task->setResponseZoom(zoom);
+    }
 }
 
 void MainWindow::commitTaskResponsePrefs() {
     saveConfig();
 }
 
+void MainWindow::recordTaskUse(const QString &taskId) {
+    const int taskIndex = configModel->indexOfTask(taskId);
+    if (taskIndex < 0)
+        return;
+    TaskDefinition definition = configModel->task(taskIndex);
+    ++definition.useCount;
+    configModel->setTask(taskIndex, definition);
+    if (TaskWidget *task = taskWidgets.value(taskIndex))
+        task->setUseCount(definition.useCount);
+}
+
+void MainWindow::updateResponseCacheStats() {
+    if (!ui)
+        return;
+    ui->labelResponseCacheStatsValue->setText(
+        tr("%1 hits, %2 misses this session").arg(responseCache->hits()).arg(responseCache->misses()));
+}
+
 void MainWindow::applyConfig(const AppConfig &config) {
     ui->lineEditApiEndpoint->setText(config.settings.apiEndpoint);
     ui->lineEditApiKey->setText(config.settings.apiKey);
     ui->lineEditProxy->setText(config.settings.proxy);
     ui->lineEditHotkey->setText(config.settings.hotkey);
     ui->lineEditMaxChars->setText(QString::number(config.settings.maxChars));
+    ui->lineEditRenderInterval->setText(QString::number(config.settings.renderIntervalMs));
+    ui->checkBoxSpeculativePrefetch->setChecked(config.settings.speculativePrefetch);
+    ui->lineEditMaxParallelRequests->setText(QString::number(config.settings.maxParallelRequests));
+    ui->checkBoxStreamingInsert->setChecked(config.settings.streamingInsert);
+    ui->lineEditTokenizerVocabulary->setText(config.settings.tokenizerVocabularyPath);
+    ui->lineEditMaxInputTokens->setText(QString::number(config.settings.maxInputTokens));
+    ui->checkBoxChunkLongSelections->setChecked(config.settings.chunkLongSelections);
+    ui->lineEditMaxParallelChunks->setText(QString::number(config.settings.maxParallelChunks));
+    ui->checkBoxChunkReducePass->setChecked(config.settings.chunkReducePass);
+    ui->checkBoxResponseCache->setChecked(config.settings.responseCache);
+    ui->checkBoxCacheAllTemperatures->setChecked(config.settings.cacheAllTemperatures);
+    ui->lineEditResponseCacheSize->setText(QString::number(config.settings.responseCacheSizeMb));
     setDefaultModel(config.settings.modelName);
 
     clearTasks();
@@ -661,29 +853,36 @@ void MainWindow::applyConfig(const AppConfig &config) {
     int addIndex = addTabIndex();
     if (addIndex > 0 || (addIndex == -1 && ui->tasksTabWidget->count() > 0))
         ui->tasksTabWidget->setCurrentIndex(0);
+
+    // Read back once so the model holds the values as the widgets normalized them
+    AppConfig applied;
+    applied.settings = settingsFromUi();
+    for (TaskWidget *task : std::as_const(taskWidgets))
+        applied.tasks.append(task->toDefinition());
+    configModel->reset(applied);
 }
 
-AppConfig MainWindow::buildConfigFromUi() const {
-    AppConfig config;
-    config.settings.apiEndpoint = ui->lineEditApiEndpoint->text();
-    config.settings.modelName = currentDefaultModel();
-    config.settings.apiKey = ui->lineEditApiKey->text();
-    config.settings.proxy = ui->lineEditProxy->text();
-    config.settings.hotkey = ui->lineEditHotkey->text();
-    config.settings.maxChars = ui->lineEditMaxChars->text().toInt();
-    config.tasks = currentTaskDefinitions();
-    return config;
-}
-
-QList<TaskDefinition> MainWindow::currentTaskDefinitions() const {
-    QList<TaskDefinition> list;
-    for (int i = 0; i < ui->tasksTabWidget->count(); ++i) {
-        if (isAddTabIndex(i))
-            continue;
-        if (auto *task = qobject_cast<TaskWidget *>(ui->tasksTabWidget->widget(i)))
-            list.append(task->toDefinition());
-    }
-    return list;
+AppSettings MainWindow::settingsFromUi() const {
+    AppSettings settings;
+    settings.apiEndpoint = ui->lineEditApiEndpoint->text();
+    settings.modelName = currentDefaultModel();
+    settings.apiKey = ui->lineEditApiKey->text();
+    settings.proxy = ui->lineEditProxy->text();
+    settings.hotkey = ui->lineEditHotkey->text();
+    settings.maxChars = ui->lineEditMaxChars->text().toInt();
+    settings.renderIntervalMs = qMax(0, ui->lineEditRenderInterval->text().toInt());
+    settings.speculativePrefetch = ui->checkBoxSpeculativePrefetch->isChecked();
+    settings.maxParallelRequests = qMax(0, ui->lineEditMaxParallelRequests->text().toInt());
+    settings.streamingInsert = ui->checkBoxStreamingInsert->isChecked();
+    settings.tokenizerVocabularyPath = ui->lineEditTokenizerVocabulary->text().trimmed();
+    settings.maxInputTokens = qMax(0, ui->lineEditMaxInputTokens->text().toInt());
+    settings.chunkLongSelections = ui->checkBoxChunkLongSelections->isChecked();
+    settings.maxParallelChunks = qMax(0, ui->lineEditMaxParallelChunks->text().toInt());
+    settings.chunkReducePass = ui->checkBoxChunkReducePass->isChecked();
+    settings.responseCache = ui->checkBoxResponseCache->isChecked();
+    settings.cacheAllTemperatures = ui->checkBoxCacheAllTemperatures->isChecked();
+    settings.responseCacheSizeMb = qMax(0, ui->lineEditResponseCacheSize->text().toInt());
+    return settings;
 }
 
 void MainWindow::addTaskTab(const TaskDefinition &definition, bool makeCurrent) {
@@ -696,13 +895,16 @@ void MainWindow::addTaskTab(const TaskDefinition &definition, bool makeCurrent)
     if (insertIndex < 0)
         insertIndex = ui->tasksTabWidget->count();
     int index = ui->tasksTabWidget->insertTab(insertIndex, task, tabLabel);
+    taskWidgets.append(task);
+    if (!loadingConfig)
+        configModel->insertTask(configModel->taskCount(), task->toDefinition());
     if (makeCurrent)
         ui->tasksTabWidget->setCurrentIndex(index);
 }
 
 void MainWindow::connectTaskSignals(TaskWidget *task) {
-    connect(task, &TaskWidget::configChanged, this, &MainWindow::saveConfig);
     connect(task, &TaskWidget::configChanged, this, [this, task]() {
+        syncTaskFromUi(task);
         updateTaskTabTitle(task);
     });
     connect(task, &TaskWidget::refreshModelsRequested,
@@ -725,6 +927,7 @@ void MainWindow::clearTasks() {
         ui->tasksTabWidget->removeTab(i);
         page->deleteLater();
     }
+    taskWidgets.clear();
 }
 
 int MainWindow::addTabIndex() const {
@@ -824,16 +1027,9 @@ void MainWindow::handleModelListFailed(int requestId, const QString &message) {
 }
 
 void MainWindow::handleGlobalHotkey() {
-    if (menuWindow) {
-        menuWindow->close();
-        menuWindow = nullptr;
-    }
-    const AppConfig config = buildConfigFromUi();
-    menuWindow = new TaskWindow(config.tasks, config.settings);
-    connect(menuWindow, &TaskWindow::taskResponsePrefsChanged,
-            this, &MainWindow::updateTaskResponsePrefs);
-    connect(menuWindow, &TaskWindow::taskResponsePrefsCommitRequested,
-            this, &MainWindow::commitTaskResponsePrefs);
+    QElapsedTimer hotkeyClock;
+    hotkeyClock.start();
+    conversationManager->openMenu(configModel->snapshot(), hotkeyClock);
 }
 
 void MainWindow::createTrayIcon() {
@@ -841,11 +1037,7 @@ void MainWindow::createTrayIcon() {
     QAction *restoreAction = trayMenu->addAction(tr("Settings"));
     QAction *quitAction = trayMenu->addAction(tr("Exit"));
 
-    connect(restoreAction, &QAction::triggered, this, [this]() {
-        showNormal();
-        raise();
-        activateWindow();
-    });
+    connect(restoreAction, &QAction::triggered, this, &MainWindow::showSettings);
     connect(quitAction, &QAction::triggered, qApp, &QApplication::quit);
 
     trayIcon = new QSystemTrayIcon(this);
@@ -860,8 +1052,6 @@ void MainWindow::createTrayIcon() {
 void MainWindow::onTrayIconActivated(QSystemTrayIcon::ActivationReason reason) {
     if (reason == QSystemTrayIcon::Trigger ||
         reason == QSystemTrayIcon::DoubleClick) {
-        showNormal();
-        raise();
-        activateWindow();
+        showSettings();
     }
 }
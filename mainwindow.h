@@ -20,9 +20,13 @@ namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
 
 class TaskWidget;
-class TaskWindow;
 class ModelSelectBox;
 class ModelListLoader;
+class LlmClient;
+class ConversationManager;
+class ConfigModel;
+class ConfigPersistence;
+class ResponseCache;
 class QThread;
 
 class MainWindow : public QMainWindow {
@@ -34,6 +38,10 @@ public:
 
     static QPointer<MainWindow> instance;
 
+    // Measured when construction ends, the point from which the hotkey works
+    qint64 hotkeyReadyMs() const;
+    qint64 hotkeyReadyWorkingSet() const;
+
 public slots:
     void setHotkeyText(const QString &text);
     void handleGlobalHotkey();
@@ -48,8 +56,10 @@ private slots:
     void handleTaskTabMoved(int from, int to);
     void requestCloseTask(int index);
     void removeTaskWidget(TaskWidget *task);
-    void updateTaskResponsePrefs(int taskIndex, const QSize &size, int zoom);
+    void updateTaskResponsePrefs(const QString &taskId, const QSize &size, int zoom);
     void commitTaskResponsePrefs();
+    void recordTaskUse(const QString &taskId);
+    void updateResponseCacheStats();
     void requestModelList(ModelSelectBox *target, int generation);
     void handleModelListLoaded(int requestId, const ModelInfoList &models);
     void handleModelListFailed(int requestId, const QString &message);
@@ -83,9 +93,15 @@ private:
     QString prevHotkey;
     bool hotkeyCaptured;
     HotkeyManager *hotkeyManager;
+    bool hotkeyRegistered;
+    QString registeredHotkey;
     bool loadingConfig;
     QSystemTrayIcon *trayIcon;
-    QPointer<TaskWindow> menuWindow;
+    LlmClient *llmClient;
+    ResponseCache *responseCache;
+    ConversationManager *conversationManager;
+    ConfigModel *configModel;
+    ConfigPersistence *configPersistence;
     QThread *modelLoaderThread;
     ModelListLoader *modelListLoader;
     int nextModelRequestId;
@@ -93,14 +109,25 @@ private:
     bool hasCachedModelList;
     ModelListRequestParams cachedModelListParams;
     ModelInfoList cachedModelList;
+    // Task tabs in the order of the model's task list
+    QList<TaskWidget *> taskWidgets;
+    qint64 startupMs;
+    qint64 startupWorkingSet;
+    // Last vocabulary handed to BpeTokenizer::preload
+    QString preloadedVocabularyPath;
 
     void createTrayIcon();
+    void ensureSettingsUi();
+    void showSettings();
     void loadConfig();
     void saveConfig();
-    void applyDefaultSettings();
+    void preloadTokenizer();
+    void updateHotkeyRegistration();
     void applyConfig(const AppConfig &config);
-    AppConfig buildConfigFromUi() const;
-    QList<TaskDefinition> currentTaskDefinitions() const;
+    AppSettings settingsFromUi() const;
+    void syncSettingsFromUi();
+    void syncTaskFromUi(TaskWidget *task);
+    void syncTaskOrder();
     void addTaskTab(const TaskDefinition &definition, bool makeCurrent);
     void connectTaskSignals(TaskWidget *task);
     void updateTaskTabTitle(TaskWidget *task);
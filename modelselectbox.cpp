@@ -1,13 +1,16 @@
 #include "modelselectbox.h"
+#include "modelstats.h"
 
 #include <QAbstractItemView>
 #include <QAbstractListModel>
 #include <QApplication>
+#include <QCheckBox>
 #include <QColor>
 #include <QEvent>
 #include <QFrame>
 #include <QFontMetrics>
 #include <QGuiApplication>
+#include <QHash>
 #include <QHBoxLayout>
 #include <QItemSelectionModel>
 #include <QKeyEvent>
@@ -36,6 +39,9 @@ constexpr int kPopupHeight = 300;
 constexpr int kRowHeight = 30;
 constexpr int kTooltipWidth = 320;
 
+// Shared by every picker so the choice sticks while the app runs
+bool sortByMeasuredSpeed = false;
+
 QString displayNameFor(const ModelInfo &model) {
     return model.id.isEmpty() ? model.name : model.id;
 }
@@ -61,6 +67,21 @@ QString richFieldText(const QString &label, const QString &value) {
         .arg(label.toHtmlEscaped(), valueOrFallback(value).toHtmlEscaped());
 }
 
+QString measuredSpeedText(const ModelLatencySummary &stats) {
+    if (stats.samples == 0)
+        return QStringLiteral("N/A");
+    QStringList parts;
+    if (stats.firstTokenP50Ms >= 0) {
+        parts.append(QStringLiteral("first token p50 %1 ms / p90 %2 ms")
+                         .arg(stats.firstTokenP50Ms)
+                         .arg(stats.firstTokenP90Ms));
+    }
+    if (stats.tokensPerSecondP50 > 0.0)
+        parts.append(QStringLiteral("%1 tok/s").arg(stats.tokensPerSecondP50, 0, 'f', 1));
+    parts.append(QStringLiteral("errors %1%").arg(qRound(stats.errorRate * 100.0)));
+    return QStringLiteral("%1 (n=%2)").arg(parts.join(QStringLiteral("; "))).arg(stats.samples);
+}
+
 bool modelLessThan(const ModelInfo &left, const ModelInfo &right) {
     return QString::localeAwareCompare(displayNameFor(left).toLower(), displayNameFor(right).toLower()) < 0;
 }
@@ -166,6 +187,24 @@ public:
         invalidateFilter();
     }
 
+    void setSortBySpeed(bool enabled) {
+        firstTokenMs.clear();
+        if (!enabled) {
+            sort(-1);
+            return;
+        }
+        // Snapshot the medians once; lessThan runs O(n log n) times
+        ModelStatsStore *stats = ModelStatsStore::instance();
+        for (int row = 1; row < sourceModel()->rowCount(); ++row) {
+            const QString modelId = sourceModel()->index(row, 0).data(ModelIdRole).toString();
+            const qint64 median = stats->summary(modelId).firstTokenP50Ms;
+            if (median >= 0)
+                firstTokenMs.insert(modelId, median);
+        }
+        invalidate();
+        sort(0);
+    }
+
 protected:
     bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override {
         if (sourceRow == 0 || filterText.isEmpty())
@@ -177,8 +216,25 @@ protected:
         return displayName.contains(filterText) || modelName.contains(filterText);
     }
 
+    bool lessThan(const QModelIndex &left, const QModelIndex &right) const override {
+        // The empty row stays on top, measured models follow fastest first,
+        // and unmeasured ones keep the source's alphabetical order
+        if (left.row() == 0 || right.row() == 0)
+            return left.row() == 0 && right.row() != 0;
+        const auto leftIt = firstTokenMs.constFind(left.data(ModelIdRole).toString());
+        const auto rightIt = firstTokenMs.constFind(right.data(ModelIdRole).toString());
+        const bool leftMeasured = leftIt != firstTokenMs.constEnd();
+        const bool rightMeasured = rightIt != firstTokenMs.constEnd();
+        if (leftMeasured != rightMeasured)
+            return leftMeasured;
+        if (leftMeasured && *leftIt != *rightIt)
+            return *leftIt < *rightIt;
+        return left.row() < right.row();
+    }
+
 private:
     QString filterText;
+    QHash<QString, qint64> firstTokenMs;
 };
 
 class ModelListDelegate : public QStyledItemDelegate {
@@ -298,6 +354,7 @@ void ModelSelectBox::setModels(const ModelInfoList &models) {
         return;
     searchEdit->setEnabled(true);
     modelListModel->setModels(loadedModels);
+    proxyModel->setSortBySpeed(sortByMeasuredSpeed);
     rebuildRows();
     stack->setCurrentWidget(modelListView);
     searchEdit->setFocus(Qt::PopupFocusReason);
@@ -417,7 +474,17 @@ void ModelSelectBox::ensurePopup() {
     searchEdit = new QLineEdit(popup);
     searchEdit->setPlaceholderText(QStringLiteral("Search models"));
     searchEdit->installEventFilter(this);
-    layout->addWidget(searchEdit);
+
+    speedSortCheckBox = new QCheckBox(QStringLiteral("Fastest first"), popup);
+    speedSortCheckBox->setToolTip(QStringLiteral("Sort by measured median time to first token"));
+    speedSortCheckBox->setChecked(sortByMeasuredSpeed);
+    speedSortCheckBox->setFocusPolicy(Qt::NoFocus);
+
+    auto *searchRow = new QHBoxLayout();
+    searchRow->setContentsMargins(0, 0, 6, 0);
+    searchRow->addWidget(searchEdit, 1);
+    searchRow->addWidget(speedSortCheckBox);
+    layout->addLayout(searchRow);
 
     stack = new QStackedWidget(popup);
     layout->addWidget(stack, 1);
@@ -451,6 +518,19 @@ void ModelSelectBox::ensurePopup() {
     stack->addWidget(modelListView);
 
     connect(searchEdit, &QLineEdit::textChanged, this, &ModelSelectBox::rebuildRows);
+    connect(speedSortCheckBox, &QCheckBox::toggled, this, [this](bool checked) {
+        sortByMeasuredSpeed = checked;
+        if (!popupLoading)
+            proxyModel->setSortBySpeed(checked);
+        updateCurrentIndexLater();
+    });
+    // The proxy sorts on a snapshot of the medians; retake it as samples arrive
+    connect(ModelStatsStore::instance(), &ModelStatsStore::statsChanged, this, [this]() {
+        if (!sortByMeasuredSpeed || popupLoading)
+            return;
+        proxyModel->setSortBySpeed(true);
+        updateCurrentIndexLater();
+    });
     connect(modelListView, &QListView::clicked, this, [this](const QModelIndex &index) {
         if (!index.isValid())
             return;
@@ -543,16 +623,21 @@ void ModelSelectBox::showTooltipFor(const ModelInfo &model, const QRect &globalA
         tooltipPricing->setWordWrap(true);
         tooltipKnowledge = new QLabel(tooltip);
         tooltipKnowledge->setWordWrap(true);
+        tooltipSpeed = new QLabel(tooltip);
+        tooltipSpeed->setWordWrap(true);
         layout->addWidget(tooltipName);
         layout->addWidget(tooltipDescription);
         layout->addWidget(tooltipPricing);
         layout->addWidget(tooltipKnowledge);
+        layout->addWidget(tooltipSpeed);
     }
 
     tooltipName->setText(richFieldText(QStringLiteral("Name"), model.name));
     tooltipDescription->setText(richFieldText(QStringLiteral("Description"), model.description));
     tooltipPricing->setText(richFieldText(QStringLiteral("Pricing"), pricingValueFor(model)));
     tooltipKnowledge->setText(richFieldText(QStringLiteral("Knowledge cutoff"), model.knowledgeCutoff));
+    tooltipSpeed->setText(richFieldText(QStringLiteral("Measured"),
+                                        measuredSpeedText(ModelStatsStore::instance()->summary(model.id))));
     tooltip->setFixedWidth(kTooltipWidth);
     tooltip->adjustSize();
 
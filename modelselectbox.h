@@ -7,6 +7,7 @@
 
 #include "modelinfo.h"
 
+class QCheckBox;
 class QFrame;
 class QLabel;
 class QLineEdit;
@@ -44,6 +45,7 @@ protected:
 private:
     QFrame *popup = nullptr;
     QLineEdit *searchEdit = nullptr;
+    QCheckBox *speedSortCheckBox = nullptr;
     QStackedWidget *stack = nullptr;
     QWidget *loadingPage = nullptr;
     QLabel *loadingLabel = nullptr;
@@ -55,6 +57,7 @@ private:
     QLabel *tooltipDescription = nullptr;
     QLabel *tooltipPricing = nullptr;
     QLabel *tooltipKnowledge = nullptr;
+    QLabel *tooltipSpeed = nullptr;
     ModelInfoList loadedModels;
     QString selectedModelId;
     QString noSelectionLabel;
@@ -0,0 +1,180 @@
+#include "modelstats.h"
+#include "backgroundwriter.h"
+#include "perflog.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+
+#include <algorithm>
+
+namespace {
+// Rolling window per model; older samples no longer reflect the network
+constexpr int kMaxSamplesPerModel = 200;
+constexpr int kSaveDelayMs = 2000;
+
+template <typename T>
+T percentile(QList<T> values, double fraction) {
+    std::sort(values.begin(), values.end());
+    const int rank = qBound(0, static_cast<int>(fraction * values.size() + 0.5) - 1,
+                            static_cast<int>(values.size()) - 1);
+    return values.at(rank);
+}
+}
+
+ModelStatsStore *ModelStatsStore::instance() {
+    static ModelStatsStore *store = new ModelStatsStore(QCoreApplication::instance());
+    return store;
+}
+
+ModelStatsStore::ModelStatsStore(QObject *parent)
+    : QObject(parent)
+    , saveTimer(new QTimer(this)) {
+    const QString dataDir = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation)
+                            + QDir::separator()
+                            + QCoreApplication::applicationName();
+    filePath = dataDir + QDir::separator() + QStringLiteral("model-stats.json");
+    saveTimer->setSingleShot(true);
+    connect(saveTimer, &QTimer::timeout, this, &ModelStatsStore::save);
+    // The writer is another child of the application and may be gone by
+    // the time this store is destroyed
+    connect(qApp, &QCoreApplication::aboutToQuit, this, &ModelStatsStore::flush);
+    load();
+}
+
+ModelStatsStore::~ModelStatsStore() = default;
+
+void ModelStatsStore::record(const QString &modelId, qint64 firstTokenMs, double tokensPerSecond, bool failed) {
+    const QString key = modelId.trimmed();
+    if (key.isEmpty())
+        return;
+    QList<Sample> &modelSamples = samples[key];
+    Sample sample;
+    sample.firstTokenMs = firstTokenMs;
+    sample.tokensPerSecond = tokensPerSecond;
+    sample.failed = failed;
+    modelSamples.append(sample);
+    if (modelSamples.size() > kMaxSamplesPerModel)
+        modelSamples.remove(0, modelSamples.size() - kMaxSamplesPerModel);
+    summaries.remove(key);
+    // Requests finish in bursts, so write once things settle
+    saveTimer->start(kSaveDelayMs);
+    emit statsChanged();
+}
+
+void ModelStatsStore::recordStream(const QString &modelId, qint64 firstTokenMs, qint64 elapsedMs, int tokens,
+                                   bool failed) {
+    const qint64 generationMs = elapsedMs - firstTokenMs;
+    const double tokensPerSecond = !failed && firstTokenMs >= 0 && tokens > 0 && generationMs > 0
+        ? tokens * 1000.0 / generationMs
+        : 0.0;
+    record(modelId, failed ? -1 : firstTokenMs, tokensPerSecond, failed);
+}
+
+ModelLatencySummary ModelStatsStore::summary(const QString &modelId) const {
+    const QString key = modelId.trimmed();
+    const auto cached = summaries.constFind(key);
+    if (cached != summaries.constEnd())
+        return *cached;
+
+    ModelLatencySummary result;
+    const auto it = samples.constFind(key);
+    if (it == samples.constEnd() || it->isEmpty())
+        return result;
+
+    QList<qint64> firstTokens;
+    QList<double> rates;
+    int failures = 0;
+    for (const Sample &sample : *it) {
+        if (sample.failed) {
+            ++failures;
+            continue;
+        }
+        if (sample.firstTokenMs >= 0)
+            firstTokens.append(sample.firstTokenMs);
+        if (sample.tokensPerSecond > 0.0)
+            rates.append(sample.tokensPerSecond);
+    }
+    result.samples = static_cast<int>(it->size());
+    result.errorRate = static_cast<double>(failures) / it->size();
+    if (!firstTokens.isEmpty()) {
+        result.firstTokenP50Ms = percentile(firstTokens, 0.5);
+        result.firstTokenP90Ms = percentile(firstTokens, 0.9);
+    }
+    if (!rates.isEmpty())
+        result.tokensPerSecondP50 = percentile(rates, 0.5);
+    summaries.insert(key, result);
+    return result;
+}
+
+void ModelStatsStore::load() {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    for (auto it = root.constBegin(); it != root.constEnd(); ++it) {
+        QList<Sample> &modelSamples = samples[it.key()];
+        const QJsonArray array = it.value().toArray();
+        for (const QJsonValue &value : array) {
+            const QJsonArray fields = value.toArray();
+            if (fields.size() < 3)
+                continue;
+            Sample sample;
+            sample.firstTokenMs = static_cast<qint64>(fields.at(0).toDouble(-1));
+            sample.tokensPerSecond = fields.at(1).toDouble();
+            sample.failed = fields.at(2).toBool();
+            modelSamples.append(sample);
+        }
+    }
+}
+
+void ModelStatsStore::save() {
+    saveTimer->stop();
+    QJsonObject root;
+    for (auto it = samples.constBegin(); it != samples.constEnd(); ++it) {
+        QJsonArray array;
+        for (const Sample &sample : it.value())
+            array.append(QJsonArray{static_cast<double>(sample.firstTokenMs), sample.tokensPerSecond, sample.failed});
+        root.insert(it.key(), array);
+    }
+
+    // Serializing is cheap; the file system is what may stall
+    const QByteArray data = QJsonDocument(root).toJson(QJsonDocument::Compact);
+    const QString path = filePath;
+    BackgroundWriter::instance()->post([path, data]() {
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly))
+            return false;
+        file.write(data);
+        if (!file.commit()) {
+            qCDebug(lcPerf) << "could not save model stats to" << path;
+            return false;
+        }
+        return true;
+    });
+}
+
+void ModelStatsStore::flush() {
+    if (saveTimer->isActive())
+        save();
+    BackgroundWriter::instance()->waitForIdle();
+}
+
+QString streamStatsText(const QString &modelName, qint64 firstTokenMs, qint64 elapsedMs, int tokens) {
+    QString text = modelName.isEmpty() ? QStringLiteral("Default model") : modelName;
+    if (firstTokenMs < 0)
+        return text;
+    text += QStringLiteral("  |  first token %1 ms").arg(firstTokenMs);
+    const qint64 generationMs = elapsedMs - firstTokenMs;
+    if (tokens > 0 && generationMs > 0)
+        text += QStringLiteral("  |  %1 tok/s").arg(tokens * 1000.0 / generationMs, 0, 'f', 1);
+    return text;
+}
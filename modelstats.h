@@ -0,0 +1,63 @@
+#ifndef MODELSTATS_H
+#define MODELSTATS_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+
+class QTimer;
+
+struct ModelLatencySummary {
+    int samples = 0;
+    qint64 firstTokenP50Ms = -1;
+    qint64 firstTokenP90Ms = -1;
+    double tokensPerSecondP50 = 0.0;
+    double errorRate = 0.0;
+};
+
+// Measured latency and throughput per model, kept over the most recent
+// requests and saved next to the application data so model choice can
+// follow real speed on the user's own network.
+class ModelStatsStore : public QObject {
+    Q_OBJECT
+
+public:
+    static ModelStatsStore *instance();
+    ~ModelStatsStore() override;
+
+    // firstTokenMs < 0 when no token arrived
+    void record(const QString &modelId, qint64 firstTokenMs, double tokensPerSecond, bool failed);
+    // Records a finished stream from its timings and completion tokens
+    void recordStream(const QString &modelId, qint64 firstTokenMs, qint64 elapsedMs, int tokens, bool failed);
+    ModelLatencySummary summary(const QString &modelId) const;
+
+signals:
+    void statsChanged();
+
+private:
+    struct Sample {
+        qint64 firstTokenMs = -1;
+        double tokensPerSecond = 0.0;
+        bool failed = false;
+    };
+
+    explicit ModelStatsStore(QObject *parent = nullptr);
+
+    QHash<QString, QList<Sample>> samples;
+    // Percentiles sort the samples, so summaries are kept until a model
+    // gets a new sample
+    mutable QHash<QString, ModelLatencySummary> summaries;
+    QTimer *saveTimer;
+    QString filePath;
+
+    void load();
+    void save();
+    void flush();
+};
+
+// Label for a response pane: the model, its first-token latency and, once
+// tokens are known, its throughput
+QString streamStatsText(const QString &modelName, qint64 firstTokenMs, qint64 elapsedMs, int tokens);
+
+#endif // MODELSTATS_H
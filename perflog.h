@@ -0,0 +1,10 @@
+#ifndef PERFLOG_H
+#define PERFLOG_H
+
+#include <QLoggingCategory>
+
+// Timing and counter reports. Disabled by default, enable with
+// QT_LOGGING_RULES="desktopllmhelper.perf.debug=true".
+Q_DECLARE_LOGGING_CATEGORY(lcPerf)
+
+#endif // PERFLOG_H
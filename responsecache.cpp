@@ -0,0 +1,210 @@
+#include "responsecache.h"
+#include "backgroundwriter.h"
+#include "perflog.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QList>
+#include <QPointer>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+
+namespace {
+constexpr qint64 kDefaultMaxBytes = 20 * 1024 * 1024;
+const QString kEntrySuffix = QStringLiteral(".txt");
+}
+
+ResponseCache::ResponseCache(QObject *parent)
+    : QObject(parent)
+    , writer(BackgroundWriter::instance())
+    , indexLoaded(false)
+    , totalBytes(0)
+    , maxBytes(kDefaultMaxBytes)
+    , hitCount(0)
+    , missCount(0) {
+    directory = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+        + QDir::separator() + QCoreApplication::applicationName()
+        + QDir::separator() + QStringLiteral("responses");
+    loadIndex();
+}
+
+ResponseCache::~ResponseCache() {
+    // Queued jobs call back into this object
+    writer->waitForIdle();
+}
+
+QByteArray ResponseCache::keyFor(const QString &endpoint, const QJsonObject &requestBody) {
+    // QJsonObject keeps its keys sorted, so equal requests serialize equally
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(endpoint.trimmed().toUtf8());
+    hash.addData(QByteArrayView("\n"));
+    hash.addData(QJsonDocument(requestBody).toJson(QJsonDocument::Compact));
+    return hash.result().toHex();
+}
+
+void ResponseCache::setMaxBytes(qint64 bytes) {
+    maxBytes = qMax<qint64>(0, bytes);
+    if (indexLoaded)
+        evict();
+}
+
+bool ResponseCache::lookup(const QByteArray &key, QObject *receiver, LookupCallback done) {
+    // A lookup before the startup scan finished is a miss; the request just
+    // goes to the server
+    const auto it = entries.find(key);
+    if (it == entries.end()) {
+        ++missCount;
+        emit statsChanged();
+        return false;
+    }
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    it->lastUsedMs = now.toMSecsSinceEpoch();
+
+    const QString path = pathFor(key);
+    const QPointer<QObject> target(receiver);
+    writer->post([this, key, path, now, target, done]() {
+        QFile file(path);
+        const bool found = file.open(QIODevice::ReadWrite);
+        const QString text = found ? QString::fromUtf8(file.readAll()) : QString();
+        // Touch the entry so eviction after a restart sees it as recently used
+        if (found)
+            file.setFileTime(now, QFileDevice::FileModificationTime);
+        QMetaObject::invokeMethod(this, [this, key, found, text, target, done]() {
+            if (found) {
+                ++hitCount;
+                qCDebug(lcPerf) << "response cache hit," << hitCount << "hits" << missCount << "misses";
+            } else {
+                const auto entry = entries.find(key);
+                if (entry != entries.end()) {
+                    totalBytes -= entry->size;
+                    entries.erase(entry);
+                }
+                ++missCount;
+            }
+            emit statsChanged();
+            if (target && done)
+                done(text);
+        }, Qt::QueuedConnection);
+        return false;
+    });
+    return true;
+}
+
+void ResponseCache::store(const QByteArray &key, const QString &text) {
+    if (maxBytes <= 0 || text.isEmpty())
+        return;
+    const QByteArray data = text.toUtf8();
+    if (data.size() > maxBytes)
+        return;
+
+    const QString dir = directory;
+    const QString path = pathFor(key);
+    writer->post([dir, path, data]() {
+        QDir().mkpath(dir);
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly))
+            return false;
+        file.write(data);
+        return file.commit();
+    });
+
+    const auto it = entries.find(key);
+    if (it != entries.end())
+        totalBytes -= it->size;
+    Entry entry;
+    entry.size = data.size();
+    entry.lastUsedMs = QDateTime::currentMSecsSinceEpoch();
+    entries.insert(key, entry);
+    totalBytes += entry.size;
+    evict();
+    emit statsChanged();
+}
+
+int ResponseCache::hits() const {
+    return hitCount;
+}
+
+int ResponseCache::misses() const {
+    return missCount;
+}
+
+int ResponseCache::entryCount() const {
+    return static_cast<int>(entries.size());
+}
+
+qint64 ResponseCache::sizeBytes() const {
+    return totalBytes;
+}
+
+void ResponseCache::loadIndex() {
+    const QString dir = directory;
+    writer->post([this, dir]() {
+        QHash<QByteArray, Entry> scanned;
+        const QFileInfoList files = QDir(dir).entryInfoList(
+            QStringList{QStringLiteral("*") + kEntrySuffix}, QDir::Files);
+        for (const QFileInfo &info : files) {
+            Entry entry;
+            entry.size = info.size();
+            entry.lastUsedMs = info.lastModified().toMSecsSinceEpoch();
+            scanned.insert(info.completeBaseName().toLatin1(), entry);
+        }
+        QMetaObject::invokeMethod(this, [this, scanned]() {
+            mergeIndex(scanned);
+        }, Qt::QueuedConnection);
+        return false;
+    });
+}
+
+void ResponseCache::mergeIndex(const QHash<QByteArray, Entry> &scanned) {
+    // Replies stored while the scan ran are newer than what it found
+    for (auto it = scanned.constBegin(); it != scanned.constEnd(); ++it) {
+        if (entries.contains(it.key()))
+            continue;
+        entries.insert(it.key(), it.value());
+        totalBytes += it->size;
+    }
+    indexLoaded = true;
+    qCDebug(lcPerf) << "response cache index has" << entries.size() << "entries," << totalBytes << "bytes";
+    evict();
+    emit statsChanged();
+}
+
+QString ResponseCache::pathFor(const QByteArray &key) const {
+    return directory + QDir::separator() + QString::fromLatin1(key) + kEntrySuffix;
+}
+
+void ResponseCache::removeFiles(const QStringList &paths) {
+    if (paths.isEmpty())
+        return;
+    writer->post([paths]() {
+        for (const QString &path : paths)
+            QFile::remove(path);
+        return true;
+    });
+}
+
+void ResponseCache::evict() {
+    if (totalBytes <= maxBytes)
+        return;
+
+    QList<QByteArray> keys = entries.keys();
+    std::sort(keys.begin(), keys.end(), [this](const QByteArray &a, const QByteArray &b) {
+        return entries.value(a).lastUsedMs < entries.value(b).lastUsedMs;
+    });
+    QStringList evicted;
+    for (const QByteArray &key : keys) {
+        if (totalBytes <= maxBytes)
+            break;
+        totalBytes -= entries.take(key).size;
+        evicted.append(pathFor(key));
+    }
+    removeFiles(evicted);
+    qCDebug(lcPerf) << "response cache evicted" << evicted.size() << "entries, now" << totalBytes << "bytes";
+}
@@ -0,0 +1,70 @@
+#ifndef RESPONSECACHE_H
+#define RESPONSECACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QJsonObject>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+
+class BackgroundWriter;
+
+// On-disk, content-addressed cache of finished replies. Each entry is one
+// file named after the SHA-256 of the endpoint and request body; the file
+// modification time doubles as the last-use stamp for LRU eviction.
+// The index lives in memory and is scanned once at startup; reading,
+// writing and deleting entry files all happen on the background writer, so
+// a lookup never blocks the GUI thread.
+class ResponseCache : public QObject {
+    Q_OBJECT
+
+public:
+    // Gets the cached text, or an empty string when the entry could not be read
+    using LookupCallback = std::function<void(const QString &text)>;
+
+    explicit ResponseCache(QObject *parent = nullptr);
+    ~ResponseCache() override;
+
+    static QByteArray keyFor(const QString &endpoint, const QJsonObject &requestBody);
+
+    void setMaxBytes(qint64 bytes);
+    // Returns false at once when the index has no entry. Otherwise the entry
+    // is read in the background and done is called on receiver's thread,
+    // unless receiver is gone by then.
+    bool lookup(const QByteArray &key, QObject *receiver, LookupCallback done);
+    void store(const QByteArray &key, const QString &text);
+
+    int hits() const;
+    int misses() const;
+    int entryCount() const;
+    qint64 sizeBytes() const;
+
+signals:
+    void statsChanged();
+
+private:
+    struct Entry {
+        qint64 size = 0;
+        qint64 lastUsedMs = 0;
+    };
+
+    QString directory;
+    BackgroundWriter *writer;
+    QHash<QByteArray, Entry> entries;
+    bool indexLoaded;
+    qint64 totalBytes;
+    qint64 maxBytes;
+    int hitCount;
+    int missCount;
+
+    void loadIndex();
+    void mergeIndex(const QHash<QByteArray, Entry> &scanned);
+    QString pathFor(const QByteArray &key) const;
+    void removeFiles(const QStringList &paths);
+    void evict();
+};
+
+#endif // RESPONSECACHE_H
@@ -0,0 +1,132 @@
+#include "selectioncapture.h"
+#include "perflog.h"
+
+#include <QMetaObject>
+#include <QTimer>
+#include <QUuid>
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+// The old fixed wait; still used until there is enough history
+constexpr int kMaxTimeoutMs = 500;
+// Applications that usually copy within a few milliseconds still answer late
+// now and then (first copy after idle, large selections); below this a slow
+// copy would lose the selection rather than cost a little time
+constexpr int kMinTimeoutMs = 250;
+constexpr int kTimeoutLatencyFactor = 3;
+constexpr int kMinAdaptiveSamples = 5;
+constexpr int kMaxLatencySamples = 64;
+// Change notifications can be coalesced or lost, so the sequence number is
+// also checked on a timer; this reads a counter, it does not pump events
+constexpr int kPollIntervalMs = 15;
+}
+
+SelectionCapture::SelectionCapture(ClipboardSource *source, QObject *parent)
+    : QObject(parent)
+    , source(source)
+    , pollTimer(new QTimer(this))
+    , timeoutTimer(new QTimer(this))
+    , markerSequence(0)
+    , timeouts(0) {
+    source->setParent(this);
+    connect(source, &ClipboardSource::changed, this, &SelectionCapture::checkClipboard);
+    pollTimer->setInterval(kPollIntervalMs);
+    connect(pollTimer, &QTimer::timeout, this, &SelectionCapture::checkClipboard);
+    timeoutTimer->setSingleShot(true);
+    connect(timeoutTimer, &QTimer::timeout, this, [this]() {
+        ++timeouts;
+        finish(QString());
+    });
+}
+
+void SelectionCapture::capture(QObject *receiver, Callback done) {
+    if (isActive())
+        finish(QString());
+
+    pendingReceiver = receiver;
+    pendingCallback = std::move(done);
+    marker = QStringLiteral("DesktopLLMHelper-clipboard-marker-%1")
+                 .arg(QUuid::createUuid().toString(QUuid::WithoutBraces));
+    source->writeMarker(marker);
+    markerSequence = source->sequenceNumber();
+    clock.start();
+    source->requestCopy();
+    timeoutTimer->start(timeoutMs());
+    pollTimer->start();
+}
+
+void SelectionCapture::cancel(QObject *receiver) {
+    if (isActive() && pendingReceiver == receiver)
+        stop();
+}
+
+bool SelectionCapture::isActive() const {
+    return static_cast<bool>(pendingCallback);
+}
+
+int SelectionCapture::timeoutMs() const {
+    if (latencies.size() < kMinAdaptiveSamples)
+        return kMaxTimeoutMs;
+    const qint64 adaptive = latencyPercentileMs(0.9) * kTimeoutLatencyFactor;
+    return static_cast<int>(qBound<qint64>(kMinTimeoutMs, adaptive, kMaxTimeoutMs));
+}
+
+qint64 SelectionCapture::latencyPercentileMs(double fraction) const {
+    if (latencies.isEmpty())
+        return -1;
+    QList<qint64> sorted = latencies;
+    std::sort(sorted.begin(), sorted.end());
+    const int rank = qBound(0, static_cast<int>(fraction * sorted.size() + 0.5) - 1,
+                            static_cast<int>(sorted.size()) - 1);
+    return sorted.at(rank);
+}
+
+int SelectionCapture::timeoutCount() const {
+    return timeouts;
+}
+
+void SelectionCapture::checkClipboard() {
+    if (!isActive())
+        return;
+    const quint64 sequence = source->sequenceNumber();
+    if (sequence == markerSequence)
+        return;
+    // Read each new content once; an empty one may be a copy still in progress
+    markerSequence = sequence;
+    const QString text = source->text();
+    if (text.isEmpty() || text == marker)
+        return;
+
+    latencies.append(clock.elapsed());
+    if (latencies.size() > kMaxLatencySamples)
+        latencies.removeFirst();
+    finish(text);
+}
+
+void SelectionCapture::finish(const QString &text) {
+    const QPointer<QObject> receiver = pendingReceiver;
+    const Callback done = pendingCallback;
+    const qint64 elapsed = clock.elapsed();
+    stop();
+    qCDebug(lcPerf) << "selection capture" << (text.isEmpty() ? "found nothing" : "done") << "after"
+                    << elapsed << "ms, p50" << latencyPercentileMs(0.5) << "ms p90"
+                    << latencyPercentileMs(0.9) << "ms, next timeout" << timeoutMs() << "ms,"
+                    << timeouts << "timeouts";
+
+    // Queued so callers may touch the clipboard again outside its notification
+    if (receiver && done) {
+        QMetaObject::invokeMethod(receiver, [done, text]() {
+            done(text);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void SelectionCapture::stop() {
+    pollTimer->stop();
+    timeoutTimer->stop();
+    pendingReceiver = nullptr;
+    pendingCallback = nullptr;
+    marker.clear();
+}
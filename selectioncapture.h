@@ -0,0 +1,74 @@
+#ifndef SELECTIONCAPTURE_H
+#define SELECTIONCAPTURE_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+
+#include <functional>
+
+class QTimer;
+
+// What selection capture needs from the system clipboard. The real one sends
+// Ctrl+C to the foreground window; a fake can script changes and timing.
+class ClipboardSource : public QObject {
+    Q_OBJECT
+
+public:
+    using QObject::QObject;
+
+    // Changes whenever the clipboard content is replaced
+    virtual quint64 sequenceNumber() const = 0;
+    virtual QString text() const = 0;
+    virtual void writeMarker(const QString &marker) = 0;
+    virtual void requestCopy() = 0;
+
+signals:
+    void changed();
+};
+
+// Copies the current selection without spinning a nested event loop. A marker
+// goes on the clipboard, Ctrl+C is sent, and the capture completes on the first
+// change notification carrying other text. The timeout follows the measured
+// copy latency, so a missing selection stops costing the full worst case.
+class SelectionCapture : public QObject {
+    Q_OBJECT
+
+public:
+    using Callback = std::function<void(const QString &text)>;
+
+    // Takes ownership of source
+    explicit SelectionCapture(ClipboardSource *source, QObject *parent = nullptr);
+
+    // done is queued to receiver with the selected text, or an empty string
+    // on timeout or when a newer capture replaces this one
+    void capture(QObject *receiver, Callback done);
+    // Drops receiver's pending capture without calling it back
+    void cancel(QObject *receiver);
+    bool isActive() const;
+
+    int timeoutMs() const;
+    // Over recent successful captures, -1 without data
+    qint64 latencyPercentileMs(double fraction) const;
+    int timeoutCount() const;
+
+private:
+    ClipboardSource *source;
+    QTimer *pollTimer;
+    QTimer *timeoutTimer;
+    QPointer<QObject> pendingReceiver;
+    Callback pendingCallback;
+    QString marker;
+    quint64 markerSequence;
+    QElapsedTimer clock;
+    QList<qint64> latencies;
+    int timeouts;
+
+    void checkClipboard();
+    void finish(const QString &text);
+    void stop();
+};
+
+#endif // SELECTIONCAPTURE_H
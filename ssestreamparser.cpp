@@ -0,0 +1,212 @@
+#include "ssestreamparser.h"
+
+#include <cstring>
+#include <limits>
+
+namespace {
+constexpr char kUtf8Bom[] = "\xEF\xBB\xBF";
+constexpr qsizetype kUtf8BomSize = 3;
+
+bool fieldIs(const char *field, qsizetype length, const char *name) {
+    const qsizetype nameLength = static_cast<qsizetype>(std::strlen(name));
+    return length == nameLength && std::memcmp(field, name, static_cast<size_t>(length)) == 0;
+}
+
+bool parseRetry(const char *value, qsizetype length, int *retryMs) {
+    if (length <= 0)
+        return false;
+    qint64 result = 0;
+    for (qsizetype i = 0; i < length; ++i) {
+        const char ch = value[i];
+        if (ch < '0' || ch > '9')
+            return false;
+        result = result * 10 + (ch - '0');
+        if (result > std::numeric_limits<int>::max())
+            return false;
+    }
+    *retryMs = static_cast<int>(result);
+    return true;
+}
+}
+
+void SseStreamParser::feed(const QByteArray &chunk) {
+    if (chunk.isEmpty())
+        return;
+    compact();
+    buffer.append(chunk);
+}
+
+qsizetype SseStreamParser::bufferedBytes() const {
+    return buffer.capacity() + dataBuffer.capacity();
+}
+
+void SseStreamParser::finish() {
+    streamEnded = true;
+}
+
+bool SseStreamParser::readEvent(SseEvent *event) {
+    if (!checkBom())
+        return false;
+
+    const char *line = nullptr;
+    qsizetype length = 0;
+    while (takeLine(&line, &length)) {
+        if (length == 0) {
+            if (dispatch(event))
+                return true;
+            continue;
+        }
+        processLine(line, length);
+    }
+
+    // Providers may close the connection without a trailing blank line,
+    // so the last pending event is still delivered at end of stream.
+    if (streamEnded)
+        return dispatch(event);
+    return false;
+}
+
+void SseStreamParser::reset() {
+    buffer.clear();
+    readPos = 0;
+    scanPos = 0;
+    skipLineFeed = false;
+    bomChecked = false;
+    streamEnded = false;
+    dataSeen = false;
+    eventType.clear();
+    dataBuffer.clear();
+    eventId.clear();
+    retryMs = -1;
+}
+
+bool SseStreamParser::sawData() const {
+    return dataSeen;
+}
+
+QByteArray SseStreamParser::lastEventId() const {
+    return eventId;
+}
+
+int SseStreamParser::retryInterval() const {
+    return retryMs;
+}
+
+bool SseStreamParser::checkBom() {
+    if (bomChecked)
+        return true;
+
+    const qsizetype available = qMin(buffer.size() - readPos, kUtf8BomSize);
+    if (std::memcmp(buffer.constData() + readPos, kUtf8Bom, static_cast<size_t>(available)) != 0) {
+        bomChecked = true;
+        return true;
+    }
+    if (available < kUtf8BomSize) {
+        if (!streamEnded)
+            return false;
+        bomChecked = true;
+        return true;
+    }
+
+    readPos += kUtf8BomSize;
+    scanPos = qMax(scanPos, readPos);
+    bomChecked = true;
+    return true;
+}
+
+void SseStreamParser::compact() {
+    if (readPos == 0)
+        return;
+    if (readPos >= buffer.size()) {
+        // resize keeps the allocated capacity for the next chunk
+        buffer.resize(0);
+        readPos = 0;
+        scanPos = 0;
+        return;
+    }
+    // Shift only once the consumed prefix dominates, so the cost stays amortized linear
+    if (readPos < buffer.size() / 2)
+        return;
+    buffer.remove(0, readPos);
+    scanPos -= readPos;
+    readPos = 0;
+}
+
+bool SseStreamParser::takeLine(const char **line, qsizetype *length) {
+    const char *data = buffer.constData();
+    const qsizetype size = buffer.size();
+
+    if (skipLineFeed && readPos < size) {
+        if (data[readPos] == '\n')
+            ++readPos;
+        skipLineFeed = false;
+        scanPos = qMax(scanPos, readPos);
+    }
+
+    for (qsizetype i = qMax(scanPos, readPos); i < size; ++i) {
+        const char ch = data[i];
+        if (ch != '\n' && ch != '\r')
+            continue;
+        *line = data + readPos;
+        *length = i - readPos;
+        readPos = i + 1;
+        scanPos = readPos;
+        // A CR may be the first half of a CRLF split across chunks
+        skipLineFeed = (ch == '\r');
+        return true;
+    }
+    scanPos = size;
+
+    if (streamEnded && readPos < size) {
+        *line = data + readPos;
+        *length = size - readPos;
+        readPos = size;
+        return true;
+    }
+    return false;
+}
+
+void SseStreamParser::processLine(const char *line, qsizetype length) {
+    if (line[0] == ':')
+        return;
+
+    const auto *colon = static_cast<const char *>(std::memchr(line, ':', static_cast<size_t>(length)));
+    const qsizetype fieldLength = colon ? colon - line : length;
+    const char *value = colon ? colon + 1 : line + length;
+    qsizetype valueLength = colon ? length - fieldLength - 1 : 0;
+    if (valueLength > 0 && value[0] == ' ') {
+        ++value;
+        --valueLength;
+    }
+
+    if (fieldIs(line, fieldLength, "data")) {
+        dataBuffer.append(value, valueLength);
+        dataBuffer.append('\n');
+        dataSeen = true;
+    } else if (fieldIs(line, fieldLength, "event")) {
+        eventType = QByteArray(value, valueLength);
+    } else if (fieldIs(line, fieldLength, "id")) {
+        if (!std::memchr(value, '\0', static_cast<size_t>(valueLength)))
+            eventId = QByteArray(value, valueLength);
+    } else if (fieldIs(line, fieldLength, "retry")) {
+        parseRetry(value, valueLength, &retryMs);
+    }
+}
+
+bool SseStreamParser::dispatch(SseEvent *event) {
+    if (dataBuffer.isEmpty()) {
+        eventType.clear();
+        return false;
+    }
+    if (dataBuffer.endsWith('\n'))
+        dataBuffer.chop(1);
+
+    if (event) {
+        event->type = eventType.isEmpty() ? QByteArrayLiteral("message") : eventType;
+        event->data.swap(dataBuffer);
+        event->id = eventId;
+    }
+    dataBuffer.clear();
+    eventType.clear();
+    return true;
+}
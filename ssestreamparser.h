@@ -0,0 +1,50 @@
+#ifndef SSESTREAMPARSER_H
+#define SSESTREAMPARSER_H
+
+#include <QByteArray>
+
+struct SseEvent {
+    QByteArray type;
+    QByteArray data;
+    QByteArray id;
+};
+
+// Incremental text/event-stream parser (WHATWG SSE).
+// Chunks are appended with feed(); readEvent() consumes complete lines behind a
+// read cursor, so split events and any mix of CR, LF and CRLF are handled
+// without shifting the remaining buffer for every line.
+class SseStreamParser {
+public:
+    void feed(const QByteArray &chunk);
+    void finish();
+    bool readEvent(SseEvent *event);
+    void reset();
+
+    bool sawData() const;
+    // Bytes currently allocated for unread input and the event being assembled.
+    qsizetype bufferedBytes() const;
+    QByteArray lastEventId() const;
+    int retryInterval() const;
+
+private:
+    QByteArray buffer;
+    qsizetype readPos = 0;
+    qsizetype scanPos = 0;
+    bool skipLineFeed = false;
+    bool bomChecked = false;
+    bool streamEnded = false;
+    bool dataSeen = false;
+
+    QByteArray eventType;
+    QByteArray dataBuffer;
+    QByteArray eventId;
+    int retryMs = -1;
+
+    bool checkBom();
+    void compact();
+    bool takeLine(const char **line, qsizetype *length);
+    void processLine(const char *line, qsizetype length);
+    bool dispatch(SseEvent *event);
+};
+
+#endif // SSESTREAMPARSER_H
@@ -0,0 +1,494 @@
+#include "streamdeltaextractor.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <cstring>
+#include <limits>
+
+namespace {
+constexpr int kMaxDepth = 64;
+
+void appendUtf8(QByteArray *out, uint codePoint) {
+    if (codePoint < 0x80) {
+        out->append(static_cast<char>(codePoint));
+    } else if (codePoint < 0x800) {
+        out->append(static_cast<char>(0xC0 | (codePoint >> 6)));
+        out->append(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    } else if (codePoint < 0x10000) {
+        out->append(static_cast<char>(0xE0 | (codePoint >> 12)));
+        out->append(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+        out->append(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    } else {
+        out->append(static_cast<char>(0xF0 | (codePoint >> 18)));
+        out->append(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+        out->append(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+        out->append(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    }
+}
+
+// Minimal forward-only JSON reader. Every method returns false on anything
+// unexpected so the caller can fall back to the DOM parser.
+class JsonScanner {
+public:
+    JsonScanner(const char *begin, const char *end)
+        : pos(begin)
+        , end(end) {}
+
+    void skipWhitespace() {
+        while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r'))
+            ++pos;
+    }
+
+    bool atEnd() {
+        skipWhitespace();
+        return pos == end;
+    }
+
+    bool consume(char ch) {
+        skipWhitespace();
+        if (pos == end || *pos != ch)
+            return false;
+        ++pos;
+        return true;
+    }
+
+    bool peek(char ch) {
+        skipWhitespace();
+        return pos < end && *pos == ch;
+    }
+
+    bool consumeNull() {
+        skipWhitespace();
+        return consumeLiteral("null");
+    }
+
+    // Keys are compared in place; escaped keys never occur in practice and are
+    // left to the fallback.
+    bool readKey(const char **key, qsizetype *length) {
+        if (!consume('"'))
+            return false;
+        const char *start = pos;
+        while (pos < end && *pos != '"') {
+            if (*pos == '\\' || static_cast<uchar>(*pos) < 0x20)
+                return false;
+            ++pos;
+        }
+        if (pos == end)
+            return false;
+        *key = start;
+        *length = pos - start;
+        ++pos;
+        return consume(':');
+    }
+
+    bool readString(QByteArray *out) {
+        if (!consume('"'))
+            return false;
+        while (pos < end) {
+            const char *runStart = pos;
+            while (pos < end && *pos != '"' && *pos != '\\' && static_cast<uchar>(*pos) >= 0x20)
+                ++pos;
+            if (out && pos > runStart)
+                out->append(runStart, pos - runStart);
+            if (pos == end)
+                return false;
+            const char ch = *pos++;
+            if (ch == '"')
+                return true;
+            if (ch != '\\')
+                return false;
+            if (!readEscape(out))
+                return false;
+        }
+        return false;
+    }
+
+    bool readInt(int *value) {
+        skipWhitespace();
+        bool negative = false;
+        if (pos < end && *pos == '-') {
+            negative = true;
+            ++pos;
+        }
+        if (pos == end || *pos < '0' || *pos > '9')
+            return false;
+        qint64 result = 0;
+        while (pos < end && *pos >= '0' && *pos <= '9') {
+            result = result * 10 + (*pos - '0');
+            if (result > std::numeric_limits<int>::max())
+                return false;
+            ++pos;
+        }
+        if (pos < end && (*pos == '.' || *pos == 'e' || *pos == 'E'))
+            return false;
+        *value = static_cast<int>(negative ? -result : result);
+        return true;
+    }
+
+    bool skipValue(int depth = 0) {
+        if (depth > kMaxDepth)
+            return false;
+        skipWhitespace();
+        if (pos == end)
+            return false;
+        switch (*pos) {
+        case '"':
+            return readString(nullptr);
+        case '{': {
+            ++pos;
+            if (consume('}'))
+                return true;
+            do {
+                if (!readString(nullptr) || !consume(':'))
+                    return false;
+                if (!skipValue(depth + 1))
+                    return false;
+            } while (consume(','));
+            return consume('}');
+        }
+        case '[':
+            ++pos;
+            if (consume(']'))
+                return true;
+            do {
+                if (!skipValue(depth + 1))
+                    return false;
+            } while (consume(','));
+            return consume(']');
+        case 't':
+            return consumeLiteral("true");
+        case 'f':
+            return consumeLiteral("false");
+        case 'n':
+            return consumeLiteral("null");
+        default:
+            return skipNumber();
+        }
+    }
+
+private:
+    const char *pos;
+    const char *end;
+
+    bool consumeLiteral(const char *literal) {
+        const qsizetype length = static_cast<qsizetype>(std::strlen(literal));
+        if (end - pos < length || std::memcmp(pos, literal, static_cast<size_t>(length)) != 0)
+            return false;
+        pos += length;
+        return true;
+    }
+
+    bool skipDigits() {
+        const char *start = pos;
+        while (pos < end && *pos >= '0' && *pos <= '9')
+            ++pos;
+        return pos > start;
+    }
+
+    bool skipNumber() {
+        if (pos < end && *pos == '-')
+            ++pos;
+        if (!skipDigits())
+            return false;
+        if (pos < end && *pos == '.') {
+            ++pos;
+            if (!skipDigits())
+                return false;
+        }
+        if (pos < end && (*pos == 'e' || *pos == 'E')) {
+            ++pos;
+            if (pos < end && (*pos == '+' || *pos == '-'))
+                ++pos;
+            if (!skipDigits())
+                return false;
+        }
+        return true;
+    }
+
+    bool readHex4(uint *value) {
+        if (end - pos < 4)
+            return false;
+        uint result = 0;
+        for (int i = 0; i < 4; ++i) {
+            const char ch = *pos++;
+            result <<= 4;
+            if (ch >= '0' && ch <= '9')
+                result |= static_cast<uint>(ch - '0');
+            else if (ch >= 'a' && ch <= 'f')
+                result |= static_cast<uint>(ch - 'a' + 10);
+            else if (ch >= 'A' && ch <= 'F')
+                result |= static_cast<uint>(ch - 'A' + 10);
+            else
+                return false;
+        }
+        *value = result;
+        return true;
+    }
+
+    bool readEscape(QByteArray *out) {
+        if (pos == end)
+            return false;
+        const char ch = *pos++;
+        char decoded = 0;
+        switch (ch) {
+        case '"': decoded = '"'; break;
+        case '\\': decoded = '\\'; break;
+        case '/': decoded = '/'; break;
+        case 'b': decoded = '\b'; break;
+        case 'f': decoded = '\f'; break;
+        case 'n': decoded = '\n'; break;
+        case 'r': decoded = '\r'; break;
+        case 't': decoded = '\t'; break;
+        case 'u': {
+            uint codePoint = 0;
+            if (!readHex4(&codePoint))
+                return false;
+            if (codePoint >= 0xD800 && codePoint <= 0xDBFF) {
+                uint low = 0;
+                if (end - pos < 2 || pos[0] != '\\' || pos[1] != 'u')
+                    return false;
+                pos += 2;
+                if (!readHex4(&low) || low < 0xDC00 || low > 0xDFFF)
+                    return false;
+                codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+            } else if (codePoint >= 0xDC00 && codePoint <= 0xDFFF) {
+                return false;
+            }
+            if (out)
+                appendUtf8(out, codePoint);
+            return true;
+        }
+        default:
+            return false;
+        }
+        if (out)
+            out->append(decoded);
+        return true;
+    }
+};
+
+bool keyIs(const char *key, qsizetype length, const char *name) {
+    const qsizetype nameLength = static_cast<qsizetype>(std::strlen(name));
+    return length == nameLength && std::memcmp(key, name, static_cast<size_t>(length)) == 0;
+}
+
+bool readNullableString(JsonScanner &scanner, QByteArray *out) {
+    if (scanner.consumeNull())
+        return true;
+    return scanner.readString(out);
+}
+
+bool readMessage(JsonScanner &scanner, QByteArray *content) {
+    if (scanner.consumeNull())
+        return true;
+    if (!scanner.consume('{'))
+        return false;
+    if (scanner.consume('}'))
+        return true;
+    do {
+        const char *key = nullptr;
+        qsizetype length = 0;
+        if (!scanner.readKey(&key, &length))
+            return false;
+        const bool ok = keyIs(key, length, "content")
+            ? readNullableString(scanner, content)
+            : scanner.skipValue();
+        if (!ok)
+            return false;
+    } while (scanner.consume(','));
+    return scanner.consume('}');
+}
+
+bool readChoice(JsonScanner &scanner, QByteArray *deltaText, QByteArray *messageText,
+                QByteArray *finishText) {
+    if (!scanner.consume('{'))
+        return false;
+    if (scanner.consume('}'))
+        return true;
+    do {
+        const char *key = nullptr;
+        qsizetype length = 0;
+        if (!scanner.readKey(&key, &length))
+            return false;
+        bool ok = false;
+        if (keyIs(key, length, "delta"))
+            ok = readMessage(scanner, deltaText);
+        else if (keyIs(key, length, "message"))
+            ok = readMessage(scanner, messageText);
+        else if (keyIs(key, length, "finish_reason"))
+            ok = readNullableString(scanner, finishText);
+        else
+            ok = scanner.skipValue();
+        if (!ok)
+            return false;
+    } while (scanner.consume(','));
+    return scanner.consume('}');
+}
+
+bool readChoices(JsonScanner &scanner, QByteArray *deltaText, QByteArray *messageText,
+                 QByteArray *finishText) {
+    if (scanner.consumeNull())
+        return true;
+    if (!scanner.consume('['))
+        return false;
+    if (scanner.consume(']'))
+        return true;
+    if (scanner.peek('{')) {
+        if (!readChoice(scanner, deltaText, messageText, finishText))
+            return false;
+    } else if (!scanner.skipValue()) {
+        return false;
+    }
+    while (scanner.consume(',')) {
+        if (!scanner.skipValue())
+            return false;
+    }
+    return scanner.consume(']');
+}
+
+bool readUsage(JsonScanner &scanner, StreamDelta *delta) {
+    if (scanner.consumeNull())
+        return true;
+    if (!scanner.consume('{'))
+        return false;
+    delta->hasUsage = true;
+    if (scanner.consume('}'))
+        return true;
+    do {
+        const char *key = nullptr;
+        qsizetype length = 0;
+        if (!scanner.readKey(&key, &length))
+            return false;
+        bool ok = false;
+        if (keyIs(key, length, "prompt_tokens"))
+            ok = scanner.readInt(&delta->usage.promptTokens);
+        else if (keyIs(key, length, "completion_tokens"))
+            ok = scanner.readInt(&delta->usage.completionTokens);
+        else if (keyIs(key, length, "total_tokens"))
+            ok = scanner.readInt(&delta->usage.totalTokens);
+        else
+            ok = scanner.skipValue();
+        if (!ok)
+            return false;
+    } while (scanner.consume(','));
+    return scanner.consume('}');
+}
+
+bool readError(JsonScanner &scanner, QByteArray *message) {
+    if (scanner.consumeNull())
+        return true;
+    if (scanner.peek('"'))
+        return scanner.readString(message);
+    if (!scanner.consume('{'))
+        return false;
+    if (scanner.consume('}'))
+        return true;
+    do {
+        const char *key = nullptr;
+        qsizetype length = 0;
+        if (!scanner.readKey(&key, &length))
+            return false;
+        const bool ok = keyIs(key, length, "message")
+            ? readNullableString(scanner, message)
+            : scanner.skipValue();
+        if (!ok)
+            return false;
+    } while (scanner.consume(','));
+    return scanner.consume('}');
+}
+}
+
+void StreamDelta::clear() {
+    content.clear();
+    finishReason.clear();
+    errorMessage.clear();
+    hasUsage = false;
+    usage = TokenUsage();
+}
+
+bool StreamDeltaExtractor::extract(const QByteArray &payload, StreamDelta *delta) {
+    if (!delta)
+        return false;
+    delta->clear();
+    if (scan(payload, delta))
+        return true;
+    delta->clear();
+    return extractFromDocument(payload, delta);
+}
+
+bool StreamDeltaExtractor::scan(const QByteArray &payload, StreamDelta *delta) {
+    deltaText.resize(0);
+    messageText.resize(0);
+    finishText.resize(0);
+    errorText.resize(0);
+
+    JsonScanner scanner(payload.constData(), payload.constData() + payload.size());
+    if (!scanner.consume('{'))
+        return false;
+    if (!scanner.consume('}')) {
+        do {
+            const char *key = nullptr;
+            qsizetype length = 0;
+            if (!scanner.readKey(&key, &length))
+                return false;
+            bool ok = false;
+            if (keyIs(key, length, "choices"))
+                ok = readChoices(scanner, &deltaText, &messageText, &finishText);
+            else if (keyIs(key, length, "usage"))
+                ok = readUsage(scanner, delta);
+            else if (keyIs(key, length, "error"))
+                ok = readError(scanner, &errorText);
+            else
+                ok = scanner.skipValue();
+            if (!ok)
+                return false;
+        } while (scanner.consume(','));
+        if (!scanner.consume('}'))
+            return false;
+    }
+    if (!scanner.atEnd())
+        return false;
+
+    const QByteArray &text = deltaText.isEmpty() ? messageText : deltaText;
+    if (!text.isEmpty())
+        delta->content = QString::fromUtf8(text);
+    if (!finishText.isEmpty())
+        delta->finishReason = QString::fromUtf8(finishText);
+    if (!errorText.isEmpty())
+        delta->errorMessage = QString::fromUtf8(errorText);
+    return true;
+}
+
+bool StreamDeltaExtractor::extractFromDocument(const QByteArray &payload, StreamDelta *delta) {
+    const QJsonDocument doc = QJsonDocument::fromJson(payload);
+    if (!doc.isObject())
+        return false;
+    const QJsonObject obj = doc.object();
+
+    const QJsonArray choices = obj.value("choices").toArray();
+    if (!choices.isEmpty()) {
+        const QJsonObject choice = choices.first().toObject();
+        delta->content = choice.value("delta").toObject().value("content").toString();
+        if (delta->content.isEmpty())
+            delta->content = choice.value("message").toObject().value("content").toString();
+        delta->finishReason = choice.value("finish_reason").toString();
+    }
+
+    const QJsonValue usageValue = obj.value("usage");
+    if (usageValue.isObject()) {
+        const QJsonObject usage = usageValue.toObject();
+        delta->hasUsage = true;
+        delta->usage.promptTokens = usage.value("prompt_tokens").toInt();
+        delta->usage.completionTokens = usage.value("completion_tokens").toInt();
+        delta->usage.totalTokens = usage.value("total_tokens").toInt();
+    }
+
+    const QJsonValue errorValue = obj.value("error");
+    if (errorValue.isObject())
+        delta->errorMessage = errorValue.toObject().value("message").toString();
+    else if (errorValue.isString())
+        delta->errorMessage = errorValue.toString();
+    return true;
+}
@@ -0,0 +1,42 @@
+#ifndef STREAMDELTAEXTRACTOR_H
+#define STREAMDELTAEXTRACTOR_H
+
+#include <QByteArray>
+#include <QString>
+
+struct TokenUsage {
+    int promptTokens = 0;
+    int completionTokens = 0;
+    int totalTokens = 0;
+};
+
+struct StreamDelta {
+    QString content;
+    QString finishReason;
+    QString errorMessage;
+    bool hasUsage = false;
+    TokenUsage usage;
+
+    void clear();
+};
+
+// Pulls choices[0].delta.content, choices[0].message.content, finish_reason,
+// usage and error.message out of a chat completion payload in a single scan,
+// decoding string escapes straight into reusable buffers. Payloads the scanner
+// does not understand (content parts, escaped keys, malformed JSON) go through
+// QJsonDocument instead.
+class StreamDeltaExtractor {
+public:
+    bool extract(const QByteArray &payload, StreamDelta *delta);
+
+private:
+    QByteArray deltaText;
+    QByteArray messageText;
+    QByteArray finishText;
+    QByteArray errorText;
+
+    bool scan(const QByteArray &payload, StreamDelta *delta);
+    static bool extractFromDocument(const QByteArray &payload, StreamDelta *delta);
+};
+
+#endif // STREAMDELTAEXTRACTOR_H
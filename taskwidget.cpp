@@ -24,11 +24,14 @@ TaskWidget::TaskWidget(QWidget *parent)
     connect(ui->textEditPrompt, &QTextEdit::textChanged, this, &TaskWidget::configChanged);
     connect(ui->radioInsert, &QRadioButton::toggled, this, &TaskWidget::configChanged);
     connect(ui->radioWindow, &QRadioButton::toggled, this, &TaskWidget::configChanged);
+    connect(ui->lineEditCompareModels, &QLineEdit::textChanged, this, &TaskWidget::configChanged);
 
     connect(ui->spinBoxMaxTokens, QOverload<int>::of(&QSpinBox::valueChanged),
             this, &TaskWidget::configChanged);
     connect(ui->doubleSpinBoxTemperature, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
             this, &TaskWidget::configChanged);
+    connect(ui->spinBoxContextBudget, QOverload<int>::of(&QSpinBox::valueChanged),
+            this, &TaskWidget::configChanged);
     ui->modelSelectBoxModel->setEmptyLabel(tr(kDefaultModelLabel));
     connect(ui->modelSelectBoxModel, &ModelSelectBox::currentModelChanged,
             this, &TaskWidget::configChanged);
@@ -82,6 +85,21 @@ void TaskWidget::setInsertMode(bool insert) {
         ui->radioWindow->setChecked(true);
 }
 
+QStringList TaskWidget::compareModels() const {
+    QStringList models;
+    const QStringList parts = ui->lineEditCompareModels->text().split(u',', Qt::SkipEmptyParts);
+    for (const QString &part : parts) {
+        const QString model = part.trimmed();
+        if (!model.isEmpty())
+            models.append(model);
+    }
+    return models;
+}
+
+void TaskWidget::setCompareModels(const QStringList &models) {
+    ui->lineEditCompareModels->setText(models.join(QStringLiteral(", ")));
+}
+
 int TaskWidget::maxTokens() const {
     return ui->spinBoxMaxTokens->value();
 }
@@ -90,6 +108,10 @@ double TaskWidget::temperature() const {
     return ui->doubleSpinBoxTemperature->value();
 }
 
+int TaskWidget::contextBudget() const {
+    return ui->spinBoxContextBudget->value();
+}
+
 void TaskWidget::setMaxTokens(int tokens) {
     ui->spinBoxMaxTokens->setValue(tokens);
 }
@@ -98,6 +120,10 @@ void TaskWidget::setTemperature(double temp) {
     ui->doubleSpinBoxTemperature->setValue(temp);
 }
 
+void TaskWidget::setContextBudget(int tokens) {
+    ui->spinBoxContextBudget->setValue(tokens);
+}
+
 void TaskWidget::setResponseWindowSize(const QSize &size) {
     if (!size.isValid())
         return;
@@ -109,28 +135,44 @@ void TaskWidget::setResponseZoom(int zoom) {
     responseZoomValue = zoom;
 }
 
+int TaskWidget::useCount() const {
+    return useCountValue;
+}
+
+void TaskWidget::setUseCount(int count) {
+    useCountValue = qMax(0, count);
+}
+
 TaskDefinition TaskWidget::toDefinition() const {
     TaskDefinition def;
+    def.id = taskId;
     def.name = name();
     def.prompt = prompt();
     def.modelName = modelName();
     def.insertMode = insertMode();
+    def.compareModels = compareModels();
     def.maxTokens = maxTokens();
     def.temperature = temperature();
+    def.contextBudget = contextBudget();
     def.responseWidth = responseWidth;
     def.responseHeight = responseHeight;
     def.responseZoom = responseZoomValue;
+    def.useCount = useCountValue;
     return def;
 }
 
 void TaskWidget::applyDefinition(const TaskDefinition &definition) {
+    taskId = definition.id;
     setName(definition.name);
     setPrompt(definition.prompt);
     setModelName(definition.modelName);
     setInsertMode(definition.insertMode);
+    setCompareModels(definition.compareModels);
     setMaxTokens(definition.maxTokens);
     setTemperature(definition.temperature);
+    setContextBudget(definition.contextBudget);
     responseWidth = definition.responseWidth;
     responseHeight = definition.responseHeight;
     responseZoomValue = definition.responseZoom;
+    useCountValue = definition.useCount;
 }
@@ -4,6 +4,7 @@
 #include <QWidget>
 #include <QString>
 #include <QSize>
+#include <QStringList>
 
 namespace Ui {
     class TaskWidget;
@@ -27,14 +28,20 @@ public:
     void setPrompt(const QString &prompt);
     void setModelName(const QString &modelName);
     void setInsertMode(bool insert);
+    QStringList compareModels() const;
+    void setCompareModels(const QStringList &models);
 
     int maxTokens() const;
     double temperature() const;
+    int contextBudget() const;
     void setMaxTokens(int tokens);
     void setTemperature(double temp);
+    void setContextBudget(int tokens);
 
     void setResponseWindowSize(const QSize &size);
     void setResponseZoom(int zoom);
+    int useCount() const;
+    void setUseCount(int count);
 
     TaskDefinition toDefinition() const;
     void applyDefinition(const TaskDefinition &definition);
@@ -45,9 +52,11 @@ signals:
 
 private:
     Ui::TaskWidget *ui;
+    QString taskId;
     int responseWidth = 600;
     int responseHeight = 200;
     int responseZoomValue = 0;
+    int useCountValue = 0;
 };
 
 #endif // TASKWIDGET_H
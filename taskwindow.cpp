@@ -1,4 +1,11 @@
 #include "taskwindow.h"
+#include "bpetokenizer.h"
+#include "modelstats.h"
+#include "perflog.h"
+#include "responsecache.h"
+#include "selectioncapture.h"
+#include "textchunker.h"
+#include "transcriptrenderer.h"
 
 #include <QClipboard>
 #include <QAbstractTextDocumentLayout>
@@ -18,36 +25,27 @@
 #include <QKeyEvent>
 #include <QLabel>
 #include <QMessageBox>
-#include <QMetaObject>
 #include <QMimeData>
-#include <QNetworkAccessManager>
-#include <QNetworkProxy>
 #include <QNetworkReply>
-#include <QNetworkRequest>
 #include <QPalette>
 #include <QPushButton>
-#include <QRegularExpression>
 #include <QResizeEvent>
 #include <QScreen>
 #include <QScrollBar>
+#include <QSplitter>
 #include <QStyle>
 #include <QStringList>
-#include <QSyntaxHighlighter>
 #include <QTextBlock>
 #include <QTextBrowser>
 #include <QTextDocument>
-#include <QTextFormat>
-#include <QTextCursor>
-#include <QTextFragment>
 #include <QTextLayout>
-#include <QThread>
 #include <QTimer>
 #include <QUrl>
-#include <QUuid>
 #include <QVBoxLayout>
 #include <QPlainTextEdit>
 
 #include <functional>
+#include <utility>
 #include <cstring>
 #include <memory>
 
@@ -55,6 +53,10 @@
 
 namespace {
 constexpr const char kDefaultModelLabel[] = "Default";
+constexpr int kSpeculativeModifierPollMs = 20;
+constexpr int kSpeculativeModifierPolls = 100;
+// Client request ids are positive, so a cached reply can never collide
+constexpr int kCachedRequestId = -1;
 constexpr const char kClipboardHistoryExcludeMime[] =
     "application/x-qt-windows-mime;value=\"ExcludeClipboardContentFromMonitorProcessing\"";
 constexpr const wchar_t kClipboardHistoryExcludeFormat[] =
@@ -152,6 +154,64 @@ bool setWindowsClipboardText(const QString &text, bool excludeFromHistory) {
     return success;
 }
 
+void writeClipboardText(const QString &text, bool excludeFromHistory) {
+    if (setWindowsClipboardText(text, excludeFromHistory))
+        return;
+
+    auto mimeData = std::make_unique<QMimeData>();
+    mimeData->setText(text);
+    if (excludeFromHistory)
+        addClipboardHistoryExclusion(mimeData.get());
+
+    QClipboard *clipboard = QGuiApplication::clipboard();
+    if (clipboard)
+        clipboard->setMimeData(mimeData.release(), QClipboard::Clipboard);
+}
+
+class SystemClipboardSource : public ClipboardSource {
+public:
+    explicit SystemClipboardSource(QObject *parent = nullptr)
+        : ClipboardSource(parent) {
+        if (QClipboard *clipboard = QGuiApplication::clipboard())
+            connect(clipboard, &QClipboard::dataChanged, this, &ClipboardSource::changed);
+    }
+
+    quint64 sequenceNumber() const override {
+        return GetClipboardSequenceNumber();
+    }
+
+    QString text() const override {
+        const QClipboard *clipboard = QGuiApplication::clipboard();
+        return clipboard ? clipboard->text() : QString();
+    }
+
+    void writeMarker(const QString &marker) override {
+        writeClipboardText(marker, true);
+    }
+
+    void requestCopy() override {
+        INPUT copyInputs[4] = {};
+        copyInputs[0].type = INPUT_KEYBOARD;
+        copyInputs[0].ki.wVk = VK_CONTROL;
+        copyInputs[1].type = INPUT_KEYBOARD;
+        copyInputs[1].ki.wVk = 'C';
+        copyInputs[2].type = INPUT_KEYBOARD;
+        copyInputs[2].ki.wVk = 'C';
+        copyInputs[2].ki.dwFlags = KEYEVENTF_KEYUP;
+        copyInputs[3].type = INPUT_KEYBOARD;
+        copyInputs[3].ki.wVk = VK_CONTROL;
+        copyInputs[3].ki.dwFlags = KEYEVENTF_KEYUP;
+        SendInput(4, copyInputs, sizeof(INPUT));
+    }
+};
+
+// Shared by every window so the adaptive timeout learns across menus
+SelectionCapture *selectionCapture() {
+    static SelectionCapture *capture =
+        new SelectionCapture(new SystemClipboardSource, QCoreApplication::instance());
+    return capture;
+}
+
 QUrl buildApiUrl(const QString &baseUrl, const QString &pathSuffix) {
     QUrl url(baseUrl.trimmed());
     if (!url.isValid())
@@ -172,74 +232,6 @@ QString normalizeModelName(const QString &name) {
     return name;
 }
 
-bool isCodeBlock(const QTextBlock &block) {
-    const QTextBlockFormat format = block.blockFormat();
-    if (format.hasProperty(QTextFormat::BlockCodeFence))
-        return true;
-    if (format.hasProperty(QTextFormat::BlockCodeLanguage))
-        return true;
-    return block.charFormat().fontFixedPitch();
-}
-
-bool isInlineCodeFormat(const QTextCharFormat &format) {
-    if (format.fontFixedPitch())
-        return true;
-    const QFont font = format.font();
-    if (font.fixedPitch())
-        return true;
-    const QString family = font.family();
-    if (family.contains("mono", Qt::CaseInsensitive)
-        || family.contains("courier", Qt::CaseInsensitive)
-        || family.contains("consolas", Qt::CaseInsensitive)) {
-        return true;
-    }
-    const QStringList families = format.fontFamilies().toStringList();
-    for (const QString &entry : families) {
-        if (entry.contains("mono", Qt::CaseInsensitive)
-            || entry.contains("courier", Qt::CaseInsensitive)
-            || entry.contains("consolas", Qt::CaseInsensitive)) {
-            return true;
-        }
-    }
-    const QVariant hintProp = format.property(QTextFormat::FontStyleHint);
-    if (hintProp.isValid()) {
-        const int hint = hintProp.toInt();
-        if (hint == QFont::TypeWriter || hint == QFont::Monospace)
-            return true;
-    }
-    const QVariant familyProp = format.property(QTextFormat::FontFamily);
-    if (familyProp.isValid()) {
-        const QString propFamily = familyProp.toString();
-        if (propFamily.contains("mono", Qt::CaseInsensitive)
-            || propFamily.contains("courier", Qt::CaseInsensitive)
-            || propFamily.contains("consolas", Qt::CaseInsensitive)) {
-            return true;
-        }
-    }
-    return false;
-}
-
-QFont resolveBaseTextFont(QTextDocument *doc) {
-    if (!doc)
-        return QFont();
-    for (QTextBlock block = doc->begin(); block.isValid(); block = block.next()) {
-        if (isCodeBlock(block))
-            continue;
-        for (auto it = block.begin(); !it.atEnd(); ++it) {
-            const QTextFragment fragment = it.fragment();
-            if (!fragment.isValid())
-                continue;
-            const QTextCharFormat format = fragment.charFormat();
-            if (isInlineCodeFormat(format))
-                continue;
-            const QFont font = format.font();
-            if (font.pointSizeF() > 0 || font.pixelSize() > 0)
-                return font;
-        }
-    }
-    return doc->defaultFont();
-}
-
 class MarkdownTextBrowser : public QTextBrowser {
 public:
     explicit MarkdownTextBrowser(QWidget *parent = nullptr)
@@ -288,116 +280,6 @@ private:
     std::function<void(int)> zoomDeltaCallback;
 };
 
-class MarkdownCodeHighlighter : public QSyntaxHighlighter {
-public:
-    explicit MarkdownCodeHighlighter(QTextDocument *parent)
-        : QSyntaxHighlighter(parent) {
-        keywordFormat.setForeground(QColor("#d73a49"));
-        keywordFormat.setFontWeight(QFont::Bold);
-
-        stringFormat.setForeground(QColor("#032f62"));
-
-        numberFormat.setForeground(QColor("#005cc5"));
-
-        commentFormat.setForeground(QColor("#6a737d"));
-
-        keywordPatterns = {
-            QRegularExpression("\\b(auto|bool|break|case|catch|class|const|continue|def|default|"
-                               "delete|do|else|enum|export|extends|false|final|finally|for|"
-                               "foreach|from|function|if|implements|import|inline|interface|"
-                               "lambda|let|namespace|new|nullptr|null|operator|private|protected|"
-                               "public|return|static|struct|switch|template|this|throw|true|try|"
-                               "typedef|typename|using|var|virtual|void|volatile|while)\\b")
-        };
-
-        stringPatterns = {
-            QRegularExpression(R"("([^"\\]|\\.)*")"),
-            QRegularExpression(R"('([^'\\]|\\.)*')")
-        };
-
-        numberPattern = QRegularExpression("\\b\\d+(?:\\.\\d+)?\\b");
-        singleLineCommentPatterns = {
-            QRegularExpression("//[^\\n]*"),
-            QRegularExpression("#[^\\n]*")
-        };
-        multiLineCommentStart = QRegularExpression("/\\*");
-        multiLineCommentEnd = QRegularExpression("\\*/");
-    }
-
-protected:
-    void highlightBlock(const QString &text) override {
-        setCurrentBlockState(0);
-        if (!isCodeBlock(currentBlock()))
-            return;
-
-        for (const QRegularExpression &pattern : keywordPatterns) {
-            auto it = pattern.globalMatch(text);
-            while (it.hasNext()) {
-                const QRegularExpressionMatch match = it.next();
-                setFormat(match.capturedStart(), match.capturedLength(), keywordFormat);
-            }
-        }
-
-        for (const QRegularExpression &pattern : stringPatterns) {
-            auto it = pattern.globalMatch(text);
-            while (it.hasNext()) {
-                const QRegularExpressionMatch match = it.next();
-                setFormat(match.capturedStart(), match.capturedLength(), stringFormat);
-            }
-        }
-
-        auto numberIt = numberPattern.globalMatch(text);
-        while (numberIt.hasNext()) {
-            const QRegularExpressionMatch match = numberIt.next();
-            setFormat(match.capturedStart(), match.capturedLength(), numberFormat);
-        }
-
-        for (const QRegularExpression &pattern : singleLineCommentPatterns) {
-            auto it = pattern.globalMatch(text);
-            while (it.hasNext()) {
-                const QRegularExpressionMatch match = it.next();
-                setFormat(match.capturedStart(), match.capturedLength(), commentFormat);
-            }
-        }
-
-        int startIndex = 0;
-        if (previousBlockState() == 1) {
-            startIndex = 0;
-        } else {
-            const QRegularExpressionMatch match = multiLineCommentStart.match(text);
-            startIndex = match.hasMatch() ? match.capturedStart() : -1;
-        }
-
-        while (startIndex >= 0) {
-            const QRegularExpressionMatch endMatch = multiLineCommentEnd.match(text, startIndex);
-            int commentLength = 0;
-            if (endMatch.hasMatch()) {
-                commentLength = endMatch.capturedEnd() - startIndex;
-                setFormat(startIndex, commentLength, commentFormat);
-            } else {
-                setCurrentBlockState(1);
-                commentLength = text.length() - startIndex;
-                setFormat(startIndex, commentLength, commentFormat);
-            }
-            const QRegularExpressionMatch nextStart = multiLineCommentStart.match(text,
-                                                                                  startIndex + commentLength);
-            startIndex = nextStart.hasMatch() ? nextStart.capturedStart() : -1;
-        }
-    }
-
-private:
-    QTextCharFormat keywordFormat;
-    QTextCharFormat stringFormat;
-    QTextCharFormat numberFormat;
-    QTextCharFormat commentFormat;
-    QList<QRegularExpression> keywordPatterns;
-    QList<QRegularExpression> stringPatterns;
-    QRegularExpression numberPattern;
-    QList<QRegularExpression> singleLineCommentPatterns;
-    QRegularExpression multiLineCommentStart;
-    QRegularExpression multiLineCommentEnd;
-};
-
 QPoint clampToScreen(const QPoint &pos, const QSize &size, const QRect &available) {
     int x = pos.x();
     int y = pos.y();
@@ -421,132 +303,21 @@ void moveNearCursor(QWidget *widget, const QPoint &cursorPos) {
     const QRect available = screen->availableGeometry();
     widget->move(clampToScreen(cursorPos, widget->size(), available));
 }
-
-const QString &markdownCss() {
-    static const QString css =
-        "body {"
-        "  font-family: 'Segoe UI', 'Noto Sans', Helvetica, Arial;"
-        "  font-size: 12pt;"
-        "  color: #24292f;"
-        "}"
-        "a { color: #0969da; text-decoration: none; }"
-        "a:hover { text-decoration: underline; }"
-        "p { margin: 8px 0; }"
-        "h1 { font-size: 20pt; border-bottom: 1px solid #d0d7de; padding-bottom: 4px; }"
-        "h2 { font-size: 16pt; border-bottom: 1px solid #d0d7de; padding-bottom: 2px; }"
-        "h3 { font-size: 14pt; }"
-        "ul, ol { margin-left: 20px; }"
-        "pre { border: 1px solid #d0d7de; padding: 8px; margin: 12px 0; }"
-        "blockquote {"
-        "  color: #24292f;"
-        "  border-left: 4px solid #9ec5fe;"
-        "  background-color: #f2f7ff;"
-        "  margin: 8px 0;"
-        "  padding: 6px 10px;"
-        "  border-radius: 4px;"
-        "}"
-        "table { border-collapse: collapse; }"
-        "th, td { border: 1px solid #d0d7de; padding: 4px 8px; }"
-        "hr { border: 0; border-top: 1px solid #d0d7de; margin: 12px 0; }";
-    return css;
-}
 }
 
 TaskWindow *TaskWindow::s_activeMenu = nullptr;
-TaskWindow *TaskWindow::s_activeOperation = nullptr;
+QList<TaskWindow *> TaskWindow::s_busyOperations;
+int TaskWindow::s_speculationHits = 0;
+int TaskWindow::s_speculationMisses = 0;
+qint64 TaskWindow::s_speculationWastedTokens = 0;
 HHOOK TaskWindow::s_keyboardHook = nullptr;
 HHOOK TaskWindow::s_mouseHook = nullptr;
 HHOOK TaskWindow::s_operationKeyboardHook = nullptr;
 
-TaskRequestWorker::TaskRequestWorker(QObject *parent)
-    : QObject(parent)
-    , networkManager(nullptr) {
-}
-
-void TaskRequestWorker::startRequest(const QUrl &url,
-                                     int requestId,
-                                     const QByteArray &authorizationHeader,
-                                     const QByteArray &body,
-                                     const QString &proxyText) {
-    if (reply)
-        reply->abort();
-
-    if (!networkManager)
-        networkManager = new QNetworkAccessManager(this);
-    applyProxy(proxyText);
-
-    QNetworkRequest request(url);
-    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    request.setRawHeader("Authorization", authorizationHeader);
-
-    QNetworkReply *newReply = networkManager->post(request, body);
-    reply = newReply;
-    connect(newReply, &QNetworkReply::readyRead, this, [this,
-                                                        requestId,
-                                                        requestReply = QPointer<QNetworkReply>(newReply)]() {
-        if (!requestReply || reply != requestReply)
-            return;
-        const QByteArray chunk = requestReply->readAll();
-        if (!chunk.isEmpty())
-            emit readyRead(requestId, chunk);
-    });
-    connect(newReply, &QNetworkReply::finished, this, [this,
-                                                       requestId,
-                                                       requestReply = QPointer<QNetworkReply>(newReply)]() {
-        if (!requestReply)
-            return;
-        if (reply != requestReply) {
-            requestReply->deleteLater();
-            return;
-        }
-
-        const QByteArray chunk = requestReply->readAll();
-        if (!chunk.isEmpty())
-            emit readyRead(requestId, chunk);
-
-        const int error = static_cast<int>(requestReply->error());
-        const QString errorString = requestReply->errorString();
-        const int statusCode = requestReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-        requestReply->deleteLater();
-        reply.clear();
-        emit finished(requestId, error, errorString, statusCode);
-    });
-}
-
-void TaskRequestWorker::abortRequest() {
-    if (reply)
-        reply->abort();
-}
-
-void TaskRequestWorker::applyProxy(const QString &proxyText) {
-    if (!networkManager)
-        return;
-
-    const QString trimmed = proxyText.trimmed();
-    if (trimmed.isEmpty()) {
-        QNetworkProxy proxy;
-        proxy.setType(QNetworkProxy::NoProxy);
-        networkManager->setProxy(proxy);
-        return;
-    }
-
-    const QUrl proxyUrl(trimmed);
-    if (!proxyUrl.isValid()) {
-        QNetworkProxy proxy;
-        proxy.setType(QNetworkProxy::NoProxy);
-        networkManager->setProxy(proxy);
-        return;
-    }
-
-    QNetworkProxy proxy;
-    proxy.setType(QNetworkProxy::HttpProxy);
-    proxy.setHostName(proxyUrl.host());
-    proxy.setPort(proxyUrl.port());
-    networkManager->setProxy(proxy);
-}
-
 TaskWindow::TaskWindow(const QList<TaskDefinition> &taskList,
                        const AppSettings &settings,
+                       LlmClient *client,
+                       ResponseCache *cache,
                        QWidget *parent)
     : QWidget(parent,
               Qt::Tool | Qt::WindowStaysOnTopHint | Qt::CustomizeWindowHint
@@ -554,8 +325,9 @@ TaskWindow::TaskWindow(const QList<TaskDefinition> &taskList,
     , tasks(taskList)
     , activeTaskIndex(-1)
     , settings(settings)
-    , requestThread(new QThread(this))
-    , requestWorker(new TaskRequestWorker)
+    , llmClient(client)
+    , responseCache(cache)
+    , cacheLookupSerial(0)
     , loadingWindow(nullptr)
     , loadingTimer(nullptr)
     , loadingLabel(nullptr)
@@ -563,9 +335,16 @@ TaskWindow::TaskWindow(const QList<TaskDefinition> &taskList,
     , dotCount(0)
     , replyIndicatorTimer(nullptr)
     , replyDotCount(3)
+    , renderTimer(new QTimer(this))
+    , firstDeltaRendered(false)
+    , responseRenderCount(0)
+    , responseRenderNs(0)
     , responseWindow(nullptr)
     , responseView(nullptr)
     , followUpInput(nullptr)
+    , promptTokenEstimate(0)
+    , droppedContextMessages(0)
+    , responseHasUsage(false)
     , currentRequestId(0)
     , sawStreamFormat(false)
     , requestInFlight(false)
@@ -573,29 +352,51 @@ TaskWindow::TaskWindow(const QList<TaskDefinition> &taskList,
     , pendingResponseViewUpdate(false)
     , replyIndicatorVisible(false)
     , originalClipboardWasEmpty(true)
-    , menuActiveIndex(-1) {
+    , menuActiveIndex(-1)
+    , menuPopupCount(0)
+    , chunkLookupsPending(0)
+    , chunkedReply(false)
+    , primaryFirstTokenMs(-1) {
     setAttribute(Qt::WA_DeleteOnClose, true);
     setAttribute(Qt::WA_TranslucentBackground, true);
     setAttribute(Qt::WA_ShowWithoutActivating, true);
     setFocusPolicy(Qt::NoFocus);
 
-    requestWorker->moveToThread(requestThread);
-    connect(requestThread, &QThread::finished, requestWorker, &QObject::deleteLater);
-    connect(requestWorker, &TaskRequestWorker::readyRead,
-            this, &TaskWindow::handleRequestReadyRead);
-    connect(requestWorker, &TaskRequestWorker::finished,
-            this, &TaskWindow::handleRequestFinished);
-    requestThread->start();
+    if (llmClient) {
+        connect(llmClient, &LlmClient::streamBatchReady,
+                this, &TaskWindow::handleStreamBatch);
+        connect(llmClient, &LlmClient::finished,
+                this, &TaskWindow::handleRequestFinished);
+    }
+
+    renderTimer->setSingleShot(true);
+    renderTimer->setTimerType(Qt::PreciseTimer);
+    connect(renderTimer, &QTimer::timeout, this, &TaskWindow::updateResponseView);
 
     auto *mainLayout = new QVBoxLayout(this);
     mainLayout->setContentsMargins(10, 10, 10, 10);
     mainLayout->setSpacing(0);
 
+    QElapsedTimer buildClock;
+    buildClock.start();
+
     auto *container = new QWidget(this);
     container->setObjectName("container");
+    // One sheet for every button; a sheet per button is parsed per button
     container->setStyleSheet("QWidget#container { "
                              "  background-color: white; "
                              "  border-radius: 0; "
+                             "}"
+                             "QPushButton {"
+                             "   text-align: left;"
+                             "   padding: 2px 8px;"
+                             "   border: 1px solid #adadad;"
+                             "   background-color: #e1e1e1;"
+                             "}"
+                             "QPushButton:focus, QPushButton:hover, QPushButton[menuActive=\"true\"] {"
+                             "   outline: 0;"
+                             "   border: 1px solid #0078d7;"
+                             "   background-color: #e5f1fb;"
                              "}");
 
     auto *shadow = new QGraphicsDropShadowEffect(container);
@@ -612,70 +413,52 @@ TaskWindow::TaskWindow(const QList<TaskDefinition> &taskList,
         const TaskDefinition &task = tasks.at(i);
         QString text = task.name.isEmpty() ? tr("<Unnamed>") : task.name;
         auto *btn = new QPushButton(text, container);
-        btn->setStyleSheet(
-            "QPushButton {"
-            "   text-align: left;"
-            "   padding: 2px 8px;"
-            "   border: 1px solid #adadad;"
-            "   background-color: #e1e1e1;"
-            "}"
-            "QPushButton:focus, QPushButton:hover, QPushButton[menuActive=\"true\"] {"
-            "   outline: 0;"
-            "   border: 1px solid #0078d7;"
-            "   background-color: #e5f1fb;"
-            "}"
-        );
         btn->setProperty("menuIndex", i);
         btn->setMouseTracking(true);
         btn->installEventFilter(this);
         menuButtons.append(btn);
         connect(btn, &QPushButton::clicked, this, [this, i]() {
-            activeTaskIndex = i;
-            const TaskDefinition task = tasks.at(i);
-            hide();
-            if (task.insertMode)
-                showLoadingIndicator();
-
-            saveOriginalClipboard();
-            const QString original = captureSelectedText();
-            restoreOriginalClipboard();
-            if (original.isEmpty()) {
-                clearOriginalClipboardSnapshot();
-                hideLoadingIndicator();
-                return;
-            }
-
-            if (!task.insertMode)
-                clearOriginalClipboardSnapshot();
-
-            startConversation(task, original);
+            activateTask(i);
         });
         layout->addWidget(btn);
     }
 
     mainLayout->addWidget(container);
 
+    // Polish, lay out and create the native window now, while nobody waits
+    ensurePolished();
     adjustSize();
+    applyNoActivateStyle();
+    qCDebug(lcPerf) << "menu built with" << tasks.size() << "tasks in" << buildClock.elapsed() << "ms";
+}
 
-    const QPoint cursorPos = QCursor::pos();
+void TaskWindow::popupAt(const QPoint &cursorPos, const QElapsedTimer &hotkeyClock) {
+    menuPopupClock = hotkeyClock;
+    ++menuPopupCount;
     moveNearCursor(this, cursorPos);
-
-    applyNoActivateStyle();
     show();
     raise();
+
+    if (settings.speculativePrefetch)
+        QTimer::singleShot(0, this, &TaskWindow::startSpeculativePrefetch);
+}
+
+void TaskWindow::refreshTasks(const QList<TaskDefinition> &taskList) {
+    if (taskList.size() == tasks.size() && !hasConversation())
+        tasks = taskList;
 }
 
 TaskWindow::~TaskWindow() {
+    selectionCapture()->cancel(this);
     removeOperationCancelHook();
-    if (requestWorker) {
-        QMetaObject::invokeMethod(requestWorker,
-                                  "abortRequest",
-                                  Qt::BlockingQueuedConnection);
-    }
-    if (requestThread) {
-        requestThread->quit();
-        requestThread->wait();
-    }
+    discardSpeculativeRequest();
+    // Nothing is left to receive these; without the aborts they would keep
+    // streaming into the network thread until the server finished
+    if (compare)
+        compare->abort();
+    abortChunkedRequests();
+    if (requestInFlight && llmClient)
+        llmClient->abortRequest(currentRequestId);
     restoreOriginalClipboard();
     clearOriginalClipboardSnapshot();
     removeMenuHooks();
@@ -683,36 +466,6 @@ TaskWindow::~TaskWindow() {
     hideReplyIndicator();
 }
 
-QString TaskWindow::captureSelectedText() {
-    QClipboard *clipboard = QGuiApplication::clipboard();
-    const QString marker = QStringLiteral("DesktopLLMHelper-clipboard-marker-%1")
-                               .arg(QUuid::createUuid().toString(QUuid::WithoutBraces));
-    setClipboardText(marker, true);
-
-    INPUT copyInputs[4] = {};
-    copyInputs[0].type = INPUT_KEYBOARD;
-    copyInputs[0].ki.wVk = VK_CONTROL;
-    copyInputs[1].type = INPUT_KEYBOARD;
-    copyInputs[1].ki.wVk = 'C';
-    copyInputs[2].type = INPUT_KEYBOARD;
-    copyInputs[2].ki.wVk = 'C';
-    copyInputs[2].ki.dwFlags = KEYEVENTF_KEYUP;
-    copyInputs[3].type = INPUT_KEYBOARD;
-    copyInputs[3].ki.wVk = VK_CONTROL;
-    copyInputs[3].ki.dwFlags = KEYEVENTF_KEYUP;
-    SendInput(4, copyInputs, sizeof(INPUT));
-
-    QElapsedTimer timer;
-    timer.start();
-    while (timer.elapsed() < 500) {
-        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
-        const QString text = clipboard->text();
-        if (!text.isEmpty() && text != marker)
-            return text;
-    }
-    return QString();
-}
-
 void TaskWindow::saveOriginalClipboard() {
     const QClipboard *clipboard = QGuiApplication::clipboard();
     const QMimeData *currentData = clipboard ? clipboard->mimeData(QClipboard::Clipboard) : nullptr;
@@ -741,45 +494,536 @@ void TaskWindow::clearOriginalClipboardSnapshot() {
 }
 
 void TaskWindow::setClipboardText(const QString &text, bool excludeFromHistory) {
-    if (setWindowsClipboardText(text, excludeFromHistory))
+    writeClipboardText(text, excludeFromHistory);
+}
+
+QString TaskWindow::applyCharLimit(const QString &text) const {
+    QString limited = text;
+    if (settings.maxChars > 0 && limited.length() > settings.maxChars) {
+        qsizetype cut = settings.maxChars;
+        // Never leave half of a surrogate pair at the end
+        if (limited.at(cut - 1).isHighSurrogate())
+            --cut;
+        limited.truncate(cut);
+    }
+    return applyTokenLimit(limited);
+}
+
+QString TaskWindow::applyTokenLimit(const QString &text) const {
+    if (settings.maxInputTokens <= 0)
+        return text;
+    const BpeTokenizer *bpe = textTokenizer();
+    return bpe ? bpe->truncate(text, settings.maxInputTokens)
+               : ContextBudget::truncateToEstimate(text, settings.maxInputTokens);
+}
+
+QList<ChatMessage> TaskWindow::limitSelection(QList<ChatMessage> history) const {
+    // The history keeps the whole selection, which a chunked run answered in
+    // full; requests built from it send what fits maxChars and maxInputTokens
+    for (ChatMessage &message : history) {
+        if (message.role != QLatin1String("user"))
+            continue;
+        const QString limited = applyCharLimit(message.content);
+        if (limited.length() != message.content.length()) {
+            message.content = limited;
+            message.estimatedTokens = 0;
+        }
+        break;
+    }
+    return history;
+}
+
+const BpeTokenizer *TaskWindow::textTokenizer() const {
+    // The vocabulary loads in the background; counts use the byte estimate
+    // until it is ready so the GUI thread never waits for it
+    if (!tokenizer)
+        tokenizer = BpeTokenizer::cached(settings.tokenizerVocabularyPath);
+    return tokenizer.get();
+}
+
+void TaskWindow::activateTask(int taskIndex) {
+    // A click during the speculative capture is handled once it returns
+    if (speculation.captureActive) {
+        speculation.pendingPick = taskIndex;
+        hide();
         return;
+    }
 
-    auto mimeData = std::make_unique<QMimeData>();
-    mimeData->setText(text);
-    if (excludeFromHistory)
-        addClipboardHistoryExclusion(mimeData.get());
+    if (hasConversation())
+        return;
 
-    QClipboard *clipboard = QGuiApplication::clipboard();
-    if (clipboard)
-        clipboard->setMimeData(mimeData.release(), QClipboard::Clipboard);
+    activeTaskIndex = taskIndex;
+    const TaskDefinition task = tasks.at(taskIndex);
+    hide();
+    if (task.insertMode)
+        showLoadingIndicator();
+
+    if (speculation.captured) {
+        continueActivation(speculation.capturedText);
+        return;
+    }
+    saveOriginalClipboard();
+    selectionCapture()->capture(this, [this](const QString &text) {
+        restoreOriginalClipboard();
+        continueActivation(text);
+    });
 }
 
-QString TaskWindow::applyCharLimit(const QString &text) const {
-    if (settings.maxChars > 0 && text.length() > settings.maxChars)
-        return text.left(settings.maxChars);
-    return text;
+void TaskWindow::continueActivation(const QString &original) {
+    const int taskIndex = activeTaskIndex;
+    const TaskDefinition task = tasks.at(taskIndex);
+    if (original.isEmpty()) {
+        discardSpeculativeRequest();
+        clearOriginalClipboardSnapshot();
+        hideLoadingIndicator();
+        // Nothing was sent, so the hidden menu can serve the next hotkey
+        activeTaskIndex = -1;
+        speculation = SpeculativeRequest();
+        return;
+    }
+
+    if (!task.insertMode)
+        clearOriginalClipboardSnapshot();
+
+    emit taskUsed(task.id);
+    startConversation(task, original);
+}
+
+int TaskWindow::mostLikelyTaskIndex() const {
+    int bestIndex = -1;
+    int bestCount = 0;
+    for (int i = 0; i < tasks.size(); ++i) {
+        if (tasks.at(i).useCount > bestCount) {
+            bestCount = tasks.at(i).useCount;
+            bestIndex = i;
+        }
+    }
+    return bestIndex;
+}
+
+void TaskWindow::startSpeculativePrefetch() {
+    if (!isVisible() || activeTaskIndex >= 0 || speculation.captured || speculation.captureActive
+        || !llmClient) {
+        return;
+    }
+    const int taskIndex = mostLikelyTaskIndex();
+    if (taskIndex < 0)
+        return;
+
+    // Ctrl+C is simulated, so wait until the hotkey modifiers are released
+    const bool modifiersDown = (GetAsyncKeyState(VK_SHIFT) & 0x8000) != 0
+        || (GetAsyncKeyState(VK_CONTROL) & 0x8000) != 0
+        || (GetAsyncKeyState(VK_MENU) & 0x8000) != 0
+        || (GetAsyncKeyState(VK_LWIN) & 0x8000) != 0
+        || (GetAsyncKeyState(VK_RWIN) & 0x8000) != 0;
+    if (modifiersDown) {
+        if (++speculation.modifierPolls < kSpeculativeModifierPolls)
+            QTimer::singleShot(kSpeculativeModifierPollMs, this, &TaskWindow::startSpeculativePrefetch);
+        return;
+    }
+
+    speculation.captureActive = true;
+    saveOriginalClipboard();
+    selectionCapture()->capture(this, [this, taskIndex](const QString &text) {
+        restoreOriginalClipboard();
+        finishSpeculativeCapture(taskIndex, text);
+    });
+}
+
+void TaskWindow::finishSpeculativeCapture(int taskIndex, const QString &original) {
+    speculation.captureActive = false;
+    speculation.captured = !original.isEmpty();
+    speculation.capturedText = original;
+
+    if (speculation.captured && speculation.pendingPick < 0) {
+        const TaskDefinition &task = tasks.at(taskIndex);
+        const QList<ChatMessage> messages{
+            {QStringLiteral("system"), task.prompt},
+            {QStringLiteral("user"), applyCharLimit(original)}
+        };
+        speculation.taskIndex = taskIndex;
+        speculation.promptChars = task.prompt.length() + messages.last().content.length();
+        speculation.clock.start();
+        speculation.requestId = submitChatRequest(task, messages);
+    }
+
+    if (speculation.pendingPick >= 0) {
+        const int pick = speculation.pendingPick;
+        speculation.pendingPick = -1;
+        activateTask(pick);
+    }
+}
+
+bool TaskWindow::adoptSpeculativeRequest(const TaskDefinition &task, const QString &originalText) {
+    if (speculation.requestId == 0)
+        return false;
+    if (speculation.taskIndex != activeTaskIndex || speculation.capturedText != originalText) {
+        discardSpeculativeRequest();
+        return false;
+    }
+
+    const SpeculativeRequest adopted = speculation;
+    speculation = SpeculativeRequest();
+    reportSpeculation(true, 0);
+
+    resetRequestState();
+    // The request has been running since the menu opened; its stats count
+    // from then, not from the replay of what it already buffered
+    primaryClock = adopted.clock;
+    primaryFirstTokenMs = adopted.firstTokenMs;
+    activeRequestTask = task;
+    startInsertWriter();
+    setRequestInFlight(true);
+    promptTokenEstimate = ContextBudget::fit(limitSelection(messageHistory), 0, textTokenizer()).estimatedTokens;
+    droppedContextMessages = 0;
+    updateContextLabel();
+    currentRequestId = adopted.requestId;
+    for (const StreamBatch &batch : adopted.batches)
+        handleStreamBatch(adopted.requestId, batch);
+    if (adopted.finished)
+        handleRequestFinished(adopted.requestId, adopted.error, adopted.errorString, adopted.statusCode);
+    return true;
+}
+
+void TaskWindow::discardSpeculativeRequest() {
+    if (speculation.requestId == 0)
+        return;
+    if (!speculation.finished && llmClient)
+        llmClient->abortRequest(speculation.requestId);
+    // Streams rarely carry usage, so the waste is estimated at ~4 chars per token
+    reportSpeculation(false, (speculation.promptChars + speculation.receivedChars + 3) / 4);
+    speculation.requestId = 0;
+    speculation.taskIndex = -1;
+    speculation.firstTokenMs = -1;
+    speculation.batches.clear();
+}
+
+void TaskWindow::reportSpeculation(bool hit, qint64 wastedTokens) {
+    if (hit)
+        ++s_speculationHits;
+    else
+        ++s_speculationMisses;
+    s_speculationWastedTokens += wastedTokens;
+    const int total = s_speculationHits + s_speculationMisses;
+    qCDebug(lcPerf) << "speculative prefetch" << (hit ? "hit" : "miss")
+                    << "hit rate" << s_speculationHits << "/" << total
+                    << "wasted tokens (estimated)" << s_speculationWastedTokens;
 }
 
 void TaskWindow::startConversation(const TaskDefinition &task, const QString &originalText) {
     resetConversationState();
     appendMessageToHistory("system", task.prompt);
-    appendMessageToHistory("user", applyCharLimit(originalText));
+    appendMessageToHistory("user", originalText);
     if (!task.insertMode) {
+        startCompareSession(task);
         ensureResponseWindow();
         showReplyIndicator();
     }
-    sendRequestWithHistory(task);
+    if (shouldChunkSelection(originalText)) {
+        discardSpeculativeRequest();
+        startChunkedRequest(task, originalText);
+    } else if (!adoptSpeculativeRequest(task, originalText)) {
+        sendRequestWithHistory(task);
+    }
+    if (compare) {
+        compare->sendRequests();
+        setRequestInFlight(requestInFlight);
+    }
+}
+
+void TaskWindow::startCompareSession(const TaskDefinition &task) {
+    if (task.compareModels.isEmpty())
+        return;
+    QStringList models;
+    for (const QString &model : task.compareModels)
+        models.append(normalizeModelName(model));
+    auto send = [this](const QString &modelName, const QList<ChatMessage> &history) {
+        if (activeTaskIndex < 0 || activeTaskIndex >= tasks.size())
+            return 0;
+        TaskDefinition compareTask = tasks.at(activeTaskIndex);
+        compareTask.modelName = modelName;
+        const ContextBudgetResult budgeted = ContextBudget::fit(limitSelection(history), compareTask.contextBudget,
+                                                                textTokenizer());
+        return submitChatRequest(compareTask, budgeted.messages);
+    };
+    auto abortRequest = [this](int requestId) {
+        if (llmClient)
+            llmClient->abortRequest(requestId);
+    };
+    auto estimate = [this](const ChatMessage &message) {
+        return ContextBudget::estimateMessageTokens(message, textTokenizer());
+    };
+    compare = std::make_unique<CompareSession>(models, messageHistory, renderInterval(), send,
+                                               abortRequest, estimate);
+    connect(compare.get(), &CompareSession::streamFinished, this, [this]() {
+        setRequestInFlight(requestInFlight);
+    });
+}
+
+void TaskWindow::updatePrimaryStats(bool finished) {
+    if (!primaryStatsLabel || !primaryClock.isValid())
+        return;
+    const int tokens = finished ? primaryCompletionTokens() : 0;
+    primaryStatsLabel->setText(streamStatsText(effectiveModelName(activeRequestTask), primaryFirstTokenMs,
+                                               primaryClock.elapsed(), tokens));
+}
+
+int TaskWindow::primaryCompletionTokens() const {
+    return responseHasUsage && responseUsage.completionTokens > 0
+        ? responseUsage.completionTokens
+        : ContextBudget::estimateTokens(transcript.pending());
+}
+
+QString TaskWindow::effectiveModelName(const TaskDefinition &task) const {
+    return task.modelName.isEmpty()
+        ? normalizeModelName(settings.modelName)
+        : normalizeModelName(task.modelName);
+}
+
+bool TaskWindow::conversationBusy() const {
+    return requestInFlight || (compare && compare->inFlight());
+}
+
+bool TaskWindow::shouldChunkSelection(const QString &text) const {
+    if (!settings.chunkLongSelections)
+        return false;
+    if (settings.maxChars > 0 && text.length() > settings.maxChars)
+        return true;
+    return applyTokenLimit(text).length() < text.length();
+}
+
+QStringList TaskWindow::chunkSelection(const QString &text) const {
+    const QStringList parts = settings.maxChars > 0 ? TextChunker::split(text, settings.maxChars)
+                                                    : QStringList{text};
+    if (settings.maxInputTokens <= 0)
+        return parts;
+
+    // Parts within maxChars can still exceed maxInputTokens, e.g. CJK text or
+    // code, so those are split again with a size scaled by their token density
+    const BpeTokenizer *bpe = textTokenizer();
+    const auto tokensOf = [bpe](const QString &part) {
+        return bpe ? bpe->count(part) : ContextBudget::estimateTokens(part);
+    };
+    QStringList fitted;
+    for (const QString &part : parts) {
+        QStringList pieces{part};
+        int maxChars = static_cast<int>(part.length());
+        while (maxChars > 1) {
+            int maxTokens = 0;
+            for (const QString &piece : std::as_const(pieces))
+                maxTokens = qMax(maxTokens, tokensOf(piece));
+            if (maxTokens <= settings.maxInputTokens)
+                break;
+            maxChars = qMax(1, static_cast<int>(static_cast<qint64>(maxChars) * settings.maxInputTokens / maxTokens));
+            pieces = TextChunker::split(part, maxChars);
+        }
+        fitted += pieces;
+    }
+    return fitted;
+}
+
+void TaskWindow::startChunkedRequest(const TaskDefinition &task, const QString &text) {
+    resetRequestState();
+    activeRequestTask = task;
+    chunkedReply = true;
+    startInsertWriter();
+    setRequestInFlight(true);
+
+    const bool cacheable = isCacheable(task);
+    QList<ChunkedRequest::Part> parts;
+    for (const QString &partText : chunkSelection(text)) {
+        ChunkedRequest::Part part;
+        part.text = partText;
+        if (cacheable) {
+            const QJsonObject body = buildChatBody(task, ChunkedRequest::partMessages(task.prompt, partText));
+            part.cacheKey = ResponseCache::keyFor(settings.apiEndpoint, body);
+        }
+        parts.append(part);
+    }
+    chunkRequest = std::make_unique<ChunkedRequest>(
+        task.prompt, parts, settings.chunkReducePass, settings.maxParallelChunks,
+        [this, task](const QList<ChatMessage> &messages) { return submitChatRequest(task, messages); });
+    qCDebug(lcPerf) << "split selection of" << text.length() << "chars into" << parts.size() << "chunks"
+                    << (settings.chunkReducePass ? "with a reduce pass" : "");
+
+    // Parts answered before are not sent again; the run starts once every
+    // cache read is back
+    chunkLookupsPending = 0;
+    if (cacheable) {
+        const int lookup = cacheLookupSerial;
+        for (int i = 0; i < parts.size(); ++i) {
+            const bool pending = responseCache->lookup(parts.at(i).cacheKey, this, [this, lookup, i](const QString &reply) {
+                if (lookup != cacheLookupSerial || !chunkRequest)
+                    return;
+                chunkRequest->setCachedReply(i, reply);
+                if (--chunkLookupsPending == 0)
+                    startChunkParts();
+            });
+            if (pending)
+                ++chunkLookupsPending;
+        }
+    }
+    if (chunkLookupsPending > 0) {
+        currentRequestId = kCachedRequestId;
+        return;
+    }
+    startChunkParts();
+}
+
+void TaskWindow::startChunkParts() {
+    currentRequestId = 0;
+    applyChunkProgress(chunkRequest->start());
+}
+
+void TaskWindow::applyChunkProgress(const ChunkedRequest::Progress &progress) {
+    if (responseCache && !progress.storeKey.isEmpty() && !progress.storeReply.isEmpty())
+        responseCache->store(progress.storeKey, progress.storeReply);
+
+    recordPartStats(progress.partStats, false);
+
+    if (progress.sendFailed) {
+        const QList<int> remaining = chunkRequest->inFlightRequests();
+        chunkRequest.reset();
+        for (int other : remaining) {
+            if (llmClient)
+                llmClient->abortRequest(other);
+        }
+        // No request is on the network for the reply any more, so it ends
+        // like a failed cache delivery
+        currentRequestId = kCachedRequestId;
+        handleRequestFinished(kCachedRequestId, QNetworkReply::UnknownNetworkError,
+                              tr("The request could not be sent"), 0);
+        return;
+    }
+
+    if (!progress.reduceMessages.isEmpty()) {
+        chunkRequest.reset();
+        // The combining request is timed like any single reply
+        chunkedReply = false;
+        primaryClock.start();
+        primaryFirstTokenMs = -1;
+        sendPrimaryBody(activeRequestTask, buildChatBody(activeRequestTask, progress.reduceMessages));
+        return;
+    }
+
+    // Without a reduce pass the current part streams like a normal reply
+    currentRequestId = progress.currentRequestId;
+    if (progress.finished) {
+        chunkRequest.reset();
+        // Every part came from the cache
+        if (currentRequestId == 0)
+            currentRequestId = kCachedRequestId;
+    }
+    for (const StreamBatch &batch : progress.replay)
+        appendPrimaryBatch(batch);
+    // The last part finishes the reply through the normal path
+    if (progress.finished)
+        handleRequestFinished(currentRequestId, QNetworkReply::NoError, QString(), 200);
+}
+
+bool TaskWindow::handleChunkFinished(int requestId, int error) {
+    if (!chunkRequest || !chunkRequest->owns(requestId))
+        return false;
+
+    if (error != QNetworkReply::NoError) {
+        // The first failure or cancel ends the run and is reported like a
+        // single request; the remaining parts are dropped.
+        if (error != QNetworkReply::OperationCanceledError)
+            recordPartStats(chunkRequest->statsOf(requestId), true);
+        const QList<int> remaining = chunkRequest->inFlightRequests();
+        chunkRequest.reset();
+        for (int other : remaining) {
+            if (other != requestId && llmClient)
+                llmClient->abortRequest(other);
+        }
+        currentRequestId = requestId;
+        return false;
+    }
+
+    applyChunkProgress(chunkRequest->finishPart(requestId));
+    return true;
+}
+
+void TaskWindow::recordPartStats(const ChunkedRequest::PartStats &stats, bool failed) {
+    if (stats.elapsedMs < 0)
+        return;
+    ModelStatsStore::instance()->recordStream(effectiveModelName(activeRequestTask), stats.firstTokenMs,
+                                              stats.elapsedMs, stats.tokens, failed || stats.failed);
+}
+
+void TaskWindow::abortChunkedRequests() {
+    if (!llmClient || !chunkRequest)
+        return;
+    // Aborting may finish the run, and reset chunkRequest, right away
+    const QList<int> requests = chunkRequest->inFlightRequests();
+    for (int requestId : requests)
+        llmClient->abortRequest(requestId);
 }
 
 void TaskWindow::sendRequestWithHistory(const TaskDefinition &task) {
     resetRequestState();
     activeRequestTask = task;
+    startInsertWriter();
     setRequestInFlight(true);
 
-    const QUrl requestUrl = buildApiUrl(settings.apiEndpoint, "chat/completions");
+    const ContextBudgetResult budgeted = ContextBudget::fit(limitSelection(messageHistory), task.contextBudget,
+                                                            textTokenizer());
+    promptTokenEstimate = budgeted.estimatedTokens;
+    droppedContextMessages = budgeted.droppedMessages;
+    if (budgeted.droppedMessages > 0 || budgeted.elided) {
+        qCDebug(lcPerf) << "context budget" << task.contextBudget << "dropped"
+                        << budgeted.droppedMessages << "messages"
+                        << (budgeted.elided ? "and elided the oldest reply" : "");
+    }
+    updateContextLabel();
+    sendPrimaryBody(task, buildChatBody(task, budgeted.messages));
+}
+
+void TaskWindow::sendPrimaryBody(const TaskDefinition &task, const QJsonObject &body) {
+    if (isCacheable(task)) {
+        activeCacheKey = ResponseCache::keyFor(settings.apiEndpoint, body);
+        const int lookup = ++cacheLookupSerial;
+        const bool pending = responseCache->lookup(activeCacheKey, this, [this, lookup, task, body](const QString &text) {
+            // Canceled or superseded while the entry was read
+            if (lookup != cacheLookupSerial || currentRequestId != kCachedRequestId || !requestInFlight)
+                return;
+            if (!text.isEmpty()) {
+                deliverCachedResponse(text);
+                return;
+            }
+            currentRequestId = submitChatBody(task, body);
+        });
+        if (pending) {
+            currentRequestId = kCachedRequestId;
+            return;
+        }
+    }
+    currentRequestId = submitChatBody(task, body);
+}
 
+bool TaskWindow::isCacheable(const TaskDefinition &task) const {
+    if (!responseCache || !settings.responseCache)
+        return false;
+    // Sampled replies differ on every run unless the user opts in
+    return task.temperature == 0.0 || settings.cacheAllTemperatures;
+}
+
+void TaskWindow::deliverCachedResponse(const QString &text) {
+    // Already stored, so the finish handler must not store it again
+    activeCacheKey.clear();
+    StreamBatch batch;
+    batch.text = text;
+    handleStreamBatch(kCachedRequestId, batch);
+    handleRequestFinished(kCachedRequestId, QNetworkReply::NoError, QString(), 200);
+}
+
+int TaskWindow::submitChatRequest(const TaskDefinition &task, const QList<ChatMessage> &messages) {
+    return submitChatBody(task, buildChatBody(task, messages));
+}
+
+QJsonObject TaskWindow::buildChatBody(const TaskDefinition &task, const QList<ChatMessage> &messages) const {
     QJsonArray messagesArray;
-    for (const ChatMessage &msg : messageHistory) {
+    for (const ChatMessage &msg : messages) {
         QJsonObject item;
         item["role"] = msg.role;
         item["content"] = msg.content;
@@ -787,31 +1031,32 @@ void TaskWindow::sendRequestWithHistory(const TaskDefinition &task) {
     }
 
     QJsonObject body;
-    const QString modelName = task.modelName.isEmpty()
-        ? normalizeModelName(settings.modelName)
-        : normalizeModelName(task.modelName);
+    const QString modelName = effectiveModelName(task);
     if (!modelName.isEmpty())
         body["model"] = modelName;
     body["messages"] = messagesArray;
     body["max_tokens"] = task.maxTokens;
     body["temperature"] = task.temperature;
-    if (!task.insertMode)
+    return body;
+}
+
+int TaskWindow::submitChatBody(const TaskDefinition &task, QJsonObject body) {
+    if (!llmClient)
+        return 0;
+
+    const QUrl requestUrl = buildApiUrl(settings.apiEndpoint, "chat/completions");
+    // Streaming only changes the transport, so it stays out of the cache key
+    if (!task.insertMode || settings.streamingInsert)
         body["stream"] = true;
     QJsonDocument bodyDoc(body);
-    const int requestId = ++currentRequestId;
-
-    QMetaObject::invokeMethod(requestWorker,
-                              "startRequest",
-                              Qt::QueuedConnection,
-                              Q_ARG(QUrl, requestUrl),
-                              Q_ARG(int, requestId),
-                              Q_ARG(QByteArray, "Bearer " + settings.apiKey.toUtf8()),
-                              Q_ARG(QByteArray, bodyDoc.toJson()),
-                              Q_ARG(QString, settings.proxy));
+    return llmClient->startRequest(requestUrl,
+                                   "Bearer " + settings.apiKey.toUtf8(),
+                                   bodyDoc.toJson(),
+                                   settings.proxy);
 }
 
 void TaskWindow::sendFollowUpMessage() {
-    if (requestInFlight || !followUpInput)
+    if (conversationBusy() || !followUpInput)
         return;
     if (activeTaskIndex < 0 || activeTaskIndex >= tasks.size())
         return;
@@ -823,37 +1068,56 @@ void TaskWindow::sendFollowUpMessage() {
 
     const QString sendText = applyCharLimit(trimmed);
     appendMessageToHistory("user", sendText);
-    appendTranscriptBlock(formatUserMessageBlock(sendText));
+    appendTranscriptBlock(TranscriptStore::userMessageBlock(sendText));
     followUpInput->clear();
     updateResponseView();
 
     showReplyIndicator();
     sendRequestWithHistory(tasks.at(activeTaskIndex));
+    if (compare) {
+        compare->sendFollowUp(sendText);
+        setRequestInFlight(requestInFlight);
+    }
 }
 
-void TaskWindow::handleRequestReadyRead(int requestId, const QByteArray &chunk) {
-    if (requestId != currentRequestId)
+void TaskWindow::handleStreamBatch(int requestId, const StreamBatch &batch) {
+    if (requestId != 0 && requestId == speculation.requestId) {
+        if (!batch.text.isEmpty() && speculation.firstTokenMs < 0)
+            speculation.firstTokenMs = speculation.clock.elapsed();
+        speculation.batches.append(batch);
+        speculation.receivedChars += batch.text.length();
+        return;
+    }
+    if (compare && compare->handleBatch(requestId, batch))
         return;
-    if (chunk.isEmpty())
+    if (chunkRequest && chunkRequest->addBatch(requestId, batch))
         return;
+    if (requestId != currentRequestId)
+        return;
+    appendPrimaryBatch(batch);
+}
 
-    responseBody.append(chunk);
-    streamBuffer.append(chunk);
+void TaskWindow::appendPrimaryBatch(const StreamBatch &batch) {
+    if (batch.streamFormat)
+        sawStreamFormat = true;
+    if (!batch.finishReason.isEmpty())
+        responseFinishReason = batch.finishReason;
+    if (!batch.errorMessage.isEmpty())
+        responseErrorMessage = batch.errorMessage;
+    if (batch.hasUsage) {
+        responseHasUsage = true;
+        responseUsage = batch.usage;
+    }
 
-    bool appended = false;
-    while (true) {
-        const int lineEnd = streamBuffer.indexOf('\n');
-        if (lineEnd < 0)
-            break;
-        const QByteArray line = streamBuffer.left(lineEnd);
-        streamBuffer.remove(0, lineEnd + 1);
-        const QString delta = parseStreamDelta(line);
-        if (!delta.isEmpty()) {
-            if (!activeRequestTask.insertMode)
-                hideReplyIndicator();
-            pendingResponseText += delta;
-            appended = true;
-        }
+    const bool appended = !batch.text.isEmpty();
+    if (appended && primaryFirstTokenMs < 0 && primaryClock.isValid()) {
+        primaryFirstTokenMs = primaryClock.elapsed();
+        updatePrimaryStats(false);
+    }
+    if (appended) {
+        if (!activeRequestTask.insertMode)
+            stopReplyIndicator();
+        transcript.appendPending(batch.text);
     }
 
     if (sawStreamFormat) {
@@ -863,36 +1127,59 @@ void TaskWindow::handleRequestReadyRead(int requestId, const QByteArray &chunk)
             ensureResponseWindow();
     }
 
+    if (appended && streamingInsert) {
+        hideLoadingIndicator();
+        if (!streamingInsert->append(batch.text))
+            abandonStreamingInsert();
+    }
+
     if (appended && !activeRequestTask.insertMode)
-        updateResponseView();
+        scheduleResponseViewUpdate();
 }
 
 void TaskWindow::handleRequestFinished(int requestId,
                                        int error,
                                        const QString &errorString,
                                        int statusCode) {
+    if (requestId != 0 && requestId == speculation.requestId) {
+        speculation.finished = true;
+        speculation.error = error;
+        speculation.errorString = errorString;
+        speculation.statusCode = statusCode;
+        return;
+    }
+    if (compare && compare->handleFinished(requestId, error, errorString, statusCode))
+        return;
+    if (handleChunkFinished(requestId, error))
+        return;
     if (requestId != currentRequestId)
         return;
 
+    // Every exit path below renders the final state itself
+    renderTimer->stop();
     hideLoadingIndicator();
-    hideReplyIndicator();
+    stopReplyIndicator();
 
-    if (!streamBuffer.isEmpty()) {
-        const QString delta = parseStreamDelta(streamBuffer);
-        if (!delta.isEmpty())
-            pendingResponseText += delta;
-        streamBuffer.clear();
+    // Cache hits and cancels say nothing about the model's speed. Chunked
+    // parts ran in parallel, so each was recorded on its own as it finished.
+    if (requestId != kCachedRequestId && error != QNetworkReply::OperationCanceledError
+        && primaryClock.isValid() && !chunkedReply) {
+        const bool failed = error != QNetworkReply::NoError
+            || (!transcript.hasPending() && !responseErrorMessage.isEmpty());
+        ModelStatsStore::instance()->recordStream(effectiveModelName(activeRequestTask), primaryFirstTokenMs,
+                                                  primaryClock.elapsed(), primaryCompletionTokens(), failed);
     }
 
     if (error != QNetworkReply::NoError) {
         if (error == QNetworkReply::OperationCanceledError) {
             if (activeRequestTask.insertMode) {
-                pendingResponseText.clear();
+                // Text already typed stays; only the unwritten tail is dropped
+                if (streamingInsert)
+                    streamingInsert->cancel();
+                transcript.clearPending();
             } else {
-                if (!pendingResponseText.isEmpty()) {
-                    appendTranscriptBlock(pendingResponseText);
-                    appendMessageToHistory("assistant", pendingResponseText);
-                    pendingResponseText.clear();
+                if (transcript.hasPending()) {
+                    commitPendingResponse();
                 } else {
                     appendTranscriptBlock(QStringLiteral("*Response canceled*"));
                     appendMessageToHistory("assistant", QStringLiteral("Response canceled by user."));
@@ -903,6 +1190,7 @@ void TaskWindow::handleRequestFinished(int requestId,
             clearOriginalClipboardSnapshot();
             return;
         }
+        updateResponseView();
         QMessageBox::critical(this,
                               tr("Error"),
                               tr("LLM request failed (%1): HTTP status %2")
@@ -913,32 +1201,50 @@ void TaskWindow::handleRequestFinished(int requestId,
         return;
     }
 
-    if (!sawStreamFormat && pendingResponseText.isEmpty()) {
-        pendingResponseText = extractResponseTextFromJson(responseBody);
+    if (!transcript.hasPending() && !responseErrorMessage.isEmpty()) {
+        updateResponseView();
+        QMessageBox::critical(this,
+                              tr("Error"),
+                              tr("LLM request failed: %1").arg(responseErrorMessage));
+        setRequestInFlight(false);
+        clearOriginalClipboardSnapshot();
+        return;
+    }
+
+    updatePrimaryStats(true);
+    if (!activeCacheKey.isEmpty() && responseCache && transcript.hasPending()
+        && responseErrorMessage.isEmpty()) {
+        responseCache->store(activeCacheKey, transcript.pending());
     }
+    activeCacheKey.clear();
 
-    if (!pendingResponseText.isEmpty())
-        appendMessageToHistory("assistant", pendingResponseText);
+    if (streamingInsert && !streamingInsert->finish())
+        abandonStreamingInsert();
 
     if (activeRequestTask.insertMode) {
-        if (!pendingResponseText.isEmpty()) {
-            insertResponse(pendingResponseText);
+        if (transcript.hasPending())
+            appendMessageToHistory("assistant", transcript.pending());
+        if (streamingInsert) {
+            qCDebug(lcPerf) << "streamed insert typed" << streamingInsert->writtenChars() << "chars";
+            clearOriginalClipboardSnapshot();
+        } else if (transcript.hasPending()) {
+            insertResponse(transcript.pending());
         } else {
             clearOriginalClipboardSnapshot();
         }
-        pendingResponseText.clear();
+        transcript.clearPending();
         setRequestInFlight(false);
         return;
     }
 
-    if (responseWindow || !pendingResponseText.isEmpty()) {
+    if (responseWindow || transcript.hasPending()) {
         ensureResponseWindow();
-        if (!pendingResponseText.isEmpty()) {
-            appendTranscriptBlock(pendingResponseText);
-            pendingResponseText.clear();
-        }
+        if (transcript.hasPending())
+            commitPendingResponse();
         updateResponseView();
     }
+    qCDebug(lcPerf) << "response rendered" << responseRenderCount << "times in"
+                    << responseRenderNs / 1000000.0 << "ms";
     setRequestInFlight(false);
 }
 
@@ -964,12 +1270,34 @@ void TaskWindow::insertResponse(const QString &text) {
     });
 }
 
+void TaskWindow::startInsertWriter() {
+    streamingInsert.reset();
+    if (!activeRequestTask.insertMode || !settings.streamingInsert)
+        return;
+    // The application with the selection still has focus at this point
+    streamingInsert = std::make_unique<StreamingInsert>();
+}
+
+void TaskWindow::abandonStreamingInsert() {
+    // Focus moved mid-stream; the rest of the answer goes to the response
+    // window instead of whatever the user switched to
+    qCDebug(lcPerf) << "streamed insert stopped after" << streamingInsert->writtenChars()
+                    << "chars, focus moved";
+    streamingInsert.reset();
+    activeRequestTask.insertMode = false;
+    clearOriginalClipboardSnapshot();
+    ensureResponseWindow();
+}
+
 void TaskWindow::ensureResponseWindow() {
     if (responseWindow)
         return;
 
     responseWindow = new QDialog(this);
     responseWindow->setAttribute(Qt::WA_DeleteOnClose, true);
+    connect(responseWindow, &QObject::destroyed, this, [this]() {
+        QTimer::singleShot(0, this, &TaskWindow::closeIfIdle);
+    });
     responseWindow->setWindowFlags(responseWindow->windowFlags() | Qt::Dialog);
     responseWindow->installEventFilter(this);
 
@@ -983,17 +1311,28 @@ void TaskWindow::ensureResponseWindow() {
     responseView->document()->setDefaultFont(font);
     responseView->setReadOnly(true);
     responseView->setOpenExternalLinks(true);
-    responseView->document()->setDefaultStyleSheet(markdownCss());
-    responseView->document()->setDocumentMargin(8);
     responseView->setStyleSheet("QTextBrowser { background-color: #ffffff; }");
-    new MarkdownCodeHighlighter(responseView->document());
+    responseRenderer = new TranscriptRenderer(responseView->document());
     view->setZoomCallback([this]() {
-        applyMarkdownStyles();
+        if (responseRenderer)
+            responseRenderer->updateCodeFontSize();
     });
     view->setZoomDeltaCallback([this](int steps) {
         handleResponseZoomDelta(steps);
     });
-    lay->addWidget(view);
+    if (!compare) {
+        lay->addWidget(view);
+    } else {
+        // Compare mode: the task's own model first, then one column per extra model
+        auto *splitter = new QSplitter(Qt::Horizontal, responseWindow);
+        QLabel *statsLabel = nullptr;
+        splitter->addWidget(CompareSession::createColumn(splitter, view, &statsLabel));
+        primaryStatsLabel = statsLabel;
+        updatePrimaryStats(false);
+        compare->addPanes(splitter, font);
+        compare->setRenderInterval(renderInterval());
+        lay->addWidget(splitter);
+    }
     if (QScrollBar *responseBar = view->verticalScrollBar()) {
         connect(responseBar, &QScrollBar::sliderPressed, this, [this]() {
             responseScrollDragActive = true;
@@ -1080,8 +1419,15 @@ void TaskWindow::ensureResponseWindow() {
     inputRowLayout->addWidget(actionBtn, 0);
 
     lay->addWidget(inputRow);
+
+    auto *contextInfo = new QLabel(responseWindow);
+    contextInfo->setStyleSheet("QLabel { color: #707070; }");
+    contextLabel = contextInfo;
+    lay->addWidget(contextInfo);
     lay->setStretch(0, 1);
     lay->setStretch(1, 0);
+    lay->setStretch(2, 0);
+    updateContextLabel();
     setRequestInFlight(requestInFlight);
 
     responseWindow->setWindowTitle(tr("LLM Response"));
@@ -1105,12 +1451,19 @@ void TaskWindow::updateResponseView() {
         return;
     }
     pendingResponseViewUpdate = false;
+    renderTimer->stop();
+    QElapsedTimer renderClock;
+    renderClock.start();
     const int prevValue = bar ? bar->value() : 0;
     const int prevMax = bar ? bar->maximum() : 0;
     const bool atBottom = bar && (prevMax <= 0 || prevValue >= (prevMax - 2));
-    const QString displayText = buildDisplayMarkdown();
-    responseView->document()->setMarkdown(displayText, QTextDocument::MarkdownDialectGitHub);
-    applyMarkdownStyles();
+    if (responseRenderer) {
+        responseRenderer->render(transcript, replyIndicatorVisible
+            ? QStringLiteral("Replying") + QString(replyDotCount, '.')
+            : QString());
+    }
+    ++responseRenderCount;
+    responseRenderNs += renderClock.nsecsElapsed();
     if (!bar)
         return;
     if (atBottom) {
@@ -1125,57 +1478,38 @@ void TaskWindow::updateResponseView() {
     }
 }
 
-void TaskWindow::applyMarkdownStyles() {
-    if (!responseView)
-        return;
-    QTextDocument *doc = responseView->document();
-    if (!doc)
+void TaskWindow::scheduleResponseViewUpdate() {
+    // The first token is shown at once; later ones are coalesced per frame
+    if (!firstDeltaRendered) {
+        firstDeltaRendered = true;
+        updateResponseView();
         return;
-
-    const qreal codeBlockMargin = 8.0;
-    QTextCharFormat inlineCodeFormat;
-    inlineCodeFormat.setFontFamilies(QStringList{"Consolas"});
-    inlineCodeFormat.setFontFixedPitch(true);
-    inlineCodeFormat.setBackground(QColor("#f6f8fa"));
-    const QFont baseFont = resolveBaseTextFont(doc);
-    if (baseFont.pointSizeF() > 0) {
-        inlineCodeFormat.setFontPointSize(baseFont.pointSizeF());
-    } else if (baseFont.pixelSize() > 0) {
-        inlineCodeFormat.setProperty(QTextFormat::FontPixelSize, baseFont.pixelSize());
     }
+    if (!renderTimer->isActive())
+        renderTimer->start(renderInterval());
+}
 
-    QTextCharFormat blockCodeCharFormat = inlineCodeFormat;
-
-    for (QTextBlock block = doc->begin(); block.isValid(); block = block.next()) {
-        if (isCodeBlock(block)) {
-            QTextCursor blockCursor(block);
-            QTextBlockFormat blockFormat = block.blockFormat();
-            blockFormat.setBackground(QColor("#f6f8fa"));
-            const QTextBlock prevBlock = block.previous();
-            const QTextBlock nextBlock = block.next();
-            const bool isFirstBlock = !prevBlock.isValid() || !isCodeBlock(prevBlock);
-            const bool isLastBlock = !nextBlock.isValid() || !isCodeBlock(nextBlock);
-            blockFormat.setTopMargin(isFirstBlock ? codeBlockMargin : 0.0);
-            blockFormat.setBottomMargin(isLastBlock ? codeBlockMargin : 0.0);
-            blockCursor.setBlockFormat(blockFormat);
-
-            blockCursor.select(QTextCursor::BlockUnderCursor);
-            blockCursor.mergeCharFormat(blockCodeCharFormat);
-            continue;
-        }
+int TaskWindow::renderInterval() const {
+    if (settings.renderIntervalMs > 0)
+        return settings.renderIntervalMs;
+    const QScreen *screen = responseWindow ? responseWindow->screen() : QGuiApplication::primaryScreen();
+    const qreal refreshRate = screen ? screen->refreshRate() : 60.0;
+    return refreshRate > 0 ? qMax(1, qRound(1000.0 / refreshRate)) : 16;
+}
 
-        for (auto it = block.begin(); !it.atEnd(); ++it) {
-            const QTextFragment fragment = it.fragment();
-            if (!fragment.isValid())
-                continue;
-            if (!isInlineCodeFormat(fragment.charFormat()))
-                continue;
-            QTextCursor cursor(doc);
-            cursor.setPosition(fragment.position());
-            cursor.setPosition(fragment.position() + fragment.length(), QTextCursor::KeepAnchor);
-            cursor.mergeCharFormat(inlineCodeFormat);
-        }
+void TaskWindow::updateContextLabel() {
+    if (!contextLabel)
+        return;
+    if (promptTokenEstimate <= 0) {
+        contextLabel->clear();
+        contextLabel->hide();
+        return;
     }
+    QString text = tr("Prompt: ~%1 tokens").arg(promptTokenEstimate);
+    if (droppedContextMessages > 0)
+        text += tr(", %1 earlier messages left out").arg(droppedContextMessages);
+    contextLabel->setText(text);
+    contextLabel->show();
 }
 
 void TaskWindow::updateFollowUpHeight() {
@@ -1216,124 +1550,103 @@ void TaskWindow::updateFollowUpHeight() {
 void TaskWindow::appendMessageToHistory(const QString &role, const QString &content) {
     if (content.trimmed().isEmpty())
         return;
-    messageHistory.append({role, content});
+    ChatMessage message{role, content};
+    message.estimatedTokens = ContextBudget::estimateMessageTokens(message, textTokenizer());
+    messageHistory.append(message);
 }
 
 void TaskWindow::appendTranscriptBlock(const QString &markdown) {
-    const QString normalized = normalizeMarkdownBlock(markdown);
+    const QString normalized = TranscriptStore::normalizedBlock(markdown);
     if (normalized.trimmed().isEmpty())
         return;
-    if (!transcriptText.isEmpty() && !transcriptText.endsWith("\n\n"))
-        transcriptText += "\n\n";
-    transcriptText += normalized;
-}
-
-QString TaskWindow::normalizeMarkdownBlock(const QString &markdown) const {
-    QString normalized = markdown;
-    normalized.replace("\r\n", "\n");
-    normalized.replace("\r", "\n");
-    int fenceCount = 0;
-    static const QRegularExpression fencePattern(R"((^|\n)\s*```)");
-    auto fenceIt = fencePattern.globalMatch(normalized);
-    while (fenceIt.hasNext()) {
-        fenceIt.next();
-        ++fenceCount;
-    }
-    if (fenceCount % 2 != 0) {
-        if (!normalized.endsWith('\n'))
-            normalized += '\n';
-        normalized += "```";
-    }
-    return normalized;
-}
-
-QString TaskWindow::formatUserMessageBlock(const QString &text) const {
-    QString normalized = text;
-    normalized.replace("\r\n", "\n");
-    normalized.replace("\r", "\n");
-    const QStringList lines = normalized.split('\n');
-
-    QString block = "---\n";
-    block += "> **You**: \n";
-    for (const QString &line : lines)
-        block += "> " + line + "  \n";
-    block += "\n---";
-    return block;
+    transcript.appendBlock(normalized);
 }
 
-QString TaskWindow::buildDisplayMarkdown() const {
-    QString displayText = transcriptText;
-    if (!pendingResponseText.isEmpty()) {
-        if (!displayText.isEmpty() && !displayText.endsWith("\n\n"))
-            displayText += "\n\n";
-        displayText += pendingResponseText;
-    }
-    if (replyIndicatorVisible) {
-        if (!displayText.isEmpty() && !displayText.endsWith("\n\n"))
-            displayText += "\n\n";
-        displayText += QStringLiteral("Replying") + QString(replyDotCount, '.');
-    }
-    return displayText;
-}
-
-QString TaskWindow::extractResponseTextFromJson(const QByteArray &data) const {
-    const QJsonDocument respDoc = QJsonDocument::fromJson(data);
-    if (!respDoc.isObject())
-        return QString();
-    const QJsonObject respObj = respDoc.object();
-    const QJsonArray choices = respObj.value("choices").toArray();
-    if (choices.isEmpty())
-        return QString();
-    const QJsonObject msg = choices.first().toObject()
-        .value("message")
-        .toObject();
-    return msg.value("content").toString();
+void TaskWindow::commitPendingResponse() {
+    qCDebug(lcPerf) << "response of" << transcript.pending().size() << "chars grew its buffer"
+                    << transcript.pendingReallocations() << "times";
+    appendMessageToHistory("assistant", transcript.pending());
+    appendTranscriptBlock(transcript.takePending());
 }
 
 void TaskWindow::resetRequestState() {
-    responseBody.clear();
-    streamBuffer.clear();
-    pendingResponseText.clear();
+    transcript.clearPending();
+    primaryClock.start();
+    primaryFirstTokenMs = -1;
+    chunkedReply = false;
+    activeCacheKey.clear();
+    ++cacheLookupSerial;
+    responseFinishReason.clear();
+    responseErrorMessage.clear();
+    responseHasUsage = false;
+    responseUsage = TokenUsage();
     sawStreamFormat = false;
-    if (requestInFlight && requestWorker) {
-        QMetaObject::invokeMethod(requestWorker,
-                                  "abortRequest",
-                                  Qt::QueuedConnection);
-    }
+    firstDeltaRendered = false;
+    responseRenderCount = 0;
+    responseRenderNs = 0;
+    if (requestInFlight && llmClient)
+        llmClient->abortRequest(currentRequestId);
+    abortChunkedRequests();
+    chunkRequest.reset();
 }
 
 void TaskWindow::resetConversationState() {
     hideReplyIndicator();
     messageHistory.clear();
-    transcriptText.clear();
-    pendingResponseText.clear();
+    promptTokenEstimate = 0;
+    droppedContextMessages = 0;
+    updateContextLabel();
+    transcript.clear();
     responseScrollDragActive = false;
     pendingResponseViewUpdate = false;
     resetRequestState();
+    if (compare)
+        compare->abort();
+    compare.reset();
     setRequestInFlight(false);
     if (followUpInput)
         followUpInput->clear();
     if (responseView)
         responseView->clear();
+    if (responseRenderer)
+        responseRenderer->reset();
 }
 
-void TaskWindow::setRequestInFlight(bool inFlight) {
-    if (requestInFlight == inFlight) {
-        if (inFlight)
-            installOperationCancelHook();
-        else
-            removeOperationCancelHook();
-    } else if (inFlight) {
-        installOperationCancelHook();
-    } else {
-        removeOperationCancelHook();
+bool TaskWindow::hasConversation() const {
+    return activeTaskIndex >= 0;
+}
+
+void TaskWindow::dismissMenu() {
+    // An untouched menu is only hidden so the next hotkey just shows it again
+    if (hasConversation() || speculation.captureActive) {
+        close();
+        return;
     }
+    hide();
+    discardSpeculativeRequest();
+    speculation = SpeculativeRequest();
+    restoreOriginalClipboard();
+    clearOriginalClipboardSnapshot();
+}
 
+void TaskWindow::closeIfIdle() {
+    // A finished conversation without a response window has nothing left to show
+    if (!hasConversation() || isVisible() || conversationBusy() || responseWindow || loadingWindow)
+        return;
+    close();
+}
+
+void TaskWindow::setRequestInFlight(bool inFlight) {
     requestInFlight = inFlight;
+    // Compare streams may outlive the primary request, so this follows the
+    // whole conversation rather than inFlight
+    updateOperationCancelHook();
+    if (!inFlight)
+        QTimer::singleShot(0, this, &TaskWindow::closeIfIdle);
     if (followUpInput)
-        followUpInput->setEnabled(!inFlight);
+        followUpInput->setEnabled(!conversationBusy());
     updateActionButtonState();
-    if (!inFlight && followUpInput && responseWindow && responseWindow->isVisible()) {
+    if (!conversationBusy() && followUpInput && responseWindow && responseWindow->isVisible()) {
         responseWindow->raise();
         responseWindow->activateWindow();
         QTimer::singleShot(0, this, [this]() {
@@ -1347,7 +1660,7 @@ void TaskWindow::updateActionButtonState() {
     if (!actionButton)
         return;
 
-    if (requestInFlight) {
+    if (conversationBusy()) {
         actionButton->setText(QStringLiteral("\u25A0"));
         actionButton->setToolTip(tr("Stop"));
         actionButton->setEnabled(true);
@@ -1361,38 +1674,21 @@ void TaskWindow::updateActionButtonState() {
 }
 
 void TaskWindow::cancelRequest() {
-    if (!requestInFlight)
+    if (!conversationBusy())
+        return;
+    if (compare)
+        compare->abort();
+    // A canceled part ends a chunked run through handleChunkFinished
+    abortChunkedRequests();
+    if (currentRequestId == kCachedRequestId) {
+        // Nothing on the network yet; the pending cache reads are ignored
+        ++cacheLookupSerial;
+        chunkRequest.reset();
+        handleRequestFinished(kCachedRequestId, QNetworkReply::OperationCanceledError, QString(), 0);
         return;
-    if (requestWorker) {
-        QMetaObject::invokeMethod(requestWorker,
-                                  "abortRequest",
-                                  Qt::QueuedConnection);
     }
-}
-
-QString TaskWindow::parseStreamDelta(const QByteArray &line) {
-    const QByteArray trimmed = line.trimmed();
-    if (trimmed.isEmpty())
-        return QString();
-    if (!trimmed.startsWith("data:"))
-        return QString();
-    sawStreamFormat = true;
-    const QByteArray payload = trimmed.mid(5).trimmed();
-    if (payload == "[DONE]")
-        return QString();
-
-    const QJsonDocument doc = QJsonDocument::fromJson(payload);
-    if (!doc.isObject())
-        return QString();
-    const QJsonObject obj = doc.object();
-    const QJsonArray choices = obj.value("choices").toArray();
-    if (choices.isEmpty())
-        return QString();
-    const QJsonObject choice = choices.first().toObject();
-    QString deltaText = choice.value("delta").toObject().value("content").toString();
-    if (deltaText.isEmpty())
-        deltaText = choice.value("message").toObject().value("content").toString();
-    return deltaText;
+    if (llmClient && currentRequestId != 0)
+        llmClient->abortRequest(currentRequestId);
 }
 
 void TaskWindow::applyResponsePrefs() {
@@ -1407,7 +1703,7 @@ void TaskWindow::applyResponsePrefs() {
             || task.responseHeight != targetSize.height()) {
             task.responseWidth = targetSize.width();
             task.responseHeight = targetSize.height();
-            emit taskResponsePrefsChanged(activeTaskIndex, targetSize, task.responseZoom);
+            emit taskResponsePrefsChanged(task.id, targetSize, task.responseZoom);
         }
     }
 
@@ -1419,7 +1715,8 @@ void TaskWindow::applyResponsePrefs() {
             responseView->zoomIn(targetZoom);
         else if (targetZoom < 0)
             responseView->zoomOut(-targetZoom);
-        applyMarkdownStyles();
+        if (responseRenderer)
+            responseRenderer->updateCodeFontSize();
     }
 }
 
@@ -1433,7 +1730,7 @@ void TaskWindow::handleResponseResize(const QSize &size) {
         return;
     task.responseWidth = size.width();
     task.responseHeight = size.height();
-    emit taskResponsePrefsChanged(activeTaskIndex, size, task.responseZoom);
+    emit taskResponsePrefsChanged(task.id, size, task.responseZoom);
 }
 
 void TaskWindow::handleResponseZoomDelta(int steps) {
@@ -1446,7 +1743,7 @@ void TaskWindow::handleResponseZoomDelta(int steps) {
     if (newZoom == task.responseZoom)
         return;
     task.responseZoom = newZoom;
-    emit taskResponsePrefsChanged(activeTaskIndex,
+    emit taskResponsePrefsChanged(task.id,
                                   QSize(task.responseWidth, task.responseHeight),
                                   task.responseZoom);
 }
@@ -1547,8 +1844,15 @@ void TaskWindow::removeMenuHooks() {
     }
 }
 
-void TaskWindow::installOperationCancelHook() {
-    s_activeOperation = this;
+void TaskWindow::updateOperationCancelHook() {
+    const bool busy = conversationBusy();
+    if (busy == s_busyOperations.contains(this))
+        return;
+    if (!busy) {
+        removeOperationCancelHook();
+        return;
+    }
+    s_busyOperations.append(this);
     if (!s_operationKeyboardHook) {
         s_operationKeyboardHook = SetWindowsHookExW(WH_KEYBOARD_LL,
                                                     LowLevelOperationKeyboardProc,
@@ -1558,10 +1862,9 @@ void TaskWindow::installOperationCancelHook() {
 }
 
 void TaskWindow::removeOperationCancelHook() {
-    if (s_activeOperation != this)
-        return;
-    s_activeOperation = nullptr;
-    if (s_operationKeyboardHook) {
+    s_busyOperations.removeOne(this);
+    // Other conversations may still be streaming
+    if (s_busyOperations.isEmpty() && s_operationKeyboardHook) {
         UnhookWindowsHookEx(s_operationKeyboardHook);
         s_operationKeyboardHook = nullptr;
     }
@@ -1599,10 +1902,11 @@ LRESULT CALLBACK TaskWindow::LowLevelMouseProc(int nCode, WPARAM wParam, LPARAM
 LRESULT CALLBACK TaskWindow::LowLevelOperationKeyboardProc(int nCode,
                                                            WPARAM wParam,
                                                            LPARAM lParam) {
-    if (nCode == HC_ACTION && s_activeOperation) {
+    // Escape stops the conversation that started most recently
+    if (nCode == HC_ACTION && !s_busyOperations.isEmpty()) {
         const auto *data = reinterpret_cast<KBDLLHOOKSTRUCT *>(lParam);
         if (wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN) {
-            if (s_activeOperation->handleOperationHookKey(static_cast<UINT>(data->vkCode)))
+            if (s_busyOperations.last()->handleOperationHookKey(static_cast<UINT>(data->vkCode)))
                 return 1;
         }
     }
@@ -1615,7 +1919,7 @@ bool TaskWindow::handleHookKey(UINT vk) {
     const bool shift = (GetAsyncKeyState(VK_SHIFT) & 0x8000) != 0;
     switch (vk) {
         case VK_ESCAPE:
-            close();
+            dismissMenu();
             return true;
         case VK_TAB:
             if (shift)
@@ -1641,7 +1945,7 @@ bool TaskWindow::handleHookKey(UINT vk) {
 }
 
 bool TaskWindow::handleOperationHookKey(UINT vk) {
-    if (vk != VK_ESCAPE || !requestInFlight)
+    if (vk != VK_ESCAPE || !conversationBusy())
         return false;
     cancelRequest();
     return true;
@@ -1651,7 +1955,7 @@ void TaskWindow::handleHookMouseClick(const POINT &pt) {
     if (!isVisible())
         return;
     if (!isPointInsideMenu(pt))
-        close();
+        dismissMenu();
 }
 
 bool TaskWindow::isPointInsideMenu(const POINT &pt) const {
@@ -1784,15 +2088,20 @@ void TaskWindow::showReplyIndicator() {
 }
 
 void TaskWindow::hideReplyIndicator() {
+    if (stopReplyIndicator())
+        updateResponseView();
+}
+
+bool TaskWindow::stopReplyIndicator() {
     if (replyIndicatorTimer) {
         replyIndicatorTimer->stop();
         replyIndicatorTimer->deleteLater();
         replyIndicatorTimer = nullptr;
     }
     if (!replyIndicatorVisible)
-        return;
+        return false;
     replyIndicatorVisible = false;
-    updateResponseView();
+    return true;
 }
 
 void TaskWindow::updateLoadingPosition() {
@@ -1822,7 +2131,16 @@ void TaskWindow::animateReplyIndicator() {
 
 void TaskWindow::keyPressEvent(QKeyEvent *ev) {
     if (ev->key() == Qt::Key_Escape)
-        close();
+        dismissMenu();
     else
         QWidget::keyPressEvent(ev);
 }
+
+void TaskWindow::paintEvent(QPaintEvent *event) {
+    QWidget::paintEvent(event);
+    if (!menuPopupClock.isValid())
+        return;
+    qCDebug(lcPerf) << "menu painted" << menuPopupClock.elapsed() << "ms after hotkey,"
+                    << tasks.size() << "tasks, shown" << menuPopupCount << "times";
+    menuPopupClock.invalidate();
+}
@@ -2,61 +2,61 @@
 #define TASKWINDOW_H
 
 #include <QWidget>
+#include <QFont>
 #include <QList>
 #include <QEvent>
 #include <QKeyEvent>
 #include <QTimer>
 #include <QLabel>
 #include <QPointer>
+#include <QElapsedTimer>
 #include <QSize>
 
 #include <memory>
 
 #include <windows.h>
 
+#include "chunkedrequest.h"
+#include "comparesession.h"
 #include "configstore.h"
+#include "contextbudget.h"
+#include "llmclient.h"
+#include "textsink.h"
+#include "transcriptstore.h"
 
 class QByteArray;
 class QHideEvent;
 class QPushButton;
 class QShowEvent;
-class QNetworkAccessManager;
-class QNetworkReply;
-class QThread;
 class QTextBrowser;
 class QDialog;
 class QPlainTextEdit;
 class QMimeData;
+class BpeTokenizer;
+class ResponseCache;
+class TranscriptRenderer;
+class QJsonObject;
 class QUrl;
 
-class TaskRequestWorker : public QObject {
-    Q_OBJECT
-
-public:
-    explicit TaskRequestWorker(QObject *parent = nullptr);
-
-public slots:
-    void startRequest(const QUrl &url,
-                      int requestId,
-                      const QByteArray &authorizationHeader,
-                      const QByteArray &body,
-                      const QString &proxyText);
-    void abortRequest();
-
-signals:
-    void readyRead(int requestId, const QByteArray &chunk);
-    void finished(int requestId, int error, const QString &errorString, int statusCode);
-
-private:
-    QNetworkAccessManager *networkManager;
-    QPointer<QNetworkReply> reply;
-
-    void applyProxy(const QString &proxyText);
-};
-
-struct ChatMessage {
-    QString role;
-    QString content;
+// Request fired for the most used task while the menu is still open. Its
+// stream is buffered until the user picks that task, or discarded otherwise.
+struct SpeculativeRequest {
+    int taskIndex = -1;
+    int requestId = 0;
+    QString capturedText;
+    bool captured = false;
+    bool captureActive = false;
+    int pendingPick = -1;
+    int modifierPolls = 0;
+    QList<StreamBatch> batches;
+    int receivedChars = 0;
+    int promptChars = 0;
+    QElapsedTimer clock;
+    qint64 firstTokenMs = -1;
+    bool finished = false;
+    int error = 0;
+    QString errorString;
+    int statusCode = 0;
 };
 
 class TaskWindow : public QWidget {
@@ -65,15 +65,27 @@ class TaskWindow : public QWidget {
 public:
     explicit TaskWindow(const QList<TaskDefinition> &taskList,
                         const AppSettings &settings,
+                        LlmClient *client,
+                        ResponseCache *cache,
                         QWidget *parent = nullptr);
     ~TaskWindow() override;
 
+    // The menu is built hidden; this places it at the cursor and shows it
+    void popupAt(const QPoint &cursorPos, const QElapsedTimer &hotkeyClock);
+    // Same buttons, fresher definitions such as prompts and use counts
+    void refreshTasks(const QList<TaskDefinition> &taskList);
+    bool hasConversation() const;
+
 signals:
-    void taskResponsePrefsChanged(int taskIndex, const QSize &size, int zoom);
+    // Tasks are named by TaskDefinition::id, since the settings may reorder
+    // them while a conversation is open
+    void taskResponsePrefsChanged(const QString &taskId, const QSize &size, int zoom);
     void taskResponsePrefsCommitRequested();
+    void taskUsed(const QString &taskId);
 
 protected:
     void keyPressEvent(QKeyEvent *ev) override;
+    void paintEvent(QPaintEvent *event) override;
     bool eventFilter(QObject *watched, QEvent *event) override;
     void showEvent(QShowEvent *event) override;
     void hideEvent(QHideEvent *event) override;
@@ -90,8 +102,11 @@ private:
     TaskDefinition activeRequestTask;
     int activeTaskIndex;
     AppSettings settings;
-    QThread *requestThread;
-    TaskRequestWorker *requestWorker;
+    QPointer<LlmClient> llmClient;
+    QPointer<ResponseCache> responseCache;
+    QByteArray activeCacheKey;
+    // Bumped to drop the answer of a cache read still in progress
+    int cacheLookupSerial;
     QWidget *loadingWindow;
     QTimer *loadingTimer;
     QLabel *loadingLabel;
@@ -99,16 +114,26 @@ private:
     int dotCount;
     QTimer *replyIndicatorTimer;
     int replyDotCount;
+    QTimer *renderTimer;
+    bool firstDeltaRendered;
+    int responseRenderCount;
+    qint64 responseRenderNs;
 
     QPointer<QDialog> responseWindow;
     QPointer<QTextBrowser> responseView;
     QPointer<QPlainTextEdit> followUpInput;
     QPointer<QPushButton> actionButton;
-    QByteArray responseBody;
-    QByteArray streamBuffer;
-    QString transcriptText;
-    QString pendingResponseText;
+    QPointer<QLabel> contextLabel;
+    TranscriptStore transcript;
+    QPointer<TranscriptRenderer> responseRenderer;
     QList<ChatMessage> messageHistory;
+    mutable std::shared_ptr<const BpeTokenizer> tokenizer;
+    int promptTokenEstimate;
+    int droppedContextMessages;
+    QString responseFinishReason;
+    QString responseErrorMessage;
+    bool responseHasUsage;
+    TokenUsage responseUsage;
     int currentRequestId;
     bool sawStreamFormat;
     bool requestInFlight;
@@ -118,10 +143,27 @@ private:
     bool originalClipboardWasEmpty;
     QList<QPushButton *> menuButtons;
     int menuActiveIndex;
+    int menuPopupCount;
+    QElapsedTimer menuPopupClock;
     std::unique_ptr<QMimeData> originalClipboardData;
+    SpeculativeRequest speculation;
+    std::unique_ptr<ChunkedRequest> chunkRequest;
+    // Cache reads still running before the chunked run can start
+    int chunkLookupsPending;
+    // The primary reply is a chunked run's parts, not a single request
+    bool chunkedReply;
+    std::unique_ptr<CompareSession> compare;
+    QPointer<QLabel> primaryStatsLabel;
+    QElapsedTimer primaryClock;
+    qint64 primaryFirstTokenMs;
+    std::unique_ptr<StreamingInsert> streamingInsert;
 
     static TaskWindow *s_activeMenu;
-    static TaskWindow *s_activeOperation;
+    // Busy conversations, most recently started last
+    static QList<TaskWindow *> s_busyOperations;
+    static int s_speculationHits;
+    static int s_speculationMisses;
+    static qint64 s_speculationWastedTokens;
     static HHOOK s_keyboardHook;
     static HHOOK s_mouseHook;
     static HHOOK s_operationKeyboardHook;
@@ -129,39 +171,71 @@ private:
     static LRESULT CALLBACK LowLevelMouseProc(int nCode, WPARAM wParam, LPARAM lParam);
     static LRESULT CALLBACK LowLevelOperationKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam);
 
-    QString captureSelectedText();
     void saveOriginalClipboard();
     void restoreOriginalClipboard();
     void clearOriginalClipboardSnapshot();
     void setClipboardText(const QString &text, bool excludeFromHistory);
     QString applyCharLimit(const QString &text) const;
+    QString applyTokenLimit(const QString &text) const;
+    QList<ChatMessage> limitSelection(QList<ChatMessage> history) const;
+    const BpeTokenizer *textTokenizer() const;
     void startConversation(const TaskDefinition &task, const QString &originalText);
     void sendRequestWithHistory(const TaskDefinition &task);
-    void handleRequestReadyRead(int requestId, const QByteArray &chunk);
+    void sendPrimaryBody(const TaskDefinition &task, const QJsonObject &body);
+    int submitChatRequest(const TaskDefinition &task, const QList<ChatMessage> &messages);
+    QJsonObject buildChatBody(const TaskDefinition &task, const QList<ChatMessage> &messages) const;
+    int submitChatBody(const TaskDefinition &task, QJsonObject body);
+    bool isCacheable(const TaskDefinition &task) const;
+    void deliverCachedResponse(const QString &text);
+    void activateTask(int taskIndex);
+    void continueActivation(const QString &original);
+    int mostLikelyTaskIndex() const;
+    void startSpeculativePrefetch();
+    void finishSpeculativeCapture(int taskIndex, const QString &original);
+    bool adoptSpeculativeRequest(const TaskDefinition &task, const QString &originalText);
+    void discardSpeculativeRequest();
+    void reportSpeculation(bool hit, qint64 wastedTokens);
+    bool shouldChunkSelection(const QString &text) const;
+    QStringList chunkSelection(const QString &text) const;
+    void startChunkedRequest(const TaskDefinition &task, const QString &text);
+    void startChunkParts();
+    void applyChunkProgress(const ChunkedRequest::Progress &progress);
+    bool handleChunkFinished(int requestId, int error);
+    void recordPartStats(const ChunkedRequest::PartStats &stats, bool failed);
+    void abortChunkedRequests();
+    void startCompareSession(const TaskDefinition &task);
+    void updatePrimaryStats(bool finished);
+    int primaryCompletionTokens() const;
+    QString effectiveModelName(const TaskDefinition &task) const;
+    bool conversationBusy() const;
+    void handleStreamBatch(int requestId, const StreamBatch &batch);
+    void appendPrimaryBatch(const StreamBatch &batch);
     void handleRequestFinished(int requestId, int error, const QString &errorString, int statusCode);
     void insertResponse(const QString &text);
+    void startInsertWriter();
+    void abandonStreamingInsert();
     void ensureResponseWindow();
     void updateResponseView();
-    void applyMarkdownStyles();
+    void scheduleResponseViewUpdate();
+    int renderInterval() const;
     void updateFollowUpHeight();
+    void updateContextLabel();
     void appendMessageToHistory(const QString &role, const QString &content);
     void appendTranscriptBlock(const QString &markdown);
-    QString normalizeMarkdownBlock(const QString &markdown) const;
-    QString formatUserMessageBlock(const QString &text) const;
-    QString buildDisplayMarkdown() const;
-    QString extractResponseTextFromJson(const QByteArray &data) const;
+    void commitPendingResponse();
     void resetRequestState();
     void resetConversationState();
     void setRequestInFlight(bool inFlight);
+    void closeIfIdle();
+    void dismissMenu();
     void updateActionButtonState();
     void cancelRequest();
-    QString parseStreamDelta(const QByteArray &line);
     void applyResponsePrefs();
     void handleResponseResize(const QSize &size);
     void handleResponseZoomDelta(int steps);
     void installMenuHooks();
     void removeMenuHooks();
-    void installOperationCancelHook();
+    void updateOperationCancelHook();
     void removeOperationCancelHook();
     bool handleHookKey(UINT vk);
     bool handleOperationHookKey(UINT vk);
@@ -177,6 +251,7 @@ private:
     void hideLoadingIndicator();
     void showReplyIndicator();
     void hideReplyIndicator();
+    bool stopReplyIndicator();
 };
 
 #endif // TASKWINDOW_H
@@ -0,0 +1,241 @@
+#include "bpetokenizer.h"
+
+#include <QFile>
+#include <QHash>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <climits>
+
+namespace {
+// Single bytes take the first 256 ranks, as in the published vocabularies
+QList<QByteArray> byteTokens() {
+    QList<QByteArray> tokens;
+    for (int i = 0; i < 256; ++i)
+        tokens.append(QByteArray(1, static_cast<char>(i)));
+    return tokens;
+}
+
+QList<QByteArray> mergeTokens() {
+    QList<QByteArray> tokens = byteTokens();
+    tokens += {"ab", "bc", "ca", "aa", "abc", "aaaa", "cab", "bca", "abcabc", "bb", "bbb"};
+    return tokens;
+}
+
+bool writeVocabulary(const QString &path, const QList<QByteArray> &tokens) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    QByteArray data;
+    for (int rank = 0; rank < tokens.size(); ++rank)
+        data += tokens.at(rank).toBase64() + ' ' + QByteArray::number(rank) + '\n';
+    return file.write(data) == data.size();
+}
+
+// Textbook byte-pair merge: rescans every pair after each merge
+int referenceCount(const QHash<QByteArray, int> &ranks, const QByteArray &piece) {
+    if (piece.size() <= 1)
+        return static_cast<int>(piece.size());
+    if (ranks.contains(piece))
+        return 1;
+    QList<QByteArray> parts;
+    for (char byte : piece)
+        parts.append(QByteArray(1, byte));
+    while (true) {
+        qsizetype best = -1;
+        int bestRank = INT_MAX;
+        for (qsizetype i = 0; i + 1 < parts.size(); ++i) {
+            const auto it = ranks.constFind(parts.at(i) + parts.at(i + 1));
+            if (it != ranks.constEnd() && it.value() < bestRank) {
+                bestRank = it.value();
+                best = i;
+            }
+        }
+        if (best < 0)
+            break;
+        parts[best] += parts.at(best + 1);
+        parts.removeAt(best + 1);
+    }
+    return static_cast<int>(parts.size());
+}
+
+QByteArray randomLetters(QRandomGenerator *random, int length, const char *alphabet) {
+    const int alphabetSize = static_cast<int>(qstrlen(alphabet));
+    QByteArray letters;
+    for (int i = 0; i < length; ++i)
+        letters.append(alphabet[random->bounded(alphabetSize)]);
+    return letters;
+}
+}
+
+class TestBpeTokenizer : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void matchesReferenceMerges_data();
+    void matchesReferenceMerges();
+    void longRun();
+    void truncateCutsBetweenPieces();
+    void missingFileIsNull();
+    void largeVocabularyUsesO200kPattern();
+    void preloadLoadsInBackground();
+    void cl100kCounts_data();
+    void cl100kCounts();
+    void benchmarkProse();
+    void benchmarkLongPiece();
+
+private:
+    QTemporaryDir directory;
+    std::shared_ptr<const BpeTokenizer> tokenizer;
+    QHash<QByteArray, int> ranks;
+};
+
+void TestBpeTokenizer::initTestCase() {
+    QVERIFY(directory.isValid());
+    const QList<QByteArray> tokens = mergeTokens();
+    for (int rank = 0; rank < tokens.size(); ++rank)
+        ranks.insert(tokens.at(rank), rank);
+    const QString path = directory.filePath(QStringLiteral("merges.tiktoken"));
+    QVERIFY(writeVocabulary(path, tokens));
+    tokenizer = BpeTokenizer::load(path);
+    QVERIFY(tokenizer);
+    QCOMPARE(tokenizer->vocabularySize(), tokens.size());
+}
+
+void TestBpeTokenizer::matchesReferenceMerges_data() {
+    QTest::addColumn<QByteArray>("piece");
+    QTest::newRow("single byte") << QByteArray("a");
+    QTest::newRow("whole token") << QByteArray("abcabc");
+    QTest::newRow("no merges") << QByteArray("xyz");
+    QTest::newRow("odd run") << QByteArray("aaaaa");
+    QTest::newRow("competing pairs") << QByteArray("abcabcab");
+    QTest::newRow("rank beats position") << QByteArray("cabca");
+    QTest::newRow("equal ranks go left first") << QByteArray("bbbbb");
+
+    // Letters only, so each row is one pre-tokenized piece
+    QRandomGenerator random(42);
+    for (int row = 0; row < 40; ++row) {
+        const int length = 1 + random.bounded(80);
+        QTest::addRow("random %d", row) << randomLetters(&random, length, "abc");
+    }
+    QTest::newRow("long mixed run") << randomLetters(&random, 1000, "ab");
+}
+
+void TestBpeTokenizer::matchesReferenceMerges() {
+    QFETCH(QByteArray, piece);
+    QCOMPARE(tokenizer->count(QString::fromLatin1(piece)), referenceCount(ranks, piece));
+}
+
+void TestBpeTokenizer::longRun() {
+    // "aa" merges first everywhere, then pairs of "aa" become "aaaa"
+    QCOMPARE(tokenizer->count(QString(100000, u'a')), 25000);
+    QCOMPARE(tokenizer->count(QString(100001, u'a')), 25001);
+}
+
+void TestBpeTokenizer::truncateCutsBetweenPieces() {
+    // Pieces "abc", " abc", " abc" count 1, 2 and 2 tokens
+    const QString text = QStringLiteral("abc abc abc");
+    QCOMPARE(tokenizer->count(text), 5);
+    QCOMPARE(tokenizer->truncate(text, 0), text);
+    QCOMPARE(tokenizer->truncate(text, 2), QStringLiteral("abc"));
+    QCOMPARE(tokenizer->truncate(text, 3), QStringLiteral("abc abc"));
+    QCOMPARE(tokenizer->truncate(text, 5), text);
+}
+
+void TestBpeTokenizer::missingFileIsNull() {
+    QVERIFY(!BpeTokenizer::load(directory.filePath(QStringLiteral("missing.tiktoken"))));
+    QVERIFY(!BpeTokenizer::load(QString()));
+
+    const QString path = directory.filePath(QStringLiteral("malformed.tiktoken"));
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("YQ== not-a-rank\n");
+    file.close();
+    QVERIFY(!BpeTokenizer::load(path));
+}
+
+void TestBpeTokenizer::largeVocabularyUsesO200kPattern() {
+    QList<QByteArray> tokens = byteTokens();
+    tokens += {"Hello", "World", "HelloWorld"};
+    const QString smallPath = directory.filePath(QStringLiteral("small.tiktoken"));
+    QVERIFY(writeVocabulary(smallPath, tokens));
+
+    // Filler tokens that no test text contains
+    for (int i = 0; tokens.size() <= 150000; ++i) {
+        QByteArray filler("\xFF");
+        filler.append(static_cast<char>(i >> 16));
+        filler.append(static_cast<char>(i >> 8));
+        filler.append(static_cast<char>(i));
+        tokens.append(filler);
+    }
+    const QString largePath = directory.filePath(QStringLiteral("large.tiktoken"));
+    QVERIFY(writeVocabulary(largePath, tokens));
+
+    // cl100k_base keeps a run of letters together; o200k_base splits it
+    // before each upper-case letter
+    const std::shared_ptr<const BpeTokenizer> small = BpeTokenizer::load(smallPath);
+    QVERIFY(small);
+    QCOMPARE(small->count(QStringLiteral("HelloWorld")), 1);
+    const std::shared_ptr<const BpeTokenizer> large = BpeTokenizer::load(largePath);
+    QVERIFY(large);
+    QCOMPARE(large->count(QStringLiteral("HelloWorld")), 2);
+}
+
+void TestBpeTokenizer::preloadLoadsInBackground() {
+    const QString path = directory.filePath(QStringLiteral("preload.tiktoken"));
+    QVERIFY(writeVocabulary(path, mergeTokens()));
+    QVERIFY(!BpeTokenizer::cached(QString()));
+
+    BpeTokenizer::preload(path);
+    QTRY_VERIFY(BpeTokenizer::cached(path));
+    QCOMPARE(BpeTokenizer::cached(path)->count(QStringLiteral("abcabc")), 1);
+}
+
+void TestBpeTokenizer::cl100kCounts_data() {
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<int>("tokens");
+    QTest::newRow("hello world") << QStringLiteral("hello world") << 2;
+    QTest::newRow("tiktoken") << QStringLiteral("tiktoken is great!") << 6;
+}
+
+void TestBpeTokenizer::cl100kCounts() {
+    const QString path = qEnvironmentVariable("CL100K_BASE_VOCABULARY");
+    if (path.isEmpty())
+        QSKIP("Set CL100K_BASE_VOCABULARY to a cl100k_base.tiktoken file");
+    const std::shared_ptr<const BpeTokenizer> cl100k = BpeTokenizer::load(path);
+    QVERIFY(cl100k);
+    QFETCH(QString, text);
+    QFETCH(int, tokens);
+    QCOMPARE(cl100k->count(text), tokens);
+}
+
+void TestBpeTokenizer::benchmarkProse() {
+    QRandomGenerator random(7);
+    QString text;
+    while (text.size() < 200000) {
+        text += QString::fromLatin1(randomLetters(&random, 1 + random.bounded(9), "abcxyz"));
+        text += random.bounded(8) == 0 ? QStringLiteral(".\n") : QStringLiteral(" ");
+    }
+    int tokens = 0;
+    QBENCHMARK {
+        tokens = tokenizer->count(text);
+    }
+    QVERIFY(tokens > 0);
+}
+
+void TestBpeTokenizer::benchmarkLongPiece() {
+    // One piece with no whitespace, the case that used to be quadratic
+    QRandomGenerator random(11);
+    const QString text = QString::fromLatin1(randomLetters(&random, 200000, "abc"));
+    int tokens = 0;
+    QBENCHMARK {
+        tokens = tokenizer->count(text);
+    }
+    QVERIFY(tokens > 0);
+}
+
+QTEST_GUILESS_MAIN(TestBpeTokenizer)
+
+#include "tst_bpetokenizer.moc"
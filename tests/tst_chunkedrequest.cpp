@@ -0,0 +1,228 @@
+#include "chunkedrequest.h"
+
+#include <QTest>
+
+namespace {
+StreamBatch textBatch(const QString &text) {
+    StreamBatch batch;
+    batch.text = text;
+    return batch;
+}
+
+QString textOf(const QList<StreamBatch> &batches) {
+    QString text;
+    for (const StreamBatch &batch : batches)
+        text += batch.text;
+    return text;
+}
+
+QList<ChunkedRequest::Part> makeParts(const QStringList &texts) {
+    QList<ChunkedRequest::Part> parts;
+    for (const QString &text : texts) {
+        ChunkedRequest::Part part;
+        part.text = text;
+        part.cacheKey = "key:" + text.toUtf8();
+        parts.append(part);
+    }
+    return parts;
+}
+}
+
+class TestChunkedRequest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+    void repliesFollowPartOrder();
+    void limitsParallelRequests();
+    void cachedPartsAreNotSent();
+    void everyPartCached();
+    void reducePassCombinesReplies();
+    void failedRepliesAreNotStored();
+    void partStatsTimeEachPart();
+    void sendFailureEndsRun();
+
+private:
+    // User message of every request sent, in order
+    QStringList sent;
+    int nextRequestId = 0;
+
+    ChunkedRequest::SendFunction recordingSend();
+};
+
+void TestChunkedRequest::init() {
+    sent.clear();
+    nextRequestId = 100;
+}
+
+ChunkedRequest::SendFunction TestChunkedRequest::recordingSend() {
+    return [this](const QList<ChatMessage> &messages) {
+        sent.append(messages.last().content);
+        return nextRequestId++;
+    };
+}
+
+void TestChunkedRequest::repliesFollowPartOrder() {
+    ChunkedRequest run(QStringLiteral("prompt"), makeParts({"one", "two", "three"}), false, 0, recordingSend());
+    ChunkedRequest::Progress progress = run.start();
+    QCOMPARE(sent, (QStringList{"one", "two", "three"}));
+    QCOMPARE(progress.currentRequestId, 100);
+    QVERIFY(progress.replay.isEmpty());
+    QVERIFY(!progress.finished);
+
+    // The second part finishes first and waits for its turn
+    QVERIFY(run.addBatch(101, textBatch(QStringLiteral("B"))));
+    QVERIFY(!run.addBatch(100, textBatch(QStringLiteral("A"))));
+    progress = run.finishPart(101);
+    QCOMPARE(progress.currentRequestId, 100);
+    QVERIFY(progress.replay.isEmpty());
+    QCOMPARE(progress.storeKey, QByteArray("key:two"));
+    QCOMPARE(progress.storeReply, QStringLiteral("B"));
+
+    progress = run.finishPart(100);
+    QCOMPARE(progress.currentRequestId, 102);
+    QCOMPARE(textOf(progress.replay), QStringLiteral("\n\nB\n\n"));
+    QCOMPARE(progress.storeReply, QStringLiteral("A"));
+    QVERIFY(!progress.finished);
+    QCOMPARE(run.inFlightRequests(), (QList<int>{102}));
+
+    QVERIFY(!run.addBatch(102, textBatch(QStringLiteral("C"))));
+    progress = run.finishPart(102);
+    QVERIFY(progress.finished);
+    QCOMPARE(progress.currentRequestId, 102);
+    QVERIFY(progress.replay.isEmpty());
+    QVERIFY(run.inFlightRequests().isEmpty());
+}
+
+void TestChunkedRequest::limitsParallelRequests() {
+    ChunkedRequest run(QStringLiteral("prompt"), makeParts({"a", "b", "c", "d"}), false, 2, recordingSend());
+    run.start();
+    QCOMPARE(sent, (QStringList{"a", "b"}));
+    run.finishPart(101);
+    QCOMPARE(sent, (QStringList{"a", "b", "c"}));
+    run.finishPart(100);
+    QCOMPARE(sent, (QStringList{"a", "b", "c", "d"}));
+}
+
+void TestChunkedRequest::cachedPartsAreNotSent() {
+    ChunkedRequest run(QStringLiteral("prompt"), makeParts({"one", "two", "three"}), false, 1, recordingSend());
+    run.setCachedReply(0, QStringLiteral("A"));
+    run.setCachedReply(1, QString());
+    run.setCachedReply(2, QStringLiteral("C"));
+    ChunkedRequest::Progress progress = run.start();
+    QCOMPARE(sent, (QStringList{"two"}));
+    QCOMPARE(progress.currentRequestId, 100);
+    QCOMPARE(textOf(progress.replay), QStringLiteral("A\n\n"));
+
+    QVERIFY(!run.addBatch(100, textBatch(QStringLiteral("B"))));
+    progress = run.finishPart(100);
+    QVERIFY(progress.finished);
+    QCOMPARE(progress.currentRequestId, 100);
+    QCOMPARE(textOf(progress.replay), QStringLiteral("\n\nC"));
+    QCOMPARE(progress.storeKey, QByteArray("key:two"));
+    QCOMPARE(progress.storeReply, QStringLiteral("B"));
+}
+
+void TestChunkedRequest::everyPartCached() {
+    ChunkedRequest run(QStringLiteral("prompt"), makeParts({"one", "two"}), false, 0, recordingSend());
+    run.setCachedReply(0, QStringLiteral("A"));
+    run.setCachedReply(1, QStringLiteral("B"));
+    const ChunkedRequest::Progress progress = run.start();
+    QVERIFY(sent.isEmpty());
+    QVERIFY(progress.finished);
+    QCOMPARE(progress.currentRequestId, 0);
+    QCOMPARE(textOf(progress.replay), QStringLiteral("A\n\nB"));
+    QVERIFY(progress.storeKey.isEmpty());
+}
+
+void TestChunkedRequest::reducePassCombinesReplies() {
+    ChunkedRequest run(QStringLiteral("prompt"), makeParts({"one", "two", "three"}), true, 0, recordingSend());
+    run.setCachedReply(2, QStringLiteral("third"));
+    ChunkedRequest::Progress progress = run.start();
+    QCOMPARE(progress.currentRequestId, 0);
+    QVERIFY(progress.reduceMessages.isEmpty());
+
+    // Every reply is buffered, including the first part's
+    QVERIFY(run.addBatch(100, textBatch(QStringLiteral(" first "))));
+    QVERIFY(run.addBatch(101, textBatch(QStringLiteral("second"))));
+    progress = run.finishPart(101);
+    QVERIFY(progress.reduceMessages.isEmpty());
+    QVERIFY(progress.replay.isEmpty());
+    progress = run.finishPart(100);
+    QCOMPARE(progress.reduceMessages.size(), 2);
+    QCOMPARE(progress.reduceMessages.first().content, QStringLiteral("prompt"));
+    const QString combined = progress.reduceMessages.last().content;
+    QVERIFY(combined.contains(QStringLiteral("3 consecutive parts")));
+    QVERIFY(combined.endsWith(QStringLiteral("first\n\n---\n\nsecond\n\n---\n\nthird")));
+}
+
+void TestChunkedRequest::failedRepliesAreNotStored() {
+    QList<ChunkedRequest::Part> parts = makeParts({"one", "two"});
+    parts[1].cacheKey.clear();
+    ChunkedRequest run(QStringLiteral("prompt"), parts, false, 0, recordingSend());
+    run.start();
+
+    StreamBatch error;
+    error.errorMessage = QStringLiteral("overloaded");
+    run.addBatch(100, textBatch(QStringLiteral("partial")));
+    run.addBatch(100, error);
+    QVERIFY(run.finishPart(100).storeKey.isEmpty());
+
+    // Parts without a cache key are never stored
+    run.addBatch(101, textBatch(QStringLiteral("B")));
+    QVERIFY(run.finishPart(101).storeKey.isEmpty());
+}
+
+void TestChunkedRequest::partStatsTimeEachPart() {
+    ChunkedRequest run(QStringLiteral("prompt"), makeParts({"one", "two", "three"}), false, 0, recordingSend());
+    run.setCachedReply(2, QStringLiteral("C"));
+    run.start();
+
+    // Cached parts were never sent, so they have no timing
+    QVERIFY(run.statsOf(0).elapsedMs < 0);
+    QCOMPARE(run.statsOf(100).firstTokenMs, qint64(-1));
+
+    StreamBatch usage = textBatch(QStringLiteral("B"));
+    usage.hasUsage = true;
+    usage.usage.completionTokens = 42;
+    run.addBatch(101, usage);
+    ChunkedRequest::Progress progress = run.finishPart(101);
+    QVERIFY(progress.partStats.elapsedMs >= 0);
+    QVERIFY(progress.partStats.firstTokenMs >= 0);
+    QCOMPARE(progress.partStats.tokens, 42);
+    QVERIFY(!progress.partStats.failed);
+
+    // An error without any text counts as a failed request
+    StreamBatch error;
+    error.errorMessage = QStringLiteral("overloaded");
+    run.addBatch(100, error);
+    progress = run.finishPart(100);
+    QVERIFY(progress.partStats.failed);
+    QCOMPARE(progress.partStats.firstTokenMs, qint64(-1));
+    QCOMPARE(progress.partStats.tokens, 0);
+}
+
+void TestChunkedRequest::sendFailureEndsRun() {
+    // The client is gone by the time the third part is due
+    int calls = 0;
+    const auto send = [&calls](const QList<ChatMessage> &) { return ++calls < 3 ? 100 + calls : 0; };
+    ChunkedRequest run(QStringLiteral("prompt"), makeParts({"one", "two", "three"}), false, 2, send);
+    ChunkedRequest::Progress progress = run.start();
+    QVERIFY(!progress.sendFailed);
+    QCOMPARE(run.inFlightRequests(), (QList<int>{101, 102}));
+
+    progress = run.finishPart(101);
+    QVERIFY(progress.sendFailed);
+    QVERIFY(!progress.finished);
+    QCOMPARE(run.inFlightRequests(), (QList<int>{102}));
+
+    // A failure on the first batch of sends is reported by start()
+    ChunkedRequest none(QStringLiteral("prompt"), makeParts({"one"}), false, 0,
+                        [](const QList<ChatMessage> &) { return 0; });
+    QVERIFY(none.start().sendFailed);
+    QVERIFY(none.inFlightRequests().isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestChunkedRequest)
+
+#include "tst_chunkedrequest.moc"
@@ -0,0 +1,196 @@
+#include "textsink.h"
+
+#include <QStringList>
+#include <QTest>
+
+namespace {
+// Keeps every chunk it is handed; refuses writes once closed, like a target
+// window that lost focus
+class RecordingTextSink : public TextSink {
+public:
+    QStringList chunks;
+    bool open = true;
+    int refused = 0;
+
+    bool write(const QString &text) override {
+        if (!open) {
+            ++refused;
+            return false;
+        }
+        chunks.append(text);
+        return true;
+    }
+};
+
+QStringList splitEvery(const QString &text, int size) {
+    QStringList parts;
+    for (qsizetype i = 0; i < text.size(); i += size)
+        parts.append(text.mid(i, size));
+    return parts;
+}
+}
+
+class TestChunkedTextWriter : public QObject {
+    Q_OBJECT
+
+private slots:
+    void holdsTextUntilBoundary();
+    void breaksAtLines();
+    void breaksAtSentences_data();
+    void breaksAtSentences();
+    void punctuationWithoutSpaceIsNoBoundary();
+    void longRunsSplitAfterSpace();
+    void longRunsWithoutSpaces();
+    void preservesOrderAcrossStreamSizes_data();
+    void preservesOrderAcrossStreamSizes();
+    void flushWritesTail();
+    void discardDropsTail();
+    void stopsWhenSinkRefuses();
+};
+
+void TestChunkedTextWriter::holdsTextUntilBoundary() {
+    RecordingTextSink sink;
+    ChunkedTextWriter writer(&sink);
+    writer.append(QStringLiteral("Hello"));
+    writer.append(QStringLiteral(" wor"));
+    QVERIFY(sink.chunks.isEmpty());
+    QCOMPARE(writer.writtenChars(), 0);
+}
+
+void TestChunkedTextWriter::breaksAtLines() {
+    RecordingTextSink sink;
+    ChunkedTextWriter writer(&sink);
+    writer.append(QStringLiteral("first line\nsecond"));
+    QCOMPARE(sink.chunks, (QStringList{QStringLiteral("first line\n")}));
+    QCOMPARE(writer.writtenChars(), 11);
+
+    // Everything up to the last boundary goes out in one chunk
+    writer.append(QStringLiteral(" line\nthird\nfou"));
+    QCOMPARE(sink.chunks.last(), QStringLiteral("second line\nthird\n"));
+}
+
+void TestChunkedTextWriter::breaksAtSentences_data() {
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QString>("chunk");
+    QTest::newRow("period") << QStringLiteral("One. Two") << QStringLiteral("One. ");
+    QTest::newRow("question") << QStringLiteral("Why? Because") << QStringLiteral("Why? ");
+    QTest::newRow("exclamation") << QStringLiteral("Go! Now") << QStringLiteral("Go! ");
+    QTest::newRow("semicolon") << QStringLiteral("a; b") << QStringLiteral("a; ");
+    QTest::newRow("colon") << QStringLiteral("Note: text") << QStringLiteral("Note: ");
+    QTest::newRow("tab after period") << QStringLiteral("End.\tNext") << QStringLiteral("End.\t");
+    QTest::newRow("last boundary wins") << QStringLiteral("A. B. C") << QStringLiteral("A. B. ");
+}
+
+void TestChunkedTextWriter::breaksAtSentences() {
+    QFETCH(QString, text);
+    QFETCH(QString, chunk);
+    RecordingTextSink sink;
+    ChunkedTextWriter writer(&sink);
+    writer.append(text);
+    QCOMPARE(sink.chunks, QStringList{chunk});
+}
+
+void TestChunkedTextWriter::punctuationWithoutSpaceIsNoBoundary() {
+    RecordingTextSink sink;
+    ChunkedTextWriter writer(&sink);
+    // Decimals, URLs and a period at the very end of the buffer
+    writer.append(QStringLiteral("Pi is 3.14 see example.com/a:b end."));
+    QVERIFY(sink.chunks.isEmpty());
+    // The space that arrives later completes the sentence
+    writer.append(QStringLiteral(" Next"));
+    QCOMPARE(sink.chunks, (QStringList{QStringLiteral("Pi is 3.14 see example.com/a:b end. ")}));
+}
+
+void TestChunkedTextWriter::longRunsSplitAfterSpace() {
+    RecordingTextSink sink;
+    ChunkedTextWriter writer(&sink);
+    QString text;
+    while (text.size() < 130)
+        text += QStringLiteral("word ");
+    text += QStringLiteral("tail");
+    writer.append(text);
+    QCOMPARE(sink.chunks.size(), 1);
+    QVERIFY(sink.chunks.first().endsWith(u' '));
+    // Words are not broken across chunks
+    writer.flush();
+    QCOMPARE(sink.chunks.last(), QStringLiteral("tail"));
+}
+
+void TestChunkedTextWriter::longRunsWithoutSpaces() {
+    RecordingTextSink sink;
+    ChunkedTextWriter writer(&sink);
+    const QString run(119, u'x');
+    writer.append(run);
+    QVERIFY(sink.chunks.isEmpty());
+    writer.append(QStringLiteral("y"));
+    QCOMPARE(sink.chunks, QStringList{run + u'y'});
+}
+
+void TestChunkedTextWriter::preservesOrderAcrossStreamSizes_data() {
+    QTest::addColumn<int>("deltaSize");
+    for (int size : {1, 2, 3, 7, 16, 64, 1000})
+        QTest::addRow("%d", size) << size;
+}
+
+void TestChunkedTextWriter::preservesOrderAcrossStreamSizes() {
+    QFETCH(int, deltaSize);
+    QString text = QStringLiteral("# Title\n\nFirst sentence. Second one? Yes! Items:\n- one\n- two\n");
+    for (int i = 0; i < 40; ++i)
+        text += QStringLiteral("averyveryverylongword%1 ").arg(i);
+    text += QStringLiteral("\nDone.");
+
+    RecordingTextSink sink;
+    ChunkedTextWriter writer(&sink);
+    for (const QString &delta : splitEvery(text, deltaSize))
+        writer.append(delta);
+    writer.flush();
+
+    QCOMPARE(sink.chunks.join(QString()), text);
+    QCOMPARE(writer.writtenChars(), text.size());
+    for (const QString &chunk : sink.chunks)
+        QVERIFY(!chunk.isEmpty());
+}
+
+void TestChunkedTextWriter::flushWritesTail() {
+    RecordingTextSink sink;
+    ChunkedTextWriter writer(&sink);
+    writer.append(QStringLiteral("no boundary"));
+    writer.flush();
+    QCOMPARE(sink.chunks, QStringList{QStringLiteral("no boundary")});
+    writer.flush();
+    QCOMPARE(sink.chunks.size(), 1);
+}
+
+void TestChunkedTextWriter::discardDropsTail() {
+    RecordingTextSink sink;
+    ChunkedTextWriter writer(&sink);
+    writer.append(QStringLiteral("Typed. Half a sen"));
+    QCOMPARE(sink.chunks, QStringList{QStringLiteral("Typed. ")});
+    writer.discard();
+    writer.flush();
+    QCOMPARE(sink.chunks, QStringList{QStringLiteral("Typed. ")});
+    QCOMPARE(writer.writtenChars(), 7);
+}
+
+void TestChunkedTextWriter::stopsWhenSinkRefuses() {
+    RecordingTextSink sink;
+    ChunkedTextWriter writer(&sink);
+    writer.append(QStringLiteral("Kept. "));
+    QVERIFY(!writer.isStopped());
+
+    sink.open = false;
+    writer.append(QStringLiteral("Refused. "));
+    QVERIFY(writer.isStopped());
+    QCOMPARE(sink.refused, 1);
+
+    // Nothing reaches the sink again, even if it would accept it
+    sink.open = true;
+    writer.append(QStringLiteral("Later. "));
+    writer.flush();
+    QCOMPARE(sink.chunks, QStringList{QStringLiteral("Kept. ")});
+    QCOMPARE(writer.writtenChars(), 6);
+}
+
+QTEST_GUILESS_MAIN(TestChunkedTextWriter)
+
+#include "tst_chunkedtextwriter.moc"
@@ -0,0 +1,165 @@
+#include "codelexer.h"
+
+#include <QRegularExpression>
+#include <QStringList>
+#include <QTest>
+
+namespace {
+// The regex highlighter CodeLexer replaced, kept here only as the baseline
+// for the benchmark. Later passes overwrite earlier ones, as setFormat did.
+class RegexHighlighter {
+public:
+    RegexHighlighter()
+        : keywordPattern("\\b(auto|bool|break|case|catch|class|const|continue|def|default|"
+                         "delete|do|else|enum|export|extends|false|final|finally|for|"
+                         "foreach|from|function|if|implements|import|inline|interface|"
+                         "lambda|let|namespace|new|nullptr|null|operator|private|protected|"
+                         "public|return|static|struct|switch|template|this|throw|true|try|"
+                         "typedef|typename|using|var|virtual|void|volatile|while)\\b")
+        , stringPatterns{QRegularExpression(R"("([^"\\]|\\.)*")"), QRegularExpression(R"('([^'\\]|\\.)*')")}
+        , numberPattern("\\b\\d+(?:\\.\\d+)?\\b")
+        , commentPatterns{QRegularExpression("//[^\\n]*"), QRegularExpression("#[^\\n]*")}
+        , blockStart("/\\*")
+        , blockEnd("\\*/") {}
+
+    int highlight(const QString &text, int previousState, QList<CodeToken> *tokens) const {
+        tokens->clear();
+        int state = 0;
+        addMatches(keywordPattern, text, CodeTokenKind::Keyword, tokens);
+        for (const QRegularExpression &pattern : stringPatterns)
+            addMatches(pattern, text, CodeTokenKind::String, tokens);
+        addMatches(numberPattern, text, CodeTokenKind::Number, tokens);
+        for (const QRegularExpression &pattern : commentPatterns)
+            addMatches(pattern, text, CodeTokenKind::Comment, tokens);
+
+        qsizetype startIndex = 0;
+        if (previousState != 1) {
+            const QRegularExpressionMatch match = blockStart.match(text);
+            startIndex = match.hasMatch() ? match.capturedStart() : -1;
+        }
+        while (startIndex >= 0) {
+            const QRegularExpressionMatch endMatch = blockEnd.match(text, startIndex);
+            qsizetype commentLength = 0;
+            if (endMatch.hasMatch()) {
+                commentLength = endMatch.capturedEnd() - startIndex;
+            } else {
+                state = 1;
+                commentLength = text.length() - startIndex;
+            }
+            tokens->append({static_cast<int>(startIndex), static_cast<int>(commentLength), CodeTokenKind::Comment});
+            const QRegularExpressionMatch nextStart = blockStart.match(text, startIndex + commentLength);
+            startIndex = nextStart.hasMatch() ? nextStart.capturedStart() : -1;
+        }
+        return state;
+    }
+
+private:
+    QRegularExpression keywordPattern;
+    QList<QRegularExpression> stringPatterns;
+    QRegularExpression numberPattern;
+    QList<QRegularExpression> commentPatterns;
+    QRegularExpression blockStart;
+    QRegularExpression blockEnd;
+
+    static void addMatches(const QRegularExpression &pattern, const QString &text, CodeTokenKind kind,
+                           QList<CodeToken> *tokens) {
+        auto it = pattern.globalMatch(text);
+        while (it.hasNext()) {
+            const QRegularExpressionMatch match = it.next();
+            tokens->append({static_cast<int>(match.capturedStart()), static_cast<int>(match.capturedLength()), kind});
+        }
+    }
+};
+
+// A large code block in the shape models usually answer with
+QStringList codeBlock(int lines) {
+    const QStringList pattern{
+        QStringLiteral("/* Computes the running total."),
+        QStringLiteral("   Values below zero are skipped. */"),
+        QStringLiteral("static int accumulate(const std::vector<int> &values, int limit) {"),
+        QStringLiteral("    int total = 0; // running sum"),
+        QStringLiteral("    for (auto value : values) {"),
+        QStringLiteral("        if (value < 0 || value > 1000.5)"),
+        QStringLiteral("            continue;"),
+        QStringLiteral("        total += value * 42;"),
+        QStringLiteral("    }"),
+        QStringLiteral("    const char *label = \"total \\\"escaped\\\" text\";"),
+        QStringLiteral("    return total > limit ? limit : total;"),
+        QStringLiteral("}")
+    };
+    QStringList code;
+    while (code.size() < lines)
+        code += pattern;
+    return code;
+}
+
+QList<CodeTokenKind> kindsOf(const QList<CodeToken> &tokens) {
+    QList<CodeTokenKind> kinds;
+    for (const CodeToken &token : tokens)
+        kinds.append(token.kind);
+    return kinds;
+}
+}
+
+class TestCodeLexer : public QObject {
+    Q_OBJECT
+
+private slots:
+    void tokenKinds();
+    void blockCommentSpansLines();
+    void benchmarkLargeBlock_data();
+    void benchmarkLargeBlock();
+};
+
+void TestCodeLexer::tokenKinds() {
+    QList<CodeToken> tokens;
+    const CodeLanguage &cpp = CodeLexer::languageFor(QStringLiteral("cpp"));
+    const int state = CodeLexer::tokenize(u"return \"a\\\"b\" + 12; // done", CodeLexer::NormalState, cpp, &tokens);
+    QCOMPARE(state, static_cast<int>(CodeLexer::NormalState));
+    QCOMPARE(kindsOf(tokens), (QList<CodeTokenKind>{CodeTokenKind::Keyword, CodeTokenKind::String,
+                                                    CodeTokenKind::Number, CodeTokenKind::Comment}));
+    QCOMPARE(tokens.at(1).start, 7);
+    QCOMPARE(tokens.at(1).length, 6);
+}
+
+void TestCodeLexer::blockCommentSpansLines() {
+    QList<CodeToken> tokens;
+    const CodeLanguage &language = CodeLexer::languageFor(QString());
+    int state = CodeLexer::tokenize(u"int x; /* open", CodeLexer::NormalState, language, &tokens);
+    QCOMPARE(state, static_cast<int>(CodeLexer::BlockCommentState));
+    state = CodeLexer::tokenize(u"still comment", state, language, &tokens);
+    QCOMPARE(state, static_cast<int>(CodeLexer::BlockCommentState));
+    QCOMPARE(kindsOf(tokens), (QList<CodeTokenKind>{CodeTokenKind::Comment}));
+    state = CodeLexer::tokenize(u"end */ return", state, language, &tokens);
+    QCOMPARE(state, static_cast<int>(CodeLexer::NormalState));
+    QCOMPARE(kindsOf(tokens), (QList<CodeTokenKind>{CodeTokenKind::Comment, CodeTokenKind::Keyword}));
+}
+
+void TestCodeLexer::benchmarkLargeBlock_data() {
+    QTest::addColumn<bool>("regex");
+    QTest::newRow("CodeLexer") << false;
+    QTest::newRow("regex highlighter") << true;
+}
+
+void TestCodeLexer::benchmarkLargeBlock() {
+    QFETCH(bool, regex);
+    const QStringList code = codeBlock(5000);
+    const CodeLanguage &language = CodeLexer::languageFor(QString());
+    const RegexHighlighter highlighter;
+    QList<CodeToken> tokens;
+    int tokenCount = 0;
+    QBENCHMARK {
+        int state = 0;
+        tokenCount = 0;
+        for (const QString &line : code) {
+            state = regex ? highlighter.highlight(line, state, &tokens)
+                          : CodeLexer::tokenize(line, state, language, &tokens);
+            tokenCount += static_cast<int>(tokens.size());
+        }
+    }
+    QVERIFY(tokenCount > code.size());
+}
+
+QTEST_GUILESS_MAIN(TestCodeLexer)
+
+#include "tst_codelexer.moc"
@@ -0,0 +1,104 @@
+#include "configmodel.h"
+
+#include <QSignalSpy>
+#include <QTest>
+
+namespace {
+constexpr int kTasks = 200;
+constexpr int kPromptChars = 20000;
+
+AppConfig largeConfig() {
+    AppConfig config;
+    const QString paragraph = QStringLiteral("Rewrite the selection in a clear, friendly tone and keep its meaning. ");
+    for (int i = 0; i < kTasks; ++i) {
+        TaskDefinition task;
+        task.id = QStringLiteral("task-%1").arg(i);
+        task.name = QStringLiteral("Task %1").arg(i);
+        while (task.prompt.size() < kPromptChars)
+            task.prompt += paragraph;
+        task.prompt += QString::number(i);
+        task.compareModels = {QStringLiteral("model-a"), QStringLiteral("model-b")};
+        config.tasks.append(task);
+    }
+    return config;
+}
+}
+
+class TestConfigModel : public QObject {
+    Q_OBJECT
+
+private slots:
+    void editsEmitChanged();
+    void indexOfTask();
+    void snapshotIsIndependent();
+    void benchmarkLargeConfig_data();
+    void benchmarkLargeConfig();
+};
+
+void TestConfigModel::editsEmitChanged() {
+    ConfigModel model;
+    QSignalSpy spy(&model, &ConfigModel::changed);
+    model.reset(largeConfig());
+    TaskDefinition task = model.task(3);
+    task.name = QStringLiteral("Renamed");
+    model.setTask(3, task);
+    model.setTask(kTasks, task);
+    model.removeTask(0);
+    QCOMPARE(spy.count(), 3);
+    QCOMPARE(model.taskCount(), kTasks - 1);
+    QCOMPARE(model.task(2).name, QStringLiteral("Renamed"));
+}
+
+void TestConfigModel::indexOfTask() {
+    ConfigModel model;
+    model.reset(largeConfig());
+    QCOMPARE(model.indexOfTask(QStringLiteral("task-150")), 150);
+    QCOMPARE(model.indexOfTask(QStringLiteral("missing")), -1);
+    QCOMPARE(model.indexOfTask(QString()), -1);
+}
+
+void TestConfigModel::snapshotIsIndependent() {
+    ConfigModel model;
+    model.reset(largeConfig());
+    const AppConfig before = model.snapshot();
+    TaskDefinition task = model.task(0);
+    task.prompt = QStringLiteral("short");
+    model.setTask(0, task);
+    QCOMPARE(before.tasks.at(0).prompt.size(), largeConfig().tasks.at(0).prompt.size());
+    QCOMPARE(model.snapshot().tasks.at(0).prompt, QStringLiteral("short"));
+}
+
+void TestConfigModel::benchmarkLargeConfig_data() {
+    QTest::addColumn<bool>("edit");
+    QTest::addColumn<bool>("snapshot");
+    QTest::newRow("edit") << true << false;
+    QTest::newRow("snapshot") << false << true;
+    QTest::newRow("edit and snapshot") << true << true;
+}
+
+void TestConfigModel::benchmarkLargeConfig() {
+    QFETCH(bool, edit);
+    QFETCH(bool, snapshot);
+    ConfigModel model;
+    model.reset(largeConfig());
+    // One keystroke in a prompt field of every task, as the settings window
+    // pushes it, optionally followed by a reader taking a snapshot
+    int edits = 0;
+    qsizetype promptChars = 0;
+    QBENCHMARK {
+        for (int i = 0; i < kTasks; ++i) {
+            if (edit) {
+                TaskDefinition task = model.task(i);
+                task.prompt += QLatin1Char(static_cast<char>('a' + edits++ % 26));
+                model.setTask(i, task);
+            }
+            if (snapshot)
+                promptChars += model.snapshot().tasks.at(i).prompt.size();
+        }
+    }
+    QVERIFY(!snapshot || promptChars > 0);
+}
+
+QTEST_GUILESS_MAIN(TestConfigModel)
+
+#include "tst_configmodel.moc"
@@ -0,0 +1,119 @@
+#include "configpersistence.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+class TestConfigPersistence : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+    void burstOfEditsIsOneWrite();
+    void separateBurstsAreSeparateWrites();
+    void flushWritesPendingEdits();
+    void flushWithoutEditsDoesNotWrite();
+
+private:
+    QTemporaryDir directory;
+    AppConfig config;
+    int snapshots = 0;
+
+    QString configPath() const;
+    ConfigPersistence::SnapshotProvider snapshotProvider();
+    AppConfig savedConfig() const;
+};
+
+void TestConfigPersistence::init() {
+    QVERIFY(directory.isValid());
+    QFile::remove(configPath());
+    config = ConfigStore::defaultConfig();
+    snapshots = 0;
+}
+
+QString TestConfigPersistence::configPath() const {
+    return directory.filePath(QStringLiteral("config.json"));
+}
+
+ConfigPersistence::SnapshotProvider TestConfigPersistence::snapshotProvider() {
+    return [this]() {
+        ++snapshots;
+        return config;
+    };
+}
+
+AppConfig TestConfigPersistence::savedConfig() const {
+    AppConfig saved;
+    if (!ConfigStore::loadFromFile(configPath(), &saved))
+        return AppConfig();
+    return saved;
+}
+
+void TestConfigPersistence::burstOfEditsIsOneWrite() {
+    ConfigPersistence persistence(configPath(), snapshotProvider());
+    // Typing an endpoint one keystroke at a time
+    const QString endpoint = QStringLiteral("https://example.invalid/v1/chat/completions");
+    for (int i = 1; i <= endpoint.size(); ++i) {
+        config.settings.apiEndpoint = endpoint.left(i);
+        persistence.markDirty();
+    }
+    QVERIFY(persistence.isDirty());
+    QCOMPARE(persistence.writeCount(), 0);
+
+    QTRY_COMPARE_WITH_TIMEOUT(persistence.writeCount(), 1, 5000);
+    QVERIFY(!persistence.isDirty());
+    QCOMPARE(snapshots, 1);
+
+    // Nothing else is queued behind the coalesced write
+    QTest::qWait(1000);
+    persistence.flush();
+    QCOMPARE(persistence.writeCount(), 1);
+    QCOMPARE(savedConfig().settings.apiEndpoint, endpoint);
+}
+
+void TestConfigPersistence::separateBurstsAreSeparateWrites() {
+    ConfigPersistence persistence(configPath(), snapshotProvider());
+    for (int i = 0; i < 20; ++i) {
+        config.settings.maxChars = i;
+        persistence.markDirty();
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(persistence.writeCount(), 1, 5000);
+
+    for (int i = 0; i < 20; ++i) {
+        config.settings.maxChars = 100 + i;
+        persistence.markDirty();
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(persistence.writeCount(), 2, 5000);
+    QCOMPARE(snapshots, 2);
+    QCOMPARE(savedConfig().settings.maxChars, 119);
+}
+
+void TestConfigPersistence::flushWritesPendingEdits() {
+    ConfigPersistence persistence(configPath(), snapshotProvider());
+    config.settings.hotkey = QStringLiteral("Ctrl+Alt+Q");
+    persistence.markDirty();
+    persistence.markDirty();
+    persistence.flush();
+
+    // flush() waits for the write, so the file is complete right away
+    QVERIFY(!persistence.isDirty());
+    QCOMPARE(persistence.writeCount(), 1);
+    QCOMPARE(savedConfig().settings.hotkey, QStringLiteral("Ctrl+Alt+Q"));
+
+    // The quiet timer was stopped, so no second write follows
+    QTest::qWait(1000);
+    QCOMPARE(persistence.writeCount(), 1);
+    QCOMPARE(snapshots, 1);
+}
+
+void TestConfigPersistence::flushWithoutEditsDoesNotWrite() {
+    ConfigPersistence persistence(configPath(), snapshotProvider());
+    persistence.flush();
+    QCOMPARE(persistence.writeCount(), 0);
+    QCOMPARE(snapshots, 0);
+    QVERIFY(!QFile::exists(configPath()));
+}
+
+QTEST_GUILESS_MAIN(TestConfigPersistence)
+
+#include "tst_configpersistence.moc"
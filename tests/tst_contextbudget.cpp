@@ -0,0 +1,160 @@
+#include "contextbudget.h"
+
+#include <QTest>
+
+namespace {
+ChatMessage message(const QString &role, QChar fill, int length) {
+    return ChatMessage{role, QString(length, fill)};
+}
+
+int sumOfEstimates(const QList<ChatMessage> &messages) {
+    int total = 0;
+    for (const ChatMessage &entry : messages)
+        total += ContextBudget::estimateMessageTokens(entry);
+    return total;
+}
+
+QStringList contentsOf(const QList<ChatMessage> &messages) {
+    QStringList contents;
+    for (const ChatMessage &entry : messages)
+        contents.append(entry.content);
+    return contents;
+}
+
+// System prompt and selection of 14 estimated tokens each (40 bytes plus
+// the per-message overhead), then follow-up turns.
+QList<ChatMessage> conversation() {
+    return {
+        message(QStringLiteral("system"), u'S', 40),
+        message(QStringLiteral("user"), u'U', 40),
+        message(QStringLiteral("assistant"), u'A', 400),
+        message(QStringLiteral("user"), u'u', 40),
+        message(QStringLiteral("assistant"), u'B', 40),
+        message(QStringLiteral("user"), u'v', 40)
+    };
+}
+}
+
+class TestContextBudget : public QObject {
+    Q_OBJECT
+
+private slots:
+    void estimateTokens_data();
+    void estimateTokens();
+    void truncateKeepsSurrogatePairs();
+    void cachedEstimateIsUsed();
+    void noLimit();
+    void underBudget();
+    void dropsOldestTurns();
+    void elidesOldestReply();
+    void pinnedMessagesAreNeverTrimmed();
+    void newestMessageIsAlwaysSent();
+};
+
+void TestContextBudget::estimateTokens_data() {
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<int>("tokens");
+    QTest::newRow("empty") << QString() << 0;
+    QTest::newRow("ascii") << QStringLiteral("abcdefgh") << 2;
+    QTest::newRow("rounds up") << QStringLiteral("abcde") << 2;
+    QTest::newRow("two byte") << QString(4, QChar(0x00E9)) << 2;
+    QTest::newRow("three byte") << QString(4, QChar(0x20AC)) << 3;
+    QTest::newRow("surrogate pair") << QString::fromUcs4(U"\U0001F600\U0001F600", 2) << 2;
+}
+
+void TestContextBudget::estimateTokens() {
+    QFETCH(QString, text);
+    QFETCH(int, tokens);
+    QCOMPARE(ContextBudget::estimateTokens(text), tokens);
+}
+
+void TestContextBudget::truncateKeepsSurrogatePairs() {
+    const QString emoji = QString::fromUcs4(U"\U0001F600", 1);
+    // Seven ASCII bytes leave one byte of a two-token budget for the emoji
+    const QString text = QStringLiteral("abcdefg") + emoji;
+    QCOMPARE(ContextBudget::truncateToEstimate(text, 2), QStringLiteral("abcdefg"));
+    QCOMPARE(ContextBudget::truncateToEstimate(text, 3), text);
+    QCOMPARE(ContextBudget::truncateToEstimate(text, 0), text);
+}
+
+void TestContextBudget::cachedEstimateIsUsed() {
+    ChatMessage cached{QStringLiteral("user"), QStringLiteral("short")};
+    cached.estimatedTokens = 500;
+    QCOMPARE(ContextBudget::estimateMessageTokens(cached), 500);
+    cached.estimatedTokens = 0;
+    QCOMPARE(ContextBudget::estimateMessageTokens(cached), ContextBudget::estimateTokens(cached.content) + 4);
+}
+
+void TestContextBudget::noLimit() {
+    const QList<ChatMessage> history = conversation();
+    const ContextBudgetResult result = ContextBudget::fit(history, 0);
+    QCOMPARE(contentsOf(result.messages), contentsOf(history));
+    QCOMPARE(result.estimatedTokens, 174);
+    QCOMPARE(result.droppedMessages, 0);
+    QVERIFY(!result.elided);
+}
+
+void TestContextBudget::underBudget() {
+    const QList<ChatMessage> history = conversation();
+    const ContextBudgetResult result = ContextBudget::fit(history, 174);
+    QCOMPARE(contentsOf(result.messages), contentsOf(history));
+    QCOMPARE(result.droppedMessages, 0);
+    QVERIFY(!result.elided);
+}
+
+void TestContextBudget::dropsOldestTurns() {
+    const QList<ChatMessage> history = conversation();
+    const ContextBudgetResult result = ContextBudget::fit(history, 100);
+    QCOMPARE(result.droppedMessages, 2);
+    QVERIFY(!result.elided);
+    QCOMPARE(contentsOf(result.messages),
+             (QStringList{history.at(0).content, history.at(1).content,
+                          history.at(4).content, history.at(5).content}));
+    QCOMPARE(result.estimatedTokens, 56);
+    QCOMPARE(result.estimatedTokens, sumOfEstimates(result.messages));
+
+    // Roles keep alternating after the pinned selection
+    QCOMPARE(result.messages.at(2).role, QStringLiteral("assistant"));
+    QCOMPARE(result.messages.at(3).role, QStringLiteral("user"));
+}
+
+void TestContextBudget::elidesOldestReply() {
+    QList<ChatMessage> history = conversation();
+    history.resize(4);
+    const ContextBudgetResult result = ContextBudget::fit(history, 100);
+    QCOMPARE(result.droppedMessages, 0);
+    QVERIFY(result.elided);
+    QCOMPARE(result.messages.size(), 4);
+
+    const QString elided = result.messages.at(2).content;
+    QVERIFY(elided.size() < history.at(2).content.size());
+    QVERIFY(elided.contains(QStringLiteral("[...]")));
+    QVERIFY(elided.startsWith(QStringLiteral("AAAA")));
+    QVERIFY(elided.endsWith(QStringLiteral("AAAA")));
+    QCOMPARE(result.estimatedTokens, sumOfEstimates(result.messages));
+    QVERIFY(result.estimatedTokens < sumOfEstimates(history));
+}
+
+void TestContextBudget::pinnedMessagesAreNeverTrimmed() {
+    QList<ChatMessage> history = conversation();
+    history.resize(2);
+    const ContextBudgetResult result = ContextBudget::fit(history, 1);
+    QCOMPARE(contentsOf(result.messages), contentsOf(history));
+    QCOMPARE(result.droppedMessages, 0);
+    QVERIFY(!result.elided);
+}
+
+void TestContextBudget::newestMessageIsAlwaysSent() {
+    QList<ChatMessage> history = conversation();
+    history.append(message(QStringLiteral("assistant"), u'C', 40));
+    history.append(message(QStringLiteral("user"), u'w', 4000));
+    const ContextBudgetResult result = ContextBudget::fit(history, 50);
+    QVERIFY(result.droppedMessages > 0);
+    QCOMPARE(result.messages.last().content, history.last().content);
+    QCOMPARE(result.messages.at(0).content, history.at(0).content);
+    QCOMPARE(result.messages.at(1).content, history.at(1).content);
+}
+
+QTEST_GUILESS_MAIN(TestContextBudget)
+
+#include "tst_contextbudget.moc"
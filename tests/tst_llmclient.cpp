@@ -0,0 +1,193 @@
+#include "llmclient.h"
+#include "transcriptstore.h"
+
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QNetworkReply>
+#include <QPointer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTest>
+#include <QTimer>
+
+#include <memory>
+#include <utility>
+
+namespace {
+constexpr int kDeltas = 2000;
+// Events written per tick, so the client sees many small reads like a
+// real server's token stream
+constexpr int kDeltasPerWrite = 4;
+
+QByteArray deltaEvent(int index) {
+    return "data: {\"choices\":[{\"index\":0,\"delta\":{\"content\":\"tok" + QByteArray::number(index)
+        + " \"},\"finish_reason\":null}]}\n\n";
+}
+
+QString expectedText() {
+    QString text;
+    for (int i = 0; i < kDeltas; ++i)
+        text += QStringLiteral("tok%1 ").arg(i);
+    return text;
+}
+
+// Answers every POST with a chat completion stream and closes the connection
+void serveStream(QTcpSocket *socket) {
+    auto request = std::make_shared<QByteArray>();
+    QObject::connect(socket, &QTcpSocket::readyRead, socket, [socket, request]() {
+        *request += socket->readAll();
+        const qsizetype headerEnd = request->indexOf("\r\n\r\n");
+        if (headerEnd < 0 || socket->property("answered").toBool())
+            return;
+        qsizetype contentLength = 0;
+        for (const QByteArray &line : request->left(headerEnd).split('\n')) {
+            if (line.toLower().startsWith("content-length:"))
+                contentLength = line.mid(15).trimmed().toLongLong();
+        }
+        if (request->size() < headerEnd + 4 + contentLength)
+            return;
+        socket->setProperty("answered", true);
+        socket->write("HTTP/1.1 200 OK\r\n"
+                      "Content-Type: text/event-stream\r\n"
+                      "Cache-Control: no-cache\r\n"
+                      "Connection: close\r\n\r\n");
+
+        auto *timer = new QTimer(socket);
+        auto next = std::make_shared<int>(0);
+        QObject::connect(timer, &QTimer::timeout, socket, [socket, timer, next]() {
+            QByteArray chunk;
+            for (int i = 0; i < kDeltasPerWrite && *next < kDeltas; ++i)
+                chunk += deltaEvent((*next)++);
+            if (*next >= kDeltas) {
+                chunk += "data: {\"choices\":[{\"index\":0,\"delta\":{},\"finish_reason\":\"stop\"}]}\n\n"
+                         "data: [DONE]\n\n";
+                timer->stop();
+                socket->write(chunk);
+                socket->disconnectFromHost();
+                return;
+            }
+            socket->write(chunk);
+        });
+        timer->start(0);
+    });
+}
+
+// What TaskWindow does with a batch on the GUI thread before the next render
+struct GuiSideHandler {
+    TranscriptStore transcript;
+    QString finishReason;
+    QString errorMessage;
+    bool hasUsage = false;
+    TokenUsage usage;
+
+    void handle(const StreamBatch &batch) {
+        if (!batch.finishReason.isEmpty())
+            finishReason = batch.finishReason;
+        if (!batch.errorMessage.isEmpty())
+            errorMessage = batch.errorMessage;
+        if (batch.hasUsage) {
+            hasUsage = true;
+            usage = batch.usage;
+        }
+        if (!batch.text.isEmpty())
+            transcript.appendPending(batch.text);
+    }
+};
+}
+
+class TestLlmClient : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void streamsFromStubServer();
+    void benchmarkBatchHandling();
+
+private:
+    QTcpServer server;
+    QList<StreamBatch> batches;
+    qint64 handlerNs = 0;
+    int finishedError = -1;
+    int finishedStatus = 0;
+
+    void runRequest();
+};
+
+void TestLlmClient::initTestCase() {
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+    connect(&server, &QTcpServer::newConnection, this, [this]() {
+        while (QTcpSocket *socket = server.nextPendingConnection()) {
+            connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            serveStream(socket);
+        }
+    });
+}
+
+void TestLlmClient::runRequest() {
+    batches.clear();
+    handlerNs = 0;
+    finishedError = -1;
+    finishedStatus = 0;
+
+    LlmClient client;
+    GuiSideHandler handler;
+    int requestId = 0;
+    bool done = false;
+    connect(&client, &LlmClient::streamBatchReady, this, [&](int id, const StreamBatch &batch) {
+        if (id != requestId)
+            return;
+        QElapsedTimer clock;
+        clock.start();
+        handler.handle(batch);
+        handlerNs += clock.nsecsElapsed();
+        batches.append(batch);
+    });
+    connect(&client, &LlmClient::finished, this, [&](int id, int error, const QString &, int statusCode) {
+        if (id != requestId)
+            return;
+        finishedError = error;
+        finishedStatus = statusCode;
+        done = true;
+    });
+
+    const QUrl url(QStringLiteral("http://127.0.0.1:%1/v1/chat/completions").arg(server.serverPort()));
+    requestId = client.startRequest(url, "Bearer test", "{\"stream\":true}", QString());
+    QTRY_VERIFY_WITH_TIMEOUT(done, 30000);
+    QCOMPARE(handler.transcript.pending(), expectedText());
+    QCOMPARE(handler.finishReason, QStringLiteral("stop"));
+}
+
+void TestLlmClient::streamsFromStubServer() {
+    runRequest();
+    if (QTest::currentTestFailed())
+        return;
+    QCOMPARE(finishedError, static_cast<int>(QNetworkReply::NoError));
+    QCOMPARE(finishedStatus, 200);
+    // The worker parses on its own thread; the GUI side only sees whole batches
+    QVERIFY(!batches.isEmpty());
+    QVERIFY(batches.size() <= kDeltas + 1);
+    for (const StreamBatch &batch : std::as_const(batches))
+        QVERIFY(batch.streamFormat);
+}
+
+void TestLlmClient::benchmarkBatchHandling() {
+    runRequest();
+    if (QTest::currentTestFailed())
+        return;
+    qInfo("GUI thread: %d batches, %.1f ns per token while streaming",
+          static_cast<int>(batches.size()), static_cast<double>(handlerNs) / kDeltas);
+
+    // The same batches again without the network, for a stable number
+    int tokens = 0;
+    QBENCHMARK {
+        GuiSideHandler handler;
+        for (const StreamBatch &batch : std::as_const(batches))
+            handler.handle(batch);
+        tokens = static_cast<int>(handler.transcript.pending().size());
+    }
+    QCOMPARE(tokens, static_cast<int>(expectedText().size()));
+}
+
+QTEST_GUILESS_MAIN(TestLlmClient)
+
+#include "tst_llmclient.moc"
@@ -0,0 +1,197 @@
+#include "selectioncapture.h"
+
+#include <QTest>
+#include <QTimer>
+
+namespace {
+// Scripted clipboard: every copy request answers with the next reply after
+// its delay, or never when the script is empty.
+class FakeClipboardSource : public ClipboardSource {
+public:
+    struct Reply {
+        int delayMs = 0;
+        QString text;
+        bool notify = true;
+    };
+
+    QList<Reply> replies;
+    int copyRequests = 0;
+
+    quint64 sequenceNumber() const override { return sequence; }
+    QString text() const override { return content; }
+
+    void writeMarker(const QString &marker) override {
+        setContent(marker, false);
+    }
+
+    void requestCopy() override {
+        ++copyRequests;
+        if (replies.isEmpty())
+            return;
+        const Reply reply = replies.takeFirst();
+        QTimer::singleShot(reply.delayMs, this, [this, reply]() {
+            setContent(reply.text, reply.notify);
+        });
+    }
+
+    void setContent(const QString &text, bool notify) {
+        content = text;
+        ++sequence;
+        if (notify)
+            emit changed();
+    }
+
+private:
+    quint64 sequence = 1;
+    QString content;
+};
+
+struct Result {
+    bool called = false;
+    QString text;
+};
+}
+
+class TestSelectionCapture : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+    void capturesSelection();
+    void capturesWithoutChangeNotification();
+    void skipsEmptyIntermediateContent();
+    void timesOutWithoutSelection();
+    void adaptiveTimeoutKeepsFloor();
+    void slowCopyAfterFastHistory();
+    void newerCaptureReplacesOlder();
+    void cancelDropsCallback();
+
+private:
+    FakeClipboardSource *source = nullptr;
+    SelectionCapture *capture = nullptr;
+
+    void startCapture(Result *result);
+    void captureFast(int count);
+};
+
+void TestSelectionCapture::init() {
+    delete capture;
+    source = new FakeClipboardSource;
+    capture = new SelectionCapture(source, this);
+}
+
+void TestSelectionCapture::startCapture(Result *result) {
+    capture->capture(this, [result](const QString &text) {
+        result->called = true;
+        result->text = text;
+    });
+}
+
+void TestSelectionCapture::captureFast(int count) {
+    for (int i = 0; i < count; ++i) {
+        source->replies.append({0, QStringLiteral("fast %1").arg(i)});
+        Result result;
+        startCapture(&result);
+        QTRY_VERIFY(result.called);
+        QCOMPARE(result.text, QStringLiteral("fast %1").arg(i));
+    }
+}
+
+void TestSelectionCapture::capturesSelection() {
+    source->replies.append({10, QStringLiteral("selected text")});
+    Result result;
+    startCapture(&result);
+    QVERIFY(capture->isActive());
+    QCOMPARE(source->copyRequests, 1);
+    // The callback is queued, never called from inside capture()
+    QVERIFY(!result.called);
+
+    QTRY_VERIFY(result.called);
+    QCOMPARE(result.text, QStringLiteral("selected text"));
+    QVERIFY(!capture->isActive());
+    QCOMPARE(capture->timeoutCount(), 0);
+    QVERIFY(capture->latencyPercentileMs(0.5) >= 0);
+}
+
+void TestSelectionCapture::capturesWithoutChangeNotification() {
+    // Lost notifications are covered by polling the sequence number
+    source->replies.append({10, QStringLiteral("polled"), false});
+    Result result;
+    startCapture(&result);
+    QTRY_VERIFY_WITH_TIMEOUT(result.called, 1000);
+    QCOMPARE(result.text, QStringLiteral("polled"));
+}
+
+void TestSelectionCapture::skipsEmptyIntermediateContent() {
+    source->replies.append({0, QString()});
+    Result result;
+    startCapture(&result);
+    QTest::qWait(50);
+    QVERIFY(!result.called);
+    QVERIFY(capture->isActive());
+
+    source->setContent(QStringLiteral("late text"), true);
+    QTRY_VERIFY(result.called);
+    QCOMPARE(result.text, QStringLiteral("late text"));
+}
+
+void TestSelectionCapture::timesOutWithoutSelection() {
+    QCOMPARE(capture->timeoutMs(), 500);
+    Result result;
+    QElapsedTimer elapsed;
+    elapsed.start();
+    startCapture(&result);
+    QTRY_VERIFY_WITH_TIMEOUT(result.called, 2000);
+    QVERIFY(result.text.isEmpty());
+    QVERIFY(elapsed.elapsed() >= 450);
+    QCOMPARE(capture->timeoutCount(), 1);
+    QCOMPARE(capture->latencyPercentileMs(0.5), qint64(-1));
+}
+
+void TestSelectionCapture::adaptiveTimeoutKeepsFloor() {
+    captureFast(4);
+    // Too little history to adapt
+    QCOMPARE(capture->timeoutMs(), 500);
+    captureFast(1);
+    QCOMPARE(capture->timeoutMs(), 250);
+}
+
+void TestSelectionCapture::slowCopyAfterFastHistory() {
+    captureFast(5);
+    QCOMPARE(capture->timeoutMs(), 250);
+
+    source->replies.append({150, QStringLiteral("slow")});
+    Result result;
+    startCapture(&result);
+    QTRY_VERIFY_WITH_TIMEOUT(result.called, 2000);
+    QCOMPARE(result.text, QStringLiteral("slow"));
+    QCOMPARE(capture->timeoutCount(), 0);
+}
+
+void TestSelectionCapture::newerCaptureReplacesOlder() {
+    Result first;
+    startCapture(&first);
+    source->replies.append({10, QStringLiteral("second")});
+    Result second;
+    startCapture(&second);
+
+    QTRY_VERIFY(second.called);
+    QCOMPARE(second.text, QStringLiteral("second"));
+    QVERIFY(first.called);
+    QVERIFY(first.text.isEmpty());
+}
+
+void TestSelectionCapture::cancelDropsCallback() {
+    source->replies.append({10, QStringLiteral("unused")});
+    Result result;
+    startCapture(&result);
+    capture->cancel(this);
+    QVERIFY(!capture->isActive());
+    QTest::qWait(100);
+    QVERIFY(!result.called);
+    QCOMPARE(capture->timeoutCount(), 0);
+}
+
+QTEST_GUILESS_MAIN(TestSelectionCapture)
+
+#include "tst_selectioncapture.moc"
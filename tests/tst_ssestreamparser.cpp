@@ -0,0 +1,216 @@
+#include "ssestreamparser.h"
+
+#include <QList>
+#include <QTest>
+
+namespace {
+QList<SseEvent> readAll(SseStreamParser *parser) {
+    QList<SseEvent> events;
+    SseEvent event;
+    while (parser->readEvent(&event))
+        events.append(event);
+    return events;
+}
+
+QList<SseEvent> parseChunks(const QList<QByteArray> &chunks) {
+    SseStreamParser parser;
+    QList<SseEvent> events;
+    for (const QByteArray &chunk : chunks) {
+        parser.feed(chunk);
+        events += readAll(&parser);
+    }
+    parser.finish();
+    events += readAll(&parser);
+    return events;
+}
+
+QList<QByteArray> dataOf(const QList<SseEvent> &events) {
+    QList<QByteArray> data;
+    for (const SseEvent &event : events)
+        data.append(event.data);
+    return data;
+}
+
+QList<QByteArray> splitEvery(const QByteArray &stream, int size) {
+    QList<QByteArray> chunks;
+    for (qsizetype i = 0; i < stream.size(); i += size)
+        chunks.append(stream.mid(i, size));
+    return chunks;
+}
+
+// A chat completion stream as the API sends it: one JSON delta per event,
+// keep-alive comments in between and the [DONE] marker at the end
+QByteArray recordedStream(int deltas) {
+    QByteArray stream;
+    for (int i = 0; i < deltas; ++i) {
+        if (i % 50 == 0)
+            stream += ": keep-alive\r\n\r\n";
+        stream += "data: {\"id\":\"chatcmpl-1\",\"object\":\"chat.completion.chunk\",\"created\":1700000000,"
+                  "\"model\":\"gpt-4o-mini\",\"choices\":[{\"index\":0,\"delta\":{\"content\":\"token ";
+        stream += QByteArray::number(i);
+        stream += "\"},\"finish_reason\":null}]}\r\n\r\n";
+    }
+    stream += "data: [DONE]\r\n\r\n";
+    return stream;
+}
+}
+
+class TestSseStreamParser : public QObject {
+    Q_OBJECT
+
+private slots:
+    void lineEndings_data();
+    void lineEndings();
+    void lineEndingsSplitAcrossChunks_data();
+    void lineEndingsSplitAcrossChunks();
+    void crlfSplitBetweenChunks();
+    void byteOrderMark();
+    void byteOrderMarkSplitAcrossChunks();
+    void multiLineData();
+    void dispatchAtEndOfStream();
+    void noDispatchBeforeEndOfStream();
+    void fieldsAndComments();
+    void emptyDataIsNotDispatched();
+    void benchmarkRecordedStream_data();
+    void benchmarkRecordedStream();
+};
+
+void TestSseStreamParser::lineEndings_data() {
+    QTest::addColumn<QByteArray>("stream");
+    QTest::newRow("lf") << QByteArray("data: one\n\ndata: two\n\n");
+    QTest::newRow("cr") << QByteArray("data: one\r\rdata: two\r\r");
+    QTest::newRow("crlf") << QByteArray("data: one\r\n\r\ndata: two\r\n\r\n");
+    QTest::newRow("mixed") << QByteArray("data: one\r\n\ndata: two\r\r\n");
+}
+
+void TestSseStreamParser::lineEndings() {
+    QFETCH(QByteArray, stream);
+    const QList<SseEvent> events = parseChunks({stream});
+    QCOMPARE(dataOf(events), (QList<QByteArray>{"one", "two"}));
+}
+
+void TestSseStreamParser::lineEndingsSplitAcrossChunks_data() {
+    lineEndings_data();
+}
+
+void TestSseStreamParser::lineEndingsSplitAcrossChunks() {
+    QFETCH(QByteArray, stream);
+    for (int size = 1; size <= 4; ++size) {
+        const QList<SseEvent> events = parseChunks(splitEvery(stream, size));
+        QCOMPARE(dataOf(events), (QList<QByteArray>{"one", "two"}));
+    }
+}
+
+void TestSseStreamParser::crlfSplitBetweenChunks() {
+    // The LF that completes a CRLF must not count as an empty line
+    SseStreamParser parser;
+    parser.feed("data: a\r");
+    QVERIFY(readAll(&parser).isEmpty());
+    parser.feed("\ndata: b\r");
+    QVERIFY(readAll(&parser).isEmpty());
+    parser.feed("\n\r\n");
+    const QList<SseEvent> events = readAll(&parser);
+    QCOMPARE(events.size(), 1);
+    QCOMPARE(events.first().data, QByteArray("a\nb"));
+}
+
+void TestSseStreamParser::byteOrderMark() {
+    const QList<SseEvent> events = parseChunks({QByteArray("\xEF\xBB\xBF" "data: x\n\n")});
+    QCOMPARE(dataOf(events), (QList<QByteArray>{"x"}));
+}
+
+void TestSseStreamParser::byteOrderMarkSplitAcrossChunks() {
+    const QList<SseEvent> events = parseChunks({QByteArray("\xEF"), QByteArray("\xBB"),
+                                                QByteArray("\xBF" "da"), QByteArray("ta: x\n\n")});
+    QCOMPARE(dataOf(events), (QList<QByteArray>{"x"}));
+
+    // Only a leading BOM is stripped
+    const QList<SseEvent> inner = parseChunks({QByteArray("data: \xEF\xBB\xBFy\n\n")});
+    QCOMPARE(dataOf(inner), (QList<QByteArray>{"\xEF\xBB\xBFy"}));
+}
+
+void TestSseStreamParser::multiLineData() {
+    const QList<SseEvent> events = parseChunks({QByteArray("data: first\ndata:second\ndata\n\n")});
+    QCOMPARE(dataOf(events), (QList<QByteArray>{"first\nsecond\n"}));
+}
+
+void TestSseStreamParser::dispatchAtEndOfStream() {
+    const QList<SseEvent> events = parseChunks({QByteArray("data: one\n\ndata: tail")});
+    QCOMPARE(dataOf(events), (QList<QByteArray>{"one", "tail"}));
+
+    const QList<SseEvent> terminated = parseChunks({QByteArray("data: tail\n")});
+    QCOMPARE(dataOf(terminated), (QList<QByteArray>{"tail"}));
+}
+
+void TestSseStreamParser::noDispatchBeforeEndOfStream() {
+    SseStreamParser parser;
+    parser.feed("data: pending\n");
+    QVERIFY(readAll(&parser).isEmpty());
+    QVERIFY(parser.sawData());
+    parser.finish();
+    QCOMPARE(dataOf(readAll(&parser)), (QList<QByteArray>{"pending"}));
+}
+
+void TestSseStreamParser::fieldsAndComments() {
+    const QList<SseEvent> events = parseChunks({QByteArray(
+        ": keep-alive\n"
+        "event: delta\n"
+        "id: 7\n"
+        "retry: 1500\n"
+        "unknown: ignored\n"
+        "data: payload\n"
+        "\n"
+        "data: plain\n"
+        "\n")});
+    QCOMPARE(events.size(), 2);
+    QCOMPARE(events.at(0).type, QByteArray("delta"));
+    QCOMPARE(events.at(0).id, QByteArray("7"));
+    QCOMPARE(events.at(0).data, QByteArray("payload"));
+    QCOMPARE(events.at(1).type, QByteArray("message"));
+    QCOMPARE(events.at(1).id, QByteArray("7"));
+
+    SseStreamParser parser;
+    parser.feed("retry: 1500\nretry: soon\n\n");
+    readAll(&parser);
+    QCOMPARE(parser.retryInterval(), 1500);
+    QCOMPARE(parser.lastEventId(), QByteArray());
+}
+
+void TestSseStreamParser::emptyDataIsNotDispatched() {
+    const QList<SseEvent> events = parseChunks({QByteArray("event: ping\n\n\n: comment\n\ndata: x\n\n")});
+    QCOMPARE(events.size(), 1);
+    // The type of an event without data does not leak into the next one
+    QCOMPARE(events.first().type, QByteArray("message"));
+}
+
+void TestSseStreamParser::benchmarkRecordedStream_data() {
+    QTest::addColumn<int>("chunkSize");
+    QTest::newRow("byte by byte") << 1;
+    QTest::newRow("64 KB chunks") << 64 * 1024;
+}
+
+void TestSseStreamParser::benchmarkRecordedStream() {
+    QFETCH(int, chunkSize);
+    const int deltas = 5000;
+    // Split up front so only the parser is measured
+    const QList<QByteArray> chunks = splitEvery(recordedStream(deltas), chunkSize);
+    int events = 0;
+    QBENCHMARK {
+        SseStreamParser parser;
+        SseEvent event;
+        events = 0;
+        for (const QByteArray &chunk : chunks) {
+            parser.feed(chunk);
+            while (parser.readEvent(&event))
+                ++events;
+        }
+        parser.finish();
+        while (parser.readEvent(&event))
+            ++events;
+    }
+    QCOMPARE(events, deltas + 1);
+}
+
+QTEST_GUILESS_MAIN(TestSseStreamParser)
+
+#include "tst_ssestreamparser.moc"
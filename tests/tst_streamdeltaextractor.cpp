@@ -0,0 +1,170 @@
+#include "streamdeltaextractor.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTest>
+
+namespace {
+// What the extractor returned before the scanner existed; the scanner and
+// its DOM fallback must agree with it on every payload.
+bool referenceExtract(const QByteArray &payload, StreamDelta *delta) {
+    delta->clear();
+    const QJsonDocument doc = QJsonDocument::fromJson(payload);
+    if (!doc.isObject())
+        return false;
+    const QJsonObject obj = doc.object();
+
+    const QJsonArray choices = obj.value("choices").toArray();
+    if (!choices.isEmpty()) {
+        const QJsonObject choice = choices.first().toObject();
+        delta->content = choice.value("delta").toObject().value("content").toString();
+        if (delta->content.isEmpty())
+            delta->content = choice.value("message").toObject().value("content").toString();
+        delta->finishReason = choice.value("finish_reason").toString();
+    }
+
+    const QJsonValue usageValue = obj.value("usage");
+    if (usageValue.isObject()) {
+        const QJsonObject usage = usageValue.toObject();
+        delta->hasUsage = true;
+        delta->usage.promptTokens = usage.value("prompt_tokens").toInt();
+        delta->usage.completionTokens = usage.value("completion_tokens").toInt();
+        delta->usage.totalTokens = usage.value("total_tokens").toInt();
+    }
+
+    const QJsonValue errorValue = obj.value("error");
+    if (errorValue.isObject())
+        delta->errorMessage = errorValue.toObject().value("message").toString();
+    else if (errorValue.isString())
+        delta->errorMessage = errorValue.toString();
+    return true;
+}
+
+void compareDeltas(const StreamDelta &actual, const StreamDelta &expected) {
+    QCOMPARE(actual.content, expected.content);
+    QCOMPARE(actual.finishReason, expected.finishReason);
+    QCOMPARE(actual.errorMessage, expected.errorMessage);
+    QCOMPARE(actual.hasUsage, expected.hasUsage);
+    QCOMPARE(actual.usage.promptTokens, expected.usage.promptTokens);
+    QCOMPARE(actual.usage.completionTokens, expected.usage.completionTokens);
+    QCOMPARE(actual.usage.totalTokens, expected.usage.totalTokens);
+}
+}
+
+class TestStreamDeltaExtractor : public QObject {
+    Q_OBJECT
+
+private slots:
+    void matchesDocumentParser_data();
+    void matchesDocumentParser();
+    void decodesEscapes_data();
+    void decodesEscapes();
+    void rejectsNonObjects_data();
+    void rejectsNonObjects();
+    void reuseDoesNotLeakState();
+};
+
+void TestStreamDeltaExtractor::matchesDocumentParser_data() {
+    QTest::addColumn<QByteArray>("payload");
+
+    // Handled by the scanner
+    QTest::newRow("delta") << QByteArray(
+        R"({"id":"c1","object":"chat.completion.chunk","choices":[{"index":0,"delta":{"content":"Hello"},"finish_reason":null}]})");
+    QTest::newRow("role only") << QByteArray(R"({"choices":[{"delta":{"role":"assistant"}}]})");
+    QTest::newRow("null content") << QByteArray(R"({"choices":[{"delta":{"content":null},"finish_reason":"stop"}]})");
+    QTest::newRow("message") << QByteArray(
+        R"({"choices":[{"message":{"role":"assistant","content":"Full reply"},"finish_reason":"length"}]})");
+    QTest::newRow("delta wins over message") << QByteArray(
+        R"({"choices":[{"message":{"content":"m"},"delta":{"content":"d"}}]})");
+    QTest::newRow("empty delta falls back to message") << QByteArray(
+        R"({"choices":[{"delta":{"content":""},"message":{"content":"m"}}]})");
+    QTest::newRow("first choice only") << QByteArray(
+        R"({"choices":[{"delta":{"content":"a"}},{"delta":{"content":"b"}}]})");
+    QTest::newRow("empty choices") << QByteArray(R"({"choices":[],"usage":null})");
+    QTest::newRow("usage") << QByteArray(
+        R"({"choices":[],"usage":{"prompt_tokens":12,"completion_tokens":34,"total_tokens":46,"details":{"cached":[1,2]}}})");
+    QTest::newRow("empty usage") << QByteArray(R"({"usage":{}})");
+    QTest::newRow("error object") << QByteArray(R"({"error":{"message":"Rate limit","type":"requests","code":429}})");
+    QTest::newRow("error string") << QByteArray(R"({"error":"Bad gateway"})");
+    QTest::newRow("nested unknowns") << QByteArray(
+        R"({"x":{"y":[true,false,null,-1.5e+3,{"z":"w"}]},"choices":[{"logprobs":{"content":[]},"delta":{"content":"ok"}}]})");
+    QTest::newRow("whitespace") << QByteArray(" {\n \"choices\" : [ { \"delta\" : { \"content\" : \"spaced\" } } ] }\r\n");
+    QTest::newRow("utf8") << QByteArray("{\"choices\":[{\"delta\":{\"content\":\"\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82 \xE2\x9C\x93\"}}]}");
+    QTest::newRow("surrogate pair") << QByteArray(R"({"choices":[{"delta":{"content":"smile \ud83d\ude00!"}}]})");
+    QTest::newRow("upper case hex") << QByteArray(R"({"choices":[{"delta":{"content":"\uD83D\uDE00\u00E9"}}]})");
+
+    // Left to the DOM fallback
+    QTest::newRow("content parts") << QByteArray(
+        R"({"choices":[{"delta":{"content":[{"type":"text","text":"part"}]}}]})");
+    QTest::newRow("escaped key") << QByteArray(R"({"choices":[{"delta":{"\u0063ontent":"escaped"}}]})");
+    QTest::newRow("fractional usage") << QByteArray(R"({"usage":{"prompt_tokens":1.5,"completion_tokens":2}})");
+    QTest::newRow("lone high surrogate") << QByteArray(R"({"choices":[{"delta":{"content":"a\ud83db"}}]})");
+    QTest::newRow("lone low surrogate") << QByteArray(R"({"choices":[{"delta":{"content":"a\ude00b"}}]})");
+    QTest::newRow("trailing garbage") << QByteArray(R"({"choices":[]} x)");
+}
+
+void TestStreamDeltaExtractor::matchesDocumentParser() {
+    QFETCH(QByteArray, payload);
+    StreamDeltaExtractor extractor;
+    StreamDelta actual;
+    StreamDelta expected;
+    QCOMPARE(extractor.extract(payload, &actual), referenceExtract(payload, &expected));
+    compareDeltas(actual, expected);
+}
+
+void TestStreamDeltaExtractor::decodesEscapes_data() {
+    QTest::addColumn<QByteArray>("payload");
+    QTest::addColumn<QString>("content");
+
+    QTest::newRow("simple escapes") << QByteArray(R"({"choices":[{"delta":{"content":"a\"b\\c\/d\ne\tf\rg\bh\fi"}}]})")
+                                    << QStringLiteral("a\"b\\c/d\ne\tf\rg\bh\fi");
+    QTest::newRow("bmp") << QByteArray(R"({"choices":[{"delta":{"content":"caf\u00e9 \u20ac"}}]})")
+                         << QString::fromUtf8("caf\xC3\xA9 \xE2\x82\xAC");
+    QTest::newRow("astral") << QByteArray(R"({"choices":[{"delta":{"content":"\ud83d\ude00"}}]})")
+                            << QString::fromUcs4(U"\U0001F600", 1);
+    QTest::newRow("adjacent pairs") << QByteArray(R"({"choices":[{"delta":{"content":"\ud83d\ude00\ud83d\udc4d"}}]})")
+                                    << QString::fromUcs4(U"\U0001F600\U0001F44D", 2);
+}
+
+void TestStreamDeltaExtractor::decodesEscapes() {
+    QFETCH(QByteArray, payload);
+    QFETCH(QString, content);
+    StreamDeltaExtractor extractor;
+    StreamDelta delta;
+    QVERIFY(extractor.extract(payload, &delta));
+    QCOMPARE(delta.content, content);
+}
+
+void TestStreamDeltaExtractor::rejectsNonObjects_data() {
+    QTest::addColumn<QByteArray>("payload");
+    QTest::newRow("done marker") << QByteArray("[DONE]");
+    QTest::newRow("array") << QByteArray("[1,2]");
+    QTest::newRow("truncated") << QByteArray(R"({"choices":[{"delta":{"content":"cut)");
+    QTest::newRow("empty") << QByteArray();
+}
+
+void TestStreamDeltaExtractor::rejectsNonObjects() {
+    QFETCH(QByteArray, payload);
+    StreamDeltaExtractor extractor;
+    StreamDelta delta;
+    delta.content = QStringLiteral("stale");
+    QVERIFY(!extractor.extract(payload, &delta));
+    QVERIFY(delta.content.isEmpty());
+}
+
+void TestStreamDeltaExtractor::reuseDoesNotLeakState() {
+    StreamDeltaExtractor extractor;
+    StreamDelta delta;
+    QVERIFY(extractor.extract(R"({"choices":[{"delta":{"content":"first"},"finish_reason":"x"}],"usage":{"total_tokens":3}})", &delta));
+    QCOMPARE(delta.content, QStringLiteral("first"));
+    QVERIFY(extractor.extract(R"({"choices":[{"delta":{}}]})", &delta));
+    QVERIFY(delta.content.isEmpty());
+    QVERIFY(delta.finishReason.isEmpty());
+    QVERIFY(!delta.hasUsage);
+    QCOMPARE(delta.usage.totalTokens, 0);
+}
+
+QTEST_GUILESS_MAIN(TestStreamDeltaExtractor)
+
+#include "tst_streamdeltaextractor.moc"
@@ -0,0 +1,62 @@
+#include "textchunker.h"
+
+#include <QTest>
+
+namespace {
+QString emoji(int count) {
+    QString text;
+    for (int i = 0; i < count; ++i)
+        text += QString::fromUcs4(U"\U0001F600", 1);
+    return text;
+}
+
+bool splitsSurrogatePair(const QStringList &parts) {
+    for (const QString &part : parts) {
+        if (part.isEmpty() || part.front().isLowSurrogate() || part.back().isHighSurrogate())
+            return true;
+    }
+    return false;
+}
+}
+
+class TestTextChunker : public QObject {
+    Q_OBJECT
+
+private slots:
+    void shortTextIsOnePart();
+    void prefersParagraphs();
+    void keepsSurrogatePairs_data();
+    void keepsSurrogatePairs();
+};
+
+void TestTextChunker::shortTextIsOnePart() {
+    QCOMPARE(TextChunker::split(QStringLiteral("short"), 10), QStringList{QStringLiteral("short")});
+    QCOMPARE(TextChunker::split(QStringLiteral("no limit"), 0), QStringList{QStringLiteral("no limit")});
+}
+
+void TestTextChunker::prefersParagraphs() {
+    const QString text = QStringLiteral("First paragraph here.\n\nSecond one. It goes on");
+    const QStringList parts = TextChunker::split(text, 30);
+    QCOMPARE(parts.first(), QStringLiteral("First paragraph here.\n\n"));
+    QCOMPARE(parts.join(QString()), text);
+}
+
+void TestTextChunker::keepsSurrogatePairs_data() {
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<int>("maxChars");
+    QTest::newRow("window of one high surrogate") << emoji(4) << 1;
+    QTest::newRow("odd window") << emoji(6) << 3;
+    QTest::newRow("after ascii") << (QStringLiteral("ab") + emoji(5)) << 3;
+}
+
+void TestTextChunker::keepsSurrogatePairs() {
+    QFETCH(QString, text);
+    QFETCH(int, maxChars);
+    const QStringList parts = TextChunker::split(text, maxChars);
+    QVERIFY(!splitsSurrogatePair(parts));
+    QCOMPARE(parts.join(QString()), text);
+}
+
+QTEST_GUILESS_MAIN(TestTextChunker)
+
+#include "tst_textchunker.moc"
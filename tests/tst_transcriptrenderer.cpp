@@ -0,0 +1,90 @@
+#include "transcriptrenderer.h"
+#include "transcriptstore.h"
+
+#include <QFont>
+#include <QTest>
+#include <QTextDocument>
+
+#include <memory>
+
+namespace {
+constexpr int kTurns = 20;
+constexpr int kAnswerBytes = 50 * 1024;
+// Roughly what arrives between two frame-paced renders
+constexpr int kDeltaChars = 200;
+
+QString answerText(int turn, int length) {
+    QString text = QStringLiteral("Answer %1 with **bold** words, `inline code` and a list:\n\n"
+                                  "- first item\n- second item\n\n"
+                                  "```cpp\nint value = %1; // comment\nreturn value * 2;\n```\n\n").arg(turn);
+    while (text.size() < length)
+        text += QStringLiteral("Some prose that keeps the paragraph going for a while. ");
+    text.truncate(length);
+    return text;
+}
+
+// kTurns follow-ups and answers, as in a long conversation
+TranscriptStore conversation() {
+    TranscriptStore transcript;
+    for (int turn = 0; turn < kTurns; ++turn) {
+        transcript.appendBlock(TranscriptStore::userMessageBlock(QStringLiteral("Question %1?").arg(turn)));
+        transcript.appendBlock(TranscriptStore::normalizedBlock(answerText(turn, 2000)));
+    }
+    return transcript;
+}
+
+std::unique_ptr<QTextDocument> makeDocument() {
+    auto document = std::make_unique<QTextDocument>();
+    document->setDefaultFont(QFont(QStringLiteral("Arial"), 12));
+    document->setUndoRedoEnabled(false);
+    return document;
+}
+}
+
+class TestTranscriptRenderer : public QObject {
+    Q_OBJECT
+
+private slots:
+    void incrementalMatchesFullRender();
+    void benchmarkStreamedAnswer();
+};
+
+void TestTranscriptRenderer::incrementalMatchesFullRender() {
+    const QString answer = answerText(kTurns, 4000);
+
+    TranscriptStore streamed = conversation();
+    auto streamedDocument = makeDocument();
+    auto *streamedRenderer = new TranscriptRenderer(streamedDocument.get());
+    for (int i = 0; i < answer.size(); i += kDeltaChars) {
+        streamed.appendPending(QStringView(answer).mid(i, kDeltaChars));
+        streamedRenderer->render(streamed, QStringLiteral("*Replying...*"));
+    }
+    streamedRenderer->render(streamed);
+
+    TranscriptStore whole = conversation();
+    whole.appendPending(answer);
+    auto wholeDocument = makeDocument();
+    auto *wholeRenderer = new TranscriptRenderer(wholeDocument.get());
+    wholeRenderer->render(whole);
+
+    QCOMPARE(streamedDocument->toPlainText(), wholeDocument->toPlainText());
+    QCOMPARE(streamedDocument->blockCount(), wholeDocument->blockCount());
+}
+
+void TestTranscriptRenderer::benchmarkStreamedAnswer() {
+    const TranscriptStore base = conversation();
+    const QString answer = answerText(kTurns, kAnswerBytes);
+    QBENCHMARK {
+        TranscriptStore transcript = base;
+        auto document = makeDocument();
+        auto *renderer = new TranscriptRenderer(document.get());
+        for (int i = 0; i < answer.size(); i += kDeltaChars) {
+            transcript.appendPending(QStringView(answer).mid(i, kDeltaChars));
+            renderer->render(transcript);
+        }
+    }
+}
+
+QTEST_MAIN(TestTranscriptRenderer)
+
+#include "tst_transcriptrenderer.moc"
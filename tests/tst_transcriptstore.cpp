@@ -0,0 +1,102 @@
+#include "transcriptstore.h"
+
+#include <QTest>
+
+namespace {
+// Stream-sized deltas of a few characters each, like a token stream
+QStringList tokenDeltas(int count) {
+    QStringList deltas;
+    for (int i = 0; i < count; ++i)
+        deltas.append(QStringLiteral("tok%1 ").arg(i % 100));
+    return deltas;
+}
+
+qsizetype totalSize(const QStringList &deltas) {
+    qsizetype size = 0;
+    for (const QString &delta : deltas)
+        size += delta.size();
+    return size;
+}
+
+// Geometric growth from the 4096-char initial buffer
+int growthBound(qsizetype size) {
+    int bound = 1;
+    for (qsizetype capacity = 4096; capacity < size; capacity *= 2)
+        ++bound;
+    return bound;
+}
+}
+
+class TestTranscriptStore : public QObject {
+    Q_OBJECT
+
+private slots:
+    void reallocationsPerStreamedReply_data();
+    void reallocationsPerStreamedReply();
+    void clearedReplyReusesBuffer();
+    void normalizedBlockClosesFence();
+    void benchmarkStreamedDeltas();
+};
+
+void TestTranscriptStore::reallocationsPerStreamedReply_data() {
+    QTest::addColumn<int>("deltas");
+    QTest::newRow("short") << 10;
+    QTest::newRow("1000 tokens") << 1000;
+    QTest::newRow("100000 tokens") << 100000;
+}
+
+void TestTranscriptStore::reallocationsPerStreamedReply() {
+    QFETCH(int, deltas);
+    const QStringList stream = tokenDeltas(deltas);
+    TranscriptStore transcript;
+    for (const QString &delta : stream)
+        transcript.appendPending(delta);
+    QCOMPARE(transcript.pending().size(), totalSize(stream));
+    // O(log n) reallocations per reply, not one per token
+    QVERIFY2(transcript.pendingReallocations() <= growthBound(totalSize(stream)),
+             qPrintable(QStringLiteral("%1 reallocations for %2 deltas")
+                            .arg(transcript.pendingReallocations()).arg(deltas)));
+}
+
+void TestTranscriptStore::clearedReplyReusesBuffer() {
+    const QStringList stream = tokenDeltas(20000);
+    TranscriptStore transcript;
+    for (const QString &delta : stream)
+        transcript.appendPending(delta);
+    QVERIFY(transcript.pendingReallocations() > 0);
+
+    transcript.clearPending();
+    QCOMPARE(transcript.pendingReallocations(), 0);
+    for (const QString &delta : stream)
+        transcript.appendPending(delta);
+    QCOMPARE(transcript.pendingReallocations(), 0);
+
+    // A committed reply takes the buffer with it
+    const QString reply = transcript.takePending();
+    QCOMPARE(reply.size(), totalSize(stream));
+    QVERIFY(!transcript.hasPending());
+    QCOMPARE(transcript.pendingReallocations(), 0);
+}
+
+void TestTranscriptStore::normalizedBlockClosesFence() {
+    QCOMPARE(TranscriptStore::normalizedBlock(QStringLiteral("a\r\nb")), QStringLiteral("a\nb"));
+    QCOMPARE(TranscriptStore::normalizedBlock(QStringLiteral("```cpp\nint x;")),
+             QStringLiteral("```cpp\nint x;\n```"));
+    QCOMPARE(TranscriptStore::normalizedBlock(QStringLiteral("```\ncode\n```")), QStringLiteral("```\ncode\n```"));
+}
+
+void TestTranscriptStore::benchmarkStreamedDeltas() {
+    const QStringList stream = tokenDeltas(10000);
+    int reallocations = 0;
+    QBENCHMARK {
+        TranscriptStore transcript;
+        for (const QString &delta : stream)
+            transcript.appendPending(delta);
+        reallocations = transcript.pendingReallocations();
+    }
+    QVERIFY(reallocations <= growthBound(totalSize(stream)));
+}
+
+QTEST_GUILESS_MAIN(TestTranscriptStore)
+
+#include "tst_transcriptstore.moc"
@@ -0,0 +1,60 @@
+#include "textchunker.h"
+
+#include <QStringView>
+
+namespace {
+// Boundaries closer to the start than this would make tiny parts
+constexpr int kMinChunkFraction = 4;
+
+qsizetype sentenceEnd(QStringView window, qsizetype minCut) {
+    for (qsizetype i = window.size() - 2; i >= minCut; --i) {
+        const QChar ch = window.at(i);
+        if ((ch == u'.' || ch == u'!' || ch == u'?') && window.at(i + 1).isSpace())
+            return i + 2;
+    }
+    return -1;
+}
+
+qsizetype cutPosition(QStringView window) {
+    const qsizetype minCut = window.size() / kMinChunkFraction;
+
+    qsizetype cut = window.lastIndexOf(u"\n\n");
+    if (cut >= minCut)
+        return cut + 2;
+    cut = window.lastIndexOf(u'\n');
+    if (cut >= minCut)
+        return cut + 1;
+    cut = sentenceEnd(window, minCut);
+    if (cut >= minCut)
+        return cut;
+    cut = window.lastIndexOf(u' ');
+    if (cut >= minCut)
+        return cut + 1;
+
+    // No boundary at all; still keep surrogate pairs together. A window of
+    // just a high surrogate takes its pair along, one past the window end.
+    cut = window.size();
+    if (window.at(cut - 1).isHighSurrogate())
+        cut += cut > 1 ? -1 : 1;
+    return cut;
+}
+}
+
+QStringList TextChunker::split(const QString &text, int maxChars) {
+    QStringList parts;
+    if (maxChars <= 0 || text.size() <= maxChars) {
+        parts.append(text);
+        return parts;
+    }
+
+    qsizetype pos = 0;
+    while (pos < text.size()) {
+        const QStringView window = QStringView(text).mid(pos, maxChars);
+        const qsizetype cut = window.size() < maxChars ? window.size() : cutPosition(window);
+        const QString part = text.mid(pos, cut);
+        if (!part.trimmed().isEmpty())
+            parts.append(part);
+        pos += cut;
+    }
+    return parts;
+}
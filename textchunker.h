@@ -0,0 +1,14 @@
+#ifndef TEXTCHUNKER_H
+#define TEXTCHUNKER_H
+
+#include <QString>
+#include <QStringList>
+
+// Splits long text into parts of at most maxChars, preferring paragraph,
+// then line, then sentence, then word boundaries.
+class TextChunker {
+public:
+    static QStringList split(const QString &text, int maxChars);
+};
+
+#endif // TEXTCHUNKER_H
@@ -0,0 +1,144 @@
+#include "textsink.h"
+
+#include <QList>
+
+namespace {
+// Long runs without punctuation are still written once they reach this size
+constexpr int kMaxChunkChars = 120;
+
+void appendKey(QList<INPUT> *inputs, WORD vk) {
+    INPUT down = {};
+    down.type = INPUT_KEYBOARD;
+    down.ki.wVk = vk;
+    INPUT up = down;
+    up.ki.dwFlags = KEYEVENTF_KEYUP;
+    inputs->append(down);
+    inputs->append(up);
+}
+
+void appendUnicode(QList<INPUT> *inputs, char16_t unit) {
+    INPUT down = {};
+    down.type = INPUT_KEYBOARD;
+    down.ki.wScan = unit;
+    down.ki.dwFlags = KEYEVENTF_UNICODE;
+    INPUT up = down;
+    up.ki.dwFlags = KEYEVENTF_UNICODE | KEYEVENTF_KEYUP;
+    inputs->append(down);
+    inputs->append(up);
+}
+
+// Returns the length of the longest prefix that ends on a line or sentence
+// boundary, or 0 when the buffer has none yet.
+int chunkBoundary(const QString &text) {
+    for (int i = text.size() - 1; i >= 0; --i) {
+        const QChar ch = text.at(i);
+        if (ch == u'\n')
+            return i + 1;
+        if ((ch == u'.' || ch == u'!' || ch == u'?' || ch == u';' || ch == u':')
+            && i + 1 < text.size() && text.at(i + 1).isSpace()) {
+            return i + 2;
+        }
+    }
+    return 0;
+}
+}
+
+SendInputTextSink::SendInputTextSink(HWND target)
+    : target(target) {
+}
+
+bool SendInputTextSink::write(const QString &text) {
+    if (!target || GetForegroundWindow() != target)
+        return false;
+    QList<INPUT> inputs;
+    inputs.reserve(text.size() * 2);
+    for (int i = 0; i < text.size(); ++i) {
+        const char16_t unit = text.at(i).unicode();
+        if (unit == u'\r') {
+            continue;
+        } else if (unit == u'\n') {
+            // Editors expect a real Enter key rather than a Unicode line feed
+            appendKey(&inputs, VK_RETURN);
+        } else if (unit == u'\t') {
+            appendKey(&inputs, VK_TAB);
+        } else {
+            appendUnicode(&inputs, unit);
+        }
+    }
+    if (!inputs.isEmpty())
+        SendInput(static_cast<UINT>(inputs.size()), inputs.data(), sizeof(INPUT));
+    return true;
+}
+
+ChunkedTextWriter::ChunkedTextWriter(TextSink *sink)
+    : sink(sink)
+    , written(0)
+    , stopped(false) {
+}
+
+void ChunkedTextWriter::append(const QString &text) {
+    if (stopped)
+        return;
+    pending += text;
+    const int boundary = chunkBoundary(pending);
+    if (boundary > 0) {
+        writeChunk(boundary);
+        return;
+    }
+    if (pending.size() >= kMaxChunkChars) {
+        // Split after the last space so words are not broken across chunks
+        const int space = pending.lastIndexOf(u' ');
+        writeChunk(space > 0 ? space + 1 : pending.size());
+    }
+}
+
+void ChunkedTextWriter::flush() {
+    writeChunk(pending.size());
+}
+
+void ChunkedTextWriter::discard() {
+    pending.clear();
+}
+
+int ChunkedTextWriter::writtenChars() const {
+    return written;
+}
+
+bool ChunkedTextWriter::isStopped() const {
+    return stopped;
+}
+
+void ChunkedTextWriter::writeChunk(int length) {
+    if (length <= 0 || !sink || stopped)
+        return;
+    if (!sink->write(pending.left(length))) {
+        stopped = true;
+        pending.clear();
+        return;
+    }
+    pending.remove(0, length);
+    written += length;
+}
+
+StreamingInsert::StreamingInsert()
+    : sink(GetForegroundWindow())
+    , writer(&sink) {
+}
+
+bool StreamingInsert::append(const QString &text) {
+    writer.append(text);
+    return !writer.isStopped();
+}
+
+bool StreamingInsert::finish() {
+    writer.flush();
+    return !writer.isStopped();
+}
+
+void StreamingInsert::cancel() {
+    writer.discard();
+}
+
+int StreamingInsert::writtenChars() const {
+    return writer.writtenChars();
+}
@@ -0,0 +1,71 @@
+#ifndef TEXTSINK_H
+#define TEXTSINK_H
+
+#include <QString>
+
+#include <windows.h>
+
+// Destination for text inserted into the application that had the selection.
+class TextSink {
+public:
+    virtual ~TextSink() = default;
+    // Returns false, having written nothing, when the destination can no
+    // longer take text
+    virtual bool write(const QString &text) = 0;
+};
+
+// Types text into a window with SendInput Unicode events, so the clipboard
+// is left alone while the answer streams in. SendInput goes wherever focus
+// is, so every write first checks that target is still the foreground window.
+class SendInputTextSink : public TextSink {
+public:
+    explicit SendInputTextSink(HWND target);
+    bool write(const QString &text) override;
+
+private:
+    HWND target;
+};
+
+// Buffers streamed text and hands it to a sink in line- or sentence-sized
+// chunks, so the target application sees few, ordered insertions.
+class ChunkedTextWriter {
+public:
+    explicit ChunkedTextWriter(TextSink *sink);
+
+    void append(const QString &text);
+    // Writes whatever is still buffered, e.g. when the stream finished.
+    void flush();
+    // Drops buffered text, e.g. when the request was canceled mid-stream.
+    void discard();
+    int writtenChars() const;
+    // Set once the sink refused a chunk; everything after it is dropped
+    bool isStopped() const;
+
+private:
+    TextSink *sink;
+    QString pending;
+    int written;
+    bool stopped;
+
+    void writeChunk(int length);
+};
+
+// A streamed answer typed into the window that had focus when the request
+// started. It stops for good once focus moves, rather than typing the rest
+// into whatever the user switched to.
+class StreamingInsert {
+public:
+    StreamingInsert();
+
+    // Both return false once the insert has stopped
+    bool append(const QString &text);
+    bool finish();
+    void cancel();
+    int writtenChars() const;
+
+private:
+    SendInputTextSink sink;
+    ChunkedTextWriter writer;
+};
+
+#endif // TEXTSINK_H
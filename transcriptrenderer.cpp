@@ -0,0 +1,363 @@
+#include "transcriptrenderer.h"
+#include "codelexer.h"
+#include "transcriptstore.h"
+
+#include <QColor>
+#include <QStringList>
+#include <QSyntaxHighlighter>
+#include <QTextBlock>
+#include <QTextCharFormat>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTextDocumentFragment>
+#include <QTextFormat>
+#include <QTextFragment>
+#include <QTextList>
+
+#include <utility>
+
+namespace {
+bool isCodeBlock(const QTextBlock &block) {
+    const QTextBlockFormat format = block.blockFormat();
+    if (format.hasProperty(QTextFormat::BlockCodeFence))
+        return true;
+    if (format.hasProperty(QTextFormat::BlockCodeLanguage))
+        return true;
+    return block.charFormat().fontFixedPitch();
+}
+
+bool isInlineCodeFormat(const QTextCharFormat &format) {
+    if (format.fontFixedPitch())
+        return true;
+    const QFont font = format.font();
+    if (font.fixedPitch())
+        return true;
+    const QString family = font.family();
+    if (family.contains("mono", Qt::CaseInsensitive)
+        || family.contains("courier", Qt::CaseInsensitive)
+        || family.contains("consolas", Qt::CaseInsensitive)) {
+        return true;
+    }
+    const QStringList families = format.fontFamilies().toStringList();
+    for (const QString &entry : families) {
+        if (entry.contains("mono", Qt::CaseInsensitive)
+            || entry.contains("courier", Qt::CaseInsensitive)
+            || entry.contains("consolas", Qt::CaseInsensitive)) {
+            return true;
+        }
+    }
+    const QVariant hintProp = format.property(QTextFormat::FontStyleHint);
+    if (hintProp.isValid()) {
+        const int hint = hintProp.toInt();
+        if (hint == QFont::TypeWriter || hint == QFont::Monospace)
+            return true;
+    }
+    const QVariant familyProp = format.property(QTextFormat::FontFamily);
+    if (familyProp.isValid()) {
+        const QString propFamily = familyProp.toString();
+        if (propFamily.contains("mono", Qt::CaseInsensitive)
+            || propFamily.contains("courier", Qt::CaseInsensitive)
+            || propFamily.contains("consolas", Qt::CaseInsensitive)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void clearDocument(QTextDocument *doc) {
+    QTextCursor cursor(doc);
+    cursor.select(QTextCursor::Document);
+    cursor.removeSelectedText();
+    cursor.setBlockFormat(QTextBlockFormat());
+    cursor.setBlockCharFormat(QTextCharFormat());
+}
+
+// Renders one markdown segment on its own and appends it as new blocks, so
+// content already in the document is neither re-parsed nor re-laid out.
+void appendMarkdownSegment(QTextDocument *doc, const QString &markdown) {
+    QTextDocument segment;
+    segment.setDefaultFont(doc->defaultFont());
+    segment.setMarkdown(markdown, QTextDocument::MarkdownDialectGitHub);
+
+    QTextCursor cursor(doc);
+    cursor.movePosition(QTextCursor::End);
+    if (!doc->isEmpty())
+        cursor.insertBlock(QTextBlockFormat(), QTextCharFormat());
+    const int start = cursor.position();
+    cursor.insertFragment(QTextDocumentFragment(&segment));
+
+    // insertFragment merges the first source block into the current one and
+    // drops its format, which would turn a leading heading or code fence into
+    // a plain paragraph.
+    const QTextBlock sourceBlock = segment.firstBlock();
+    QTextBlockFormat blockFormat = sourceBlock.blockFormat();
+    blockFormat.clearProperty(QTextFormat::ObjectIndex);
+    QTextCursor firstCursor(doc);
+    firstCursor.setPosition(start);
+    firstCursor.setBlockFormat(blockFormat);
+    firstCursor.setBlockCharFormat(sourceBlock.charFormat());
+    if (const QTextList *sourceList = sourceBlock.textList()) {
+        const QTextBlock nextBlock = firstCursor.block().next();
+        QTextList *targetList = nextBlock.isValid() ? nextBlock.textList() : nullptr;
+        if (targetList && targetList->format() == sourceList->format())
+            targetList->add(firstCursor.block());
+        else
+            firstCursor.createList(sourceList->format());
+    }
+}
+
+class MarkdownCodeHighlighter : public QSyntaxHighlighter {
+public:
+    explicit MarkdownCodeHighlighter(QTextDocument *parent)
+        : QSyntaxHighlighter(parent) {
+        keywordFormat.setForeground(QColor("#d73a49"));
+        keywordFormat.setFontWeight(QFont::Bold);
+
+        stringFormat.setForeground(QColor("#032f62"));
+
+        numberFormat.setForeground(QColor("#005cc5"));
+
+        commentFormat.setForeground(QColor("#6a737d"));
+    }
+
+protected:
+    void highlightBlock(const QString &text) override {
+        setCurrentBlockState(CodeLexer::NormalState);
+        const QTextBlock block = currentBlock();
+        if (!isCodeBlock(block))
+            return;
+
+        const QString language = block.blockFormat().stringProperty(QTextFormat::BlockCodeLanguage);
+        if (!lexerLanguage || language != lexerLanguageName) {
+            lexerLanguageName = language;
+            lexerLanguage = &CodeLexer::languageFor(language);
+        }
+        const int state = CodeLexer::tokenize(text, previousBlockState(), *lexerLanguage, &tokens);
+        for (const CodeToken &token : std::as_const(tokens))
+            setFormat(token.start, token.length, formatFor(token.kind));
+        setCurrentBlockState(state);
+    }
+
+private:
+    const QTextCharFormat &formatFor(CodeTokenKind kind) const {
+        switch (kind) {
+        case CodeTokenKind::Keyword:
+            return keywordFormat;
+        case CodeTokenKind::String:
+            return stringFormat;
+        case CodeTokenKind::Number:
+            return numberFormat;
+        case CodeTokenKind::Comment:
+            break;
+        }
+        return commentFormat;
+    }
+
+    QTextCharFormat keywordFormat;
+    QTextCharFormat stringFormat;
+    QTextCharFormat numberFormat;
+    QTextCharFormat commentFormat;
+    // Reused between blocks so highlighting a line does not allocate
+    QList<CodeToken> tokens;
+    QString lexerLanguageName;
+    const CodeLanguage *lexerLanguage = nullptr;
+};
+
+const QString &markdownCss() {
+    static const QString css =
+        "body {"
+        "  font-family: 'Segoe UI', 'Noto Sans', Helvetica, Arial;"
+        "  font-size: 12pt;"
+        "  color: #24292f;"
+        "}"
+        "a { color: #0969da; text-decoration: none; }"
+        "a:hover { text-decoration: underline; }"
+        "p { margin: 8px 0; }"
+        "h1 { font-size: 20pt; border-bottom: 1px solid #d0d7de; padding-bottom: 4px; }"
+        "h2 { font-size: 16pt; border-bottom: 1px solid #d0d7de; padding-bottom: 2px; }"
+        "h3 { font-size: 14pt; }"
+        "ul, ol { margin-left: 20px; }"
+        "pre { border: 1px solid #d0d7de; padding: 8px; margin: 12px 0; }"
+        "blockquote {"
+        "  color: #24292f;"
+        "  border-left: 4px solid #9ec5fe;"
+        "  background-color: #f2f7ff;"
+        "  margin: 8px 0;"
+        "  padding: 6px 10px;"
+        "  border-radius: 4px;"
+        "}"
+        "table { border-collapse: collapse; }"
+        "th, td { border: 1px solid #d0d7de; padding: 4px 8px; }"
+        "hr { border: 0; border-top: 1px solid #d0d7de; margin: 12px 0; }";
+    return css;
+}
+}
+
+TranscriptRenderer::TranscriptRenderer(QTextDocument *document)
+    : QObject(document)
+    , document(document)
+    , renderedBlockCount(0)
+    , frozenDocumentLength(0)
+    , styledDocumentLength(0)
+    , baseFont(document->defaultFont()) {
+    document->setDefaultStyleSheet(markdownCss());
+    document->setDocumentMargin(8);
+    document->setUndoRedoEnabled(false);
+    new MarkdownCodeHighlighter(document);
+}
+
+void TranscriptRenderer::render(const TranscriptStore &transcript, const QString &trailer) {
+    renderBlocks(transcript, trailer);
+    applyStyles();
+}
+
+void TranscriptRenderer::reset() {
+    renderedBlockCount = 0;
+    frozenDocumentLength = 0;
+    styledDocumentLength = 0;
+    codeRanges.clear();
+}
+
+void TranscriptRenderer::renderBlocks(const TranscriptStore &transcript, const QString &trailer) {
+    QTextDocument *doc = document;
+    // Fewer blocks than rendered, or a document cleared by its view
+    if (renderedBlockCount > transcript.blockCount()
+        || frozenDocumentLength > doc->characterCount() - 1) {
+        clearDocument(doc);
+        reset();
+    }
+
+    const int documentEnd = doc->characterCount() - 1;
+    if (documentEnd > frozenDocumentLength) {
+        QTextCursor tailCursor(doc);
+        tailCursor.setPosition(frozenDocumentLength);
+        tailCursor.setPosition(documentEnd, QTextCursor::KeepAnchor);
+        tailCursor.removeSelectedText();
+        if (frozenDocumentLength == 0) {
+            tailCursor.setBlockFormat(QTextBlockFormat());
+            tailCursor.setBlockCharFormat(QTextCharFormat());
+        }
+    }
+
+    if (renderedBlockCount < transcript.blockCount()) {
+        for (int i = renderedBlockCount; i < transcript.blockCount(); ++i)
+            appendMarkdownSegment(doc, transcript.blockAt(i));
+        renderedBlockCount = transcript.blockCount();
+        frozenDocumentLength = doc->characterCount() - 1;
+    }
+
+    // The streaming reply is rendered straight from the store without a copy
+    if (transcript.hasPending())
+        appendMarkdownSegment(doc, transcript.pending());
+    if (!trailer.isEmpty())
+        appendMarkdownSegment(doc, trailer);
+}
+
+void TranscriptRenderer::applyStyles() {
+    QTextDocument *doc = document;
+    if (styledDocumentLength > doc->characterCount() - 1) {
+        styledDocumentLength = 0;
+        codeRanges.clear();
+    }
+
+    // Blocks before the last frozen position keep their styling; the one just
+    // before it is revisited because its code margins depend on the next block.
+    QTextBlock block = doc->findBlock(styledDocumentLength);
+    if (block.previous().isValid())
+        block = block.previous();
+    if (!block.isValid())
+        return;
+    const int restyleStart = block.position();
+    while (!codeRanges.isEmpty() && codeRanges.last().end > restyleStart) {
+        CodeStyleRange &last = codeRanges.last();
+        if (last.start < restyleStart) {
+            last.end = restyleStart;
+            break;
+        }
+        codeRanges.removeLast();
+    }
+
+    const qreal codeBlockMargin = 8.0;
+    QTextCharFormat inlineCodeFormat;
+    inlineCodeFormat.setFontFamilies(QStringList{"Consolas"});
+    inlineCodeFormat.setFontFixedPitch(true);
+    inlineCodeFormat.setBackground(QColor("#f6f8fa"));
+    applyCodeFontSize(&inlineCodeFormat);
+
+    const QTextCharFormat blockCodeCharFormat = inlineCodeFormat;
+    auto trackCodeRange = [this](int start, int end) {
+        if (!codeRanges.isEmpty() && start <= codeRanges.last().end + 1) {
+            codeRanges.last().end = qMax(codeRanges.last().end, end);
+            return;
+        }
+        codeRanges.append({start, end});
+    };
+
+    for (; block.isValid(); block = block.next()) {
+        if (isCodeBlock(block)) {
+            QTextCursor blockCursor(block);
+            QTextBlockFormat blockFormat = block.blockFormat();
+            blockFormat.setBackground(QColor("#f6f8fa"));
+            const QTextBlock prevBlock = block.previous();
+            const QTextBlock nextBlock = block.next();
+            const bool isFirstBlock = !prevBlock.isValid() || !isCodeBlock(prevBlock);
+            const bool isLastBlock = !nextBlock.isValid() || !isCodeBlock(nextBlock);
+            blockFormat.setTopMargin(isFirstBlock ? codeBlockMargin : 0.0);
+            blockFormat.setBottomMargin(isLastBlock ? codeBlockMargin : 0.0);
+            blockCursor.setBlockFormat(blockFormat);
+
+            blockCursor.select(QTextCursor::BlockUnderCursor);
+            blockCursor.mergeCharFormat(blockCodeCharFormat);
+            trackCodeRange(blockCursor.selectionStart(), blockCursor.selectionEnd());
+            continue;
+        }
+
+        for (auto it = block.begin(); !it.atEnd(); ++it) {
+            const QTextFragment fragment = it.fragment();
+            if (!fragment.isValid())
+                continue;
+            if (!isInlineCodeFormat(fragment.charFormat()))
+                continue;
+            QTextCursor cursor(doc);
+            cursor.setPosition(fragment.position());
+            cursor.setPosition(fragment.position() + fragment.length(), QTextCursor::KeepAnchor);
+            cursor.mergeCharFormat(inlineCodeFormat);
+            trackCodeRange(fragment.position(), fragment.position() + fragment.length());
+        }
+    }
+    styledDocumentLength = frozenDocumentLength;
+}
+
+void TranscriptRenderer::applyCodeFontSize(QTextCharFormat *format) const {
+    if (baseFont.pointSizeF() > 0) {
+        format->setFontPointSize(baseFont.pointSizeF());
+    } else if (baseFont.pixelSize() > 0) {
+        format->setProperty(QTextFormat::FontPixelSize, baseFont.pixelSize());
+    }
+}
+
+void TranscriptRenderer::updateCodeFontSize() {
+    QTextDocument *doc = document;
+    // Zoom only changes the size, so code keeps its styling and just follows
+    // the new document font instead of going through a full restyle.
+    const QFont zoomedFont = doc->defaultFont();
+    if (zoomedFont.pointSizeF() == baseFont.pointSizeF()
+        && zoomedFont.pixelSize() == baseFont.pixelSize()) {
+        return;
+    }
+    baseFont = zoomedFont;
+    if (codeRanges.isEmpty())
+        return;
+
+    QTextCharFormat sizeFormat;
+    applyCodeFontSize(&sizeFormat);
+    const int documentEnd = doc->characterCount() - 1;
+    QTextCursor cursor(doc);
+    for (const CodeStyleRange &range : std::as_const(codeRanges)) {
+        if (range.start >= documentEnd)
+            break;
+        cursor.setPosition(range.start);
+        cursor.setPosition(qMin(range.end, documentEnd), QTextCursor::KeepAnchor);
+        cursor.mergeCharFormat(sizeFormat);
+    }
+}
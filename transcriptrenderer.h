@@ -0,0 +1,51 @@
+#ifndef TRANSCRIPTRENDERER_H
+#define TRANSCRIPTRENDERER_H
+
+#include <QFont>
+#include <QList>
+#include <QObject>
+#include <QString>
+
+class QTextCharFormat;
+class QTextDocument;
+class TranscriptStore;
+
+// Document range whose code font size follows the zoom.
+struct CodeStyleRange {
+    int start = 0;
+    int end = 0;
+};
+
+// Renders a TranscriptStore into a text document without re-parsing what is
+// already there. Committed blocks are appended once and keep their styling;
+// each update only rebuilds the streaming tail. The renderer is a child of
+// the document, so it goes away with the view that shows it.
+class TranscriptRenderer : public QObject {
+    Q_OBJECT
+
+public:
+    // Sets up the document's style sheet and code highlighting; the document
+    // font should already be set
+    explicit TranscriptRenderer(QTextDocument *document);
+
+    // trailer is shown after the streaming reply, e.g. a typing indicator
+    void render(const TranscriptStore &transcript, const QString &trailer = QString());
+    // Starts over after the document was cleared elsewhere
+    void reset();
+    // Zoom only changes the document font; code follows it without a restyle
+    void updateCodeFontSize();
+
+private:
+    QTextDocument *document;
+    int renderedBlockCount;
+    int frozenDocumentLength;
+    int styledDocumentLength;
+    QFont baseFont;
+    QList<CodeStyleRange> codeRanges;
+
+    void renderBlocks(const TranscriptStore &transcript, const QString &trailer);
+    void applyStyles();
+    void applyCodeFontSize(QTextCharFormat *format) const;
+};
+
+#endif // TRANSCRIPTRENDERER_H
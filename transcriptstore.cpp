@@ -0,0 +1,105 @@
+#include "transcriptstore.h"
+
+#include <QStringList>
+
+#include <utility>
+
+namespace {
+constexpr qsizetype kInitialPendingCapacity = 4096;
+}
+
+void TranscriptStore::appendBlock(const QString &markdown) {
+    if (markdown.isEmpty())
+        return;
+    blocks.append(markdown);
+}
+
+int TranscriptStore::blockCount() const {
+    return static_cast<int>(blocks.size());
+}
+
+const QString &TranscriptStore::blockAt(int index) const {
+    return blocks.at(index);
+}
+
+void TranscriptStore::appendPending(QStringView text) {
+    if (text.isEmpty())
+        return;
+    const qsizetype required = pendingText.size() + text.size();
+    if (required > pendingText.capacity()) {
+        // Grow geometrically so a long reply costs O(log n) reallocations
+        pendingText.reserve(qMax(required, qMax(kInitialPendingCapacity, pendingText.capacity() * 2)));
+        ++reallocations;
+    }
+    pendingText.append(text);
+}
+
+const QString &TranscriptStore::pending() const {
+    return pendingText;
+}
+
+bool TranscriptStore::hasPending() const {
+    return !pendingText.isEmpty();
+}
+
+QString TranscriptStore::takePending() {
+    QString taken = std::move(pendingText);
+    pendingText = QString();
+    reallocations = 0;
+    return taken;
+}
+
+void TranscriptStore::clearPending() {
+    // resize keeps the buffer for the next reply
+    pendingText.resize(0);
+    reallocations = 0;
+}
+
+int TranscriptStore::pendingReallocations() const {
+    return reallocations;
+}
+
+void TranscriptStore::clear() {
+    blocks.clear();
+    clearPending();
+}
+
+QString TranscriptStore::normalizedBlock(const QString &markdown) {
+    // Shares the caller's buffer unless something actually has to change
+    QString normalized = markdown;
+    if (normalized.contains(u'\r')) {
+        normalized.replace("\r\n", "\n");
+        normalized.replace("\r", "\n");
+    }
+    int fenceCount = 0;
+    qsizetype lineStart = 0;
+    while (lineStart < normalized.size()) {
+        qsizetype lineEnd = normalized.indexOf(u'\n', lineStart);
+        if (lineEnd < 0)
+            lineEnd = normalized.size();
+        const QStringView line = QStringView(normalized).mid(lineStart, lineEnd - lineStart);
+        if (line.trimmed().startsWith(u"```"))
+            ++fenceCount;
+        lineStart = lineEnd + 1;
+    }
+    if (fenceCount % 2 != 0) {
+        if (!normalized.endsWith('\n'))
+            normalized += '\n';
+        normalized += "```";
+    }
+    return normalized;
+}
+
+QString TranscriptStore::userMessageBlock(const QString &text) {
+    QString normalized = text;
+    normalized.replace("\r\n", "\n");
+    normalized.replace("\r", "\n");
+    const QStringList lines = normalized.split('\n');
+
+    QString block = "---\n";
+    block += "> **You**: \n";
+    for (const QString &line : lines)
+        block += "> " + line + "  \n";
+    block += "\n---";
+    return block;
+}
@@ -0,0 +1,39 @@
+#ifndef TRANSCRIPTSTORE_H
+#define TRANSCRIPTSTORE_H
+
+#include <QList>
+#include <QString>
+#include <QStringView>
+
+// Conversation text kept as an append-only list of committed markdown blocks
+// plus the reply that is still streaming. Committed blocks are stored once and
+// handed to the renderer by reference; only the pending tail ever changes.
+class TranscriptStore {
+public:
+    void appendBlock(const QString &markdown);
+    int blockCount() const;
+    const QString &blockAt(int index) const;
+
+    void appendPending(QStringView text);
+    const QString &pending() const;
+    bool hasPending() const;
+    QString takePending();
+    void clearPending();
+    // Number of times the pending buffer had to grow since it was last cleared.
+    int pendingReallocations() const;
+
+    void clear();
+
+    // Unifies line endings and closes a code fence left open, e.g. by a
+    // reply that was cut off
+    static QString normalizedBlock(const QString &markdown);
+    // Quote block that shows a follow-up the user sent
+    static QString userMessageBlock(const QString &text);
+
+private:
+    QList<QString> blocks;
+    QString pendingText;
+    int reallocations = 0;
+};
+
+#endif // TRANSCRIPTSTORE_H